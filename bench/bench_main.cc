@@ -0,0 +1,34 @@
+// Runs the micro-benchmarks, writing the results as JSON to
+// sidebands_bench.json as well as to the console, unless told otherwise with
+// --benchmark_out and --benchmark_out_format.
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <vector>
+
+#include "globals.h"
+
+int main(int argc, char *argv[]) {
+  sidebands::InitProcess();
+
+  std::vector<char *> args(argv, argv + argc);
+  bool has_out = false, has_out_format = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strncmp(argv[i], "--benchmark_out_format", 22) == 0)
+      has_out_format = true;
+    else if (std::strncmp(argv[i], "--benchmark_out", 15) == 0)
+      has_out = true;
+  }
+  char out_arg[] = "--benchmark_out=sidebands_bench.json";
+  char out_format_arg[] = "--benchmark_out_format=json";
+  if (!has_out) args.push_back(out_arg);
+  if (!has_out_format) args.push_back(out_format_arg);
+
+  int num_args = args.size();
+  benchmark::Initialize(&num_args, args.data());
+  if (benchmark::ReportUnrecognizedArguments(num_args, args.data())) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
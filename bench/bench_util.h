@@ -0,0 +1,42 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "dsp/oscbuffer.h"
+
+namespace sidebands {
+namespace bench {
+
+constexpr double kBenchSampleRate = 48000;
+
+// Block sizes the kernels and renderers are measured at: from small host
+// buffers up to offline rendering sizes.
+inline const std::vector<int64_t> kBlockSizes{64, 256, 1024, 4096};
+
+// Report `frames` audio samples rendered per iteration: as samples per second
+// of wall time, and as a realtime factor, the seconds of audio rendered per
+// second of wall time at kBenchSampleRate.
+inline void ReportRate(benchmark::State &state, int64_t frames) {
+  state.SetItemsProcessed(state.iterations() * frames);
+  state.counters["samples_per_second"] = benchmark::Counter(
+      frames, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["realtime_factor"] = benchmark::Counter(
+      frames / kBenchSampleRate, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// `size` values spread uniformly over [min, max), the same on every run.
+inline OscBuffer RandomBuffer(size_t size, double min = -1.0,
+                              double max = 1.0) {
+  std::mt19937 gen(size);
+  std::uniform_real_distribution<double> dist(min, max);
+  OscBuffer buffer(size);
+  for (auto &x : buffer) x = dist(gen);
+  return buffer;
+}
+
+}  // namespace bench
+}  // namespace sidebands
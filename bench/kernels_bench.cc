@@ -0,0 +1,220 @@
+// The vector kernels in dsp/: oscbuffer.cc, the DC blocker and the FFT.
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "bench_util.h"
+#include "dsp/dc_block.h"
+#include "dsp/fft.h"
+#include "dsp/oscbuffer.h"
+
+namespace sidebands {
+namespace bench {
+namespace {
+
+// dst = fn(src)
+template <typename Fn>
+void BM_Unary(benchmark::State &state, Fn fn) {
+  const OscBuffer src = RandomBuffer(state.range(0));
+  for (auto _ : state) {
+    OscBuffer dst = fn(src);
+    benchmark::DoNotOptimize(dst);
+  }
+  ReportRate(state, state.range(0));
+}
+
+// dst = fn(l, r), with r kept away from zero for division.
+template <typename Fn>
+void BM_Binary(benchmark::State &state, Fn fn) {
+  const OscBuffer l = RandomBuffer(state.range(0));
+  const OscBuffer r = RandomBuffer(state.range(0), 0.5, 2.0);
+  for (auto _ : state) {
+    OscBuffer dst = fn(l, r);
+    benchmark::DoNotOptimize(dst);
+  }
+  ReportRate(state, state.range(0));
+}
+
+// fn(l, r) updating l in place. Multiplying and dividing by r in [0.5, 2)
+// over and over would run off to denormals or infinities, so each call works
+// on a fresh copy; the copy is cheap next to the kernels, but it's measured
+// with them.
+template <typename Fn>
+void BM_Inplace(benchmark::State &state, Fn fn) {
+  const OscBuffer src = RandomBuffer(state.range(0));
+  const OscBuffer r = RandomBuffer(state.range(0), 0.5, 2.0);
+  OscBuffer l(src.size());
+  for (auto _ : state) {
+    l = src;
+    fn(l, r);
+    benchmark::DoNotOptimize(l);
+  }
+  ReportRate(state, state.range(0));
+}
+
+#define SIDEBANDS_KERNEL_BENCHMARK(bm, name, ...) \
+  BENCHMARK_CAPTURE(bm, name, __VA_ARGS__)->ArgsProduct({kBlockSizes})
+
+SIDEBANDS_KERNEL_BENCHMARK(BM_Unary, Vcos,
+                           [](const OscBuffer &x) { return Vcos(x); });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Unary, Vexp,
+                           [](const OscBuffer &x) { return Vexp(x); });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Unary, Vsin,
+                           [](const OscBuffer &x) { return Vsin(x); });
+
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vmul,
+                           [](const OscBuffer &l, const OscBuffer &r) {
+                             return Vmul(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vdiv,
+                           [](const OscBuffer &l, const OscBuffer &r) {
+                             return Vdiv(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vsub,
+                           [](const OscBuffer &l, const OscBuffer &r) {
+                             return Vsub(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vadd,
+                           [](const OscBuffer &l, const OscBuffer &r) {
+                             return Vadd(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vmul_scalar,
+                           [](const OscBuffer &l, const OscBuffer &) {
+                             return Vmul(l, 0.75);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vdiv_scalar,
+                           [](const OscBuffer &l, const OscBuffer &) {
+                             return Vdiv(l, 0.75);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vsub_scalar,
+                           [](const OscBuffer &l, const OscBuffer &) {
+                             return Vsub(l, 0.75);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Binary, Vadd_scalar,
+                           [](const OscBuffer &l, const OscBuffer &) {
+                             return Vadd(l, 0.75);
+                           });
+
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VaddInplace,
+                           [](OscBuffer &l, const OscBuffer &r) {
+                             VaddInplace(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VmulInplace,
+                           [](OscBuffer &l, const OscBuffer &r) {
+                             VmulInplace(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VdivInplace,
+                           [](OscBuffer &l, const OscBuffer &r) {
+                             VdivInplace(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VsubInplace,
+                           [](OscBuffer &l, const OscBuffer &r) {
+                             VsubInplace(l, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VaddInplace_scalar,
+                           [](OscBuffer &l, const OscBuffer &) {
+                             VaddInplace(l, 0.75);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VmulInplace_scalar,
+                           [](OscBuffer &l, const OscBuffer &) {
+                             VmulInplace(l, 0.75);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VdivInplace_scalar,
+                           [](OscBuffer &l, const OscBuffer &) {
+                             VdivInplace(l, 0.75);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VsubInplace_scalar,
+                           [](OscBuffer &l, const OscBuffer &) {
+                             VsubInplace(l, 0.75);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, VmulAddInplace,
+                           [](OscBuffer &acc, const OscBuffer &r) {
+                             VmulAddInplace(acc, r, r);
+                           });
+SIDEBANDS_KERNEL_BENCHMARK(BM_Inplace, Vramp, [](OscBuffer &l,
+                                                 const OscBuffer &) {
+  Vramp(l, 0.25, 1e-4);
+});
+
+void BM_Vpeak(benchmark::State &state) {
+  const OscBuffer src = RandomBuffer(state.range(0));
+  for (auto _ : state) benchmark::DoNotOptimize(Vpeak(src));
+  ReportRate(state, state.range(0));
+}
+BENCHMARK(BM_Vpeak)->ArgsProduct({kBlockSizes});
+
+void BM_ToFloat(benchmark::State &state) {
+  const OscBuffer src = RandomBuffer(state.range(0));
+  std::vector<float> out(src.size());
+  for (auto _ : state) {
+    ToFloat(src, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  ReportRate(state, state.range(0));
+}
+BENCHMARK(BM_ToFloat)->ArgsProduct({kBlockSizes});
+
+void BM_linspace(benchmark::State &state) {
+  OscBuffer dst(state.range(0));
+  for (auto _ : state) {
+    linspace(dst, 0.0, 1.0, dst.size());
+    benchmark::DoNotOptimize(dst);
+  }
+  ReportRate(state, state.range(0));
+}
+BENCHMARK(BM_linspace)->ArgsProduct({kBlockSizes});
+
+void BM_weighted_exp(benchmark::State &state) {
+  for (auto _ : state) {
+    OscBuffer dst = weighted_exp(state.range(0), 1.0, 0.001, 4.0);
+    benchmark::DoNotOptimize(dst);
+  }
+  ReportRate(state, state.range(0));
+}
+BENCHMARK(BM_weighted_exp)->ArgsProduct({kBlockSizes});
+
+// The filter carries its state from block to block, as it does in a voice.
+void BM_DCBlock2(benchmark::State &state) {
+  OscBuffer buffer = RandomBuffer(state.range(0));
+  DCBlock2 dc_block;
+  for (auto _ : state) {
+    dc_block.Filter(buffer);
+    benchmark::DoNotOptimize(buffer);
+  }
+  ReportRate(state, state.range(0));
+}
+BENCHMARK(BM_DCBlock2)->ArgsProduct({kBlockSizes});
+
+// Transforms are of a fresh copy of the input each time, or they'd grow
+// without bound.
+void BM_FFT(benchmark::State &state) {
+  const OscBuffer real = RandomBuffer(state.range(0));
+  const ComplexBuffer src = ScalarToComplex(&real[0], real.size());
+  ComplexBuffer x(src.size());
+  for (auto _ : state) {
+    x = src;
+    FFT(x);
+    benchmark::DoNotOptimize(x);
+  }
+  ReportRate(state, state.range(0));
+}
+BENCHMARK(BM_FFT)->RangeMultiplier(4)->Range(256, 16384);
+
+void BM_FFTPlan(benchmark::State &state) {
+  const OscBuffer real = RandomBuffer(state.range(0));
+  const ComplexBuffer src = ScalarToComplex(&real[0], real.size());
+  const FFTPlan plan(src.size());
+  ComplexBuffer x(src.size());
+  for (auto _ : state) {
+    x = src;
+    plan.Forward(x);
+    benchmark::DoNotOptimize(x);
+  }
+  ReportRate(state, state.range(0));
+}
+BENCHMARK(BM_FFTPlan)->RangeMultiplier(4)->Range(256, 16384);
+
+}  // namespace
+}  // namespace bench
+}  // namespace sidebands
@@ -0,0 +1,106 @@
+// Times plugin startup the way a host loading a session does it, for a number
+// of instances kept alive side by side: construction, initialize,
+// setupProcessing and activation, and the first process call, each for the
+// processor and controller separately.
+//
+// Usage: sidebands_startup_bench [instances] [sample rate] [block size]
+
+#include <pluginterfaces/vst/ivstaudioprocessor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "controller/sidebands_controller.h"
+#include "host/processor_host.h"
+
+using namespace Steinberg;
+using namespace sidebands;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Times of one stage across all instances, in milliseconds.
+struct Stage {
+  std::string name;
+  std::vector<double> times;
+
+  template <typename Fn>
+  void Time(Fn fn) {
+    const auto start = Clock::now();
+    fn();
+    times.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count());
+  }
+
+  void Report() const {
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (double t : sorted) total += t;
+    std::printf("%-28s %10.3f %10.3f %10.3f %10.3f\n", name.c_str(), total,
+                sorted.front(), sorted[sorted.size() / 2], sorted.back());
+  }
+};
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const int instances = argc > 1 ? std::max(1, std::atoi(argv[1])) : 32;
+  const double sample_rate = argc > 2 ? std::atof(argv[2]) : 48000;
+  const int32 block_size = argc > 3 ? std::atoi(argv[3]) : 512;
+
+  Stage processor_construct{"processor construct", {}};
+  Stage processor_initialize{"processor initialize", {}};
+  Stage processor_setup{"processor setupProcessing", {}};
+  Stage processor_activate{"processor setActive", {}};
+  Stage processor_first_process{"processor first process", {}};
+  Stage controller_construct{"controller construct", {}};
+  Stage controller_initialize{"controller initialize", {}};
+
+  std::vector<std::unique_ptr<ProcessorHost>> hosts;
+  std::vector<SidebandsController *> controllers;
+
+  for (int i = 0; i < instances; i++) {
+    auto &host = *hosts.emplace_back(std::make_unique<ProcessorHost>(
+        Vst::kRealtime, sample_rate, block_size));
+    processor_construct.Time([&] { host.Instantiate(); });
+    processor_initialize.Time([&] { host.Initialize(); });
+    processor_setup.Time([&] { host.SetupProcessing(); });
+    processor_activate.Time([&] { host.Activate(); });
+    processor_first_process.Time([&] { host.Process(); });
+
+    SidebandsController *controller;
+    controller_construct.Time([&] {
+      controller = static_cast<SidebandsController *>(
+          static_cast<Vst::IEditController *>(
+              SidebandsController::Instantiate(nullptr)));
+    });
+    controllers.push_back(controller);
+    controller_initialize.Time([&] { controller->initialize(nullptr); });
+  }
+
+  std::printf("%d instances, %.0f Hz, %d sample blocks; times in ms\n",
+              instances, sample_rate, block_size);
+  std::printf("%-28s %10s %10s %10s %10s\n", "stage", "total", "min",
+              "median", "max");
+  for (const auto *stage :
+       {&processor_construct, &processor_initialize, &processor_setup,
+        &processor_activate, &processor_first_process, &controller_construct,
+        &controller_initialize}) {
+    stage->Report();
+  }
+
+  hosts.clear();
+  for (auto *controller : controllers) {
+    controller->terminate();
+    controller->release();
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+// Oscillators, modulation sources and the whole render path through Player.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "bench_util.h"
+#include "constants.h"
+#include "processor/patch_processor.h"
+#include "processor/synthesis/envgen.h"
+#include "processor/synthesis/lfo.h"
+#include "processor/synthesis/oscillator.h"
+#include "processor/synthesis/player.h"
+
+namespace sidebands {
+namespace bench {
+namespace {
+
+// A patch with the first `num_generators` generators on, at their defaults.
+std::unique_ptr<PatchProcessor> MakePatch(int num_generators) {
+  auto patch = std::make_unique<PatchProcessor>();
+  for (int g = 0; g < kNumGenerators; g++)
+    patch->generators_[g]->set_on(g < num_generators);
+  patch->StructureChanged();
+  return patch;
+}
+
+void BM_Oscillator(benchmark::State &state, GeneratorPatch::OscType type) {
+  const size_t frames = state.range(0);
+  auto oscillator = MakeOscillator(type);
+  OscParams params(frames);
+  params.note_freq = 220.0;
+  params.C = 1.0;
+  params.M = 2.0;
+  params.R = 1.0;
+  params.S = 0.0;
+  params.K = 2.5;
+  OscBuffer buffer(frames);
+  for (auto _ : state) {
+    oscillator->Perform(kBenchSampleRate, buffer, params);
+    benchmark::DoNotOptimize(buffer);
+  }
+  ReportRate(state, frames);
+}
+BENCHMARK_CAPTURE(BM_Oscillator, ModFM, GeneratorPatch::OscType::MOD_FM)
+    ->ArgsProduct({kBlockSizes});
+BENCHMARK_CAPTURE(BM_Oscillator, Analog, GeneratorPatch::OscType::ANALOG)
+    ->ArgsProduct({kBlockSizes});
+
+// Notes of kNoteSeconds, released and retriggered as soon as they've died
+// away, so that every stage is rendered in proportion to how long it lasts.
+constexpr double kNoteSeconds = 0.5;
+
+void BM_EnvelopeGenerator(benchmark::State &state) {
+  const size_t frames = state.range(0);
+  auto patch = MakePatch(1);
+  const auto *params = patch->generators_[0]->ModulationParams(TARGET_A);
+  EnvelopeGenerator envelope;
+  OscBuffer buffer(frames);
+  size_t note_frames = 0;
+  bool released = false;
+  envelope.On(kBenchSampleRate, params);
+  for (auto _ : state) {
+    envelope.Amplitudes(kBenchSampleRate, buffer, 0.8, params);
+    benchmark::DoNotOptimize(buffer);
+    note_frames += frames;
+    if (!released && note_frames >= kNoteSeconds * kBenchSampleRate) {
+      envelope.Release(kBenchSampleRate, params);
+      released = true;
+    }
+    if (!envelope.Playing()) {
+      envelope.On(kBenchSampleRate, params);
+      note_frames = 0;
+      released = false;
+    }
+  }
+  ReportRate(state, frames);
+}
+BENCHMARK(BM_EnvelopeGenerator)->ArgsProduct({kBlockSizes});
+
+void BM_LFO(benchmark::State &state) {
+  const size_t frames = state.range(0);
+  auto patch = MakePatch(1);
+  const auto *params = patch->generators_[0]->ModulationParams(TARGET_A);
+  LFO lfo;
+  OscBuffer buffer(frames);
+  lfo.On(kBenchSampleRate, params);
+  for (auto _ : state) {
+    lfo.Amplitudes(kBenchSampleRate, buffer, 0.8, params);
+    benchmark::DoNotOptimize(buffer);
+  }
+  ReportRate(state, frames);
+}
+BENCHMARK(BM_LFO)->ArgsProduct({kBlockSizes});
+
+// The full render path: voices × generators × block size × voice layout. All
+// the voices are held at once, so after their attacks they sit in sustain,
+// the steady state of a held chord.
+void BM_PlayerPerform32(benchmark::State &state) {
+  const int num_voices = state.range(0);
+  const int num_generators = state.range(1);
+  const size_t frames = state.range(2);
+  const auto layout = static_cast<VoiceLayout>(state.range(3));
+
+  auto patch = MakePatch(num_generators);
+  Player player(patch.get(), kBenchSampleRate, num_voices, layout);
+  for (int v = 0; v < num_voices; v++)
+    player.NoteOn(v, 0.8, 36 + (v * 7) % 48);
+  std::vector<Sample32> out(frames);
+  // Get past the attacks before measuring.
+  for (size_t warmup = 0; warmup < kBenchSampleRate; warmup += frames)
+    player.Perform32(nullptr, out.data(), frames);
+
+  for (auto _ : state) {
+    player.Perform32(nullptr, out.data(), frames);
+    benchmark::DoNotOptimize(out.data());
+  }
+  ReportRate(state, frames);
+}
+BENCHMARK(BM_PlayerPerform32)
+    ->ArgNames({"voices", "generators", "block", "layout"})
+    ->ArgsProduct({{1, 8, 32},
+                   {1, 4, 16},
+                   {64, 256, 1024},
+                   {int(VoiceLayout::PER_VOICE), int(VoiceLayout::VOICE_LANES),
+                    int(VoiceLayout::GENERATOR_LANES)}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace bench
+}  // namespace sidebands
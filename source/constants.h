@@ -1,16 +1,64 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace sidebands {
 
-// The number of generators to configure.
-constexpr int32_t kNumGenerators = 8;
+// The number of generators to configure. Generator numbers are packed into the
+// top byte of parameter IDs, below the sign bit, so this can't exceed 127.
+constexpr int32_t kNumGenerators = 32;
 
-constexpr int kNumVoices = 8;  // Must be power of 2.
+// Polyphony is chosen at activation, up to kMaxVoices.
+constexpr int kDefaultNumVoices = 8;
+constexpr int kMaxVoices = 128;
 
-// Minimum 8.
-constexpr size_t kSampleAccurateChunkSizeSamples = 32;
+// How voices are laid out for rendering. PER_VOICE renders each voice on its
+// own, vectorised along time. VOICE_LANES renders groups of voices together,
+// one voice per SIMD lane, which holds up better at small block sizes.
+// GENERATOR_LANES renders each voice on its own but with groups of its
+// generators together, one per SIMD lane, for patches using many generators.
+enum class VoiceLayout { PER_VOICE, VOICE_LANES, GENERATOR_LANES };
+constexpr int kNumVoiceLayouts = 3;
+
+// How long a stolen voice takes to fade out, running alongside the attack of
+// the note that stole it.
+constexpr double kVoiceStealFadeSeconds = 0.005;
+
+// Patches loaded while notes are sounding take over at a block boundary. The
+// voices fade out and back in around the change, over this long by default.
+constexpr double kDefaultPatchFadeMs = 5;
+constexpr double kMaxPatchFadeMs = 50;
+
+// Voices whose amplitude envelopes are within this many dB of each other are
+// considered equally loud when choosing one to steal, so age decides.
+constexpr double kVoiceStealLevelBucketDb = 6.0;
+
+// Generators whose amplitude stays below this, relative to full scale, for a
+// whole slice are inaudible: they skip evaluating their oscillator, and once
+// released they switch off rather than play out their envelope tail.
+constexpr double kSilenceThresholdDb = -96.0;
+
+// Host blocks are split wherever a note event or automation point falls, and
+// otherwise into slices of at most kMaxSliceSamples.
+constexpr int32_t kMaxSliceSamples = 512;
+
+// Room reserved for one block's worth of note events, so queueing them doesn't
+// normally allocate on the audio thread.
+constexpr size_t kMaxPendingEvents = 512;
+
+// Samples the output tap buffers for the live views: about 0.7s at 48kHz,
+// many times the analyser's frame period.
+constexpr size_t kOutputTapSamples = 1 << 15;
+
+// Limits on spectrogram requests: note and release length, sample rate, and
+// frames or rows.
+constexpr int64_t kMaxSpectrogramMs = 30000;
+constexpr int64_t kMaxSpectrogramSampleRate = 192000;
+constexpr int64_t kMaxSpectrogramSize = 1024;
+
+// Limit on the samples of waveform an analysis request can ask for.
+constexpr int64_t kMaxAnalysisBufferSize = 1 << 16;
 
 enum class LFOType { SIN, COS };
 constexpr LFOType kLFOTypes[]{LFOType::SIN, LFOType::COS};
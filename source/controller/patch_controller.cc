@@ -1,190 +1,84 @@
 #include "controller/patch_controller.h"
 
-#include <absl/strings/str_format.h>
 #include <base/source/fstreamer.h>
 #include <pluginterfaces/base/ustring.h>
 #include <pluginterfaces/vst/vsttypes.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
 #include <string>
+#include <vector>
 
 #include "constants.h"
+#include "param_descriptors.h"
+#include "processor/patch_record.h"
 #include "tags.h"
 
 namespace sidebands {
 
 using Steinberg::Vst::ParameterInfo;
 
-IPtr<RangeParameter> BooleanParameter(Steinberg::Vst::UnitID unit_id,
-                                      const std::string &name, ParamTag tag,
-                                      TargetTag sp, uint32_t gen_num) {
+IPtr<RangeParameter> GeneratorParameter(const ParamDescriptor &param,
+                                        uint32_t gen_num, TargetTag target) {
+  const TargetTag id_target = target == TARGET_NA ? param.target : target;
+  const ParamValue default_value = DefaultValueFor(param, gen_num, target);
   auto info = ParameterInfo{
-      .id = TagFor(gen_num, tag, sp),
-      .stepCount = 1,
-      .defaultNormalizedValue = 0,
-      .unitId = unit_id,
+      .id = TagFor(gen_num, param.tag, id_target),
+      .stepCount =
+          param.kind == ParamKind::STEPPED ? int32_t(param.max - param.min) : 0,
+      .defaultNormalizedValue =
+          (default_value - param.min) / (param.max - param.min),
+      .unitId = MakeUnitID(UNIT_GENERATOR, gen_num),
   };
-  std::string full_name = absl::StrFormat("Gen %d %s", gen_num, name);
+  char title[std::size(info.title)];
+  std::snprintf(title, sizeof(title), "Gen %u %s%s%s", gen_num,
+                param.title_prefix,
+                target == TARGET_NA ? "" : kTargetNames[target],
+                param.title_suffix);
   Steinberg::UString(info.title, USTRINGSIZE(info.title))
-      .assign(USTRING(full_name.c_str()));
+      .assign(USTRING(title));
 
-  return new RangeParameter(info, 0, 1);
+  return new RangeParameter(info, param.min, param.max);
 }
 
-IPtr<RangeParameter> GenericParameter(Steinberg::Vst::UnitID unit_id,
-                                      const std::string &name, ParamTag tag,
-                                      TargetTag sp, uint32_t gen_num,
-                                      ParamValue min, ParamValue max) {
-  std::string full_name = absl::StrFormat("Gen %d %s", gen_num, name);
-
+IPtr<RangeParameter> GlobalParameter(const std::string &name, ParamTag tag,
+                                     ParamValue min, ParamValue max,
+                                     ParamValue default_value) {
   auto info = ParameterInfo{
-      .id = TagFor(gen_num, tag, sp),
-      .stepCount = 0,
-      .defaultNormalizedValue = 0,
-      .unitId = unit_id,
+      .id = TagFor(0, tag, TARGET_NA),
+      .stepCount = int32_t(max - min),
+      .defaultNormalizedValue = (default_value - min) / (max - min),
+      .unitId = Steinberg::Vst::kRootUnitId,
   };
   Steinberg::UString(info.title, USTRINGSIZE(info.title))
-      .assign(USTRING(full_name.c_str()));
-
-  return new RangeParameter(info, min, max);
-}
-
-IPtr<RangeParameter> ModTypeParameter(Steinberg::Vst::UnitID unit_id,
-                                      TargetTag target, uint32_t gen_num) {
-  std::string full_name = absl::StrFormat("Gen %d Mod Types %s (bitset)",
-                                          gen_num, kTargetNames[target]);
-
-  auto info = ParameterInfo{
-      .id = TagFor(gen_num, TAG_MODULATIONS, target),
-      .stepCount = 0,
-      .defaultNormalizedValue = 0,
-      .unitId = unit_id,
-  };
-  Steinberg::UString(info.title, USTRINGSIZE(info.title))
-      .assign(USTRING(full_name.c_str()));
-
-  return new RangeParameter(info, 0, 255);
-}
-
-IPtr<RangeParameter> OscillatorParameter(Steinberg::Vst::UnitID unit_id,
-                                         const std::string &name, TargetTag sp,
-                                         uint32_t gen_num, ParamValue min,
-                                         ParamValue max) {
-  std::string full_name =
-      absl::StrFormat("Gen %d ModFMOscillator %s", gen_num, name);
-
-  auto info = ParameterInfo{
-      .id = TagFor(gen_num, TAG_OSC, sp),
-      .stepCount = 0,
-      .defaultNormalizedValue = 0,
-      .unitId = unit_id,
-  };
-  Steinberg::UString(info.title, USTRINGSIZE(info.title))
-      .assign(USTRING(full_name.c_str()));
-
-  return new RangeParameter(info, min, max);
-}
-
-IPtr<RangeParameter> LFOParameter(Steinberg::Vst::UnitID unit_id,
-                                  const std::string &name, ParamTag tag,
-                                  TargetTag sp, uint32_t gen_num,
-                                  ParamValue min, ParamValue max) {
-  std::string full_name = absl::StrFormat("Gen %d LFO %s", gen_num, name);
-
-  auto info = ParameterInfo{
-      .id = TagFor(gen_num, tag, sp),
-      .stepCount = 0,
-      .defaultNormalizedValue = 0,
-      .unitId = unit_id,
-  };
-  Steinberg::UString(info.title, USTRINGSIZE(info.title))
-      .assign(USTRING(full_name.c_str()));
-
-  return new RangeParameter(info, min, max);
-}
-
-IPtr<RangeParameter> EnvelopeParameter(Steinberg::Vst::UnitID unit_id,
-                                       const std::string &name, ParamTag tag,
-                                       TargetTag sp, uint32_t gen_num,
-                                       ParamValue min, ParamValue max) {
-  std::string full_name = absl::StrFormat("Gen %d Envelope %s", gen_num, name);
-
-  auto info = ParameterInfo{
-      .id = TagFor(gen_num, tag, sp),
-      .stepCount = 0,
-      .defaultNormalizedValue = 0,
-      .unitId = unit_id,
-  };
-  Steinberg::UString(info.title, USTRINGSIZE(info.title))
-      .assign(USTRING(full_name.c_str()));
+      .assign(USTRING(name.c_str()));
 
   return new RangeParameter(info, min, max);
 }
 
 void PatchController::AppendParameters(ParameterContainer *container) {
+  // Room for all of them up front, one per value of a patch record.
+  container->init(PatchLayout::Current().RecordSize(kNumGenerators));
+  container->addParameter(GlobalParameter("Polyphony", TAG_POLYPHONY, 1,
+                                          kMaxVoices, kDefaultNumVoices));
+  container->addParameter(
+      GlobalParameter("Voice layout", TAG_VOICE_LAYOUT, 0,
+                      kNumVoiceLayouts - 1, int(VoiceLayout::PER_VOICE)));
+  container->addParameter(
+      GlobalParameter("Baked wavetables", TAG_BAKED_WAVETABLES, 0, 1, 0));
+  container->addParameter(GlobalParameter("Patch change fade", TAG_PATCH_FADE,
+                                          0, kMaxPatchFadeMs,
+                                          kDefaultPatchFadeMs));
+  auto dsp_load = GlobalParameter("DSP load", TAG_DSP_LOAD, 0, 100, 0);
+  dsp_load->getInfo().flags = ParameterInfo::kIsReadOnly;
+  container->addParameter(dsp_load);
   for (int generator = 0; generator < kNumGenerators; generator++) {
-    auto unit_id = MakeUnitID(UNIT_GENERATOR, generator);
-    container->addParameter(BooleanParameter(
-        unit_id, "On", TAG_GENERATOR_TOGGLE, TARGET_NA, generator));
-    container->addParameter(
-        OscillatorParameter(unit_id, "C", TARGET_C, generator, 0, 8));
-    container->addParameter(
-        OscillatorParameter(unit_id, "A", TARGET_A, generator, 0, 1));
-    container->addParameter(
-        OscillatorParameter(unit_id, "M", TARGET_M, generator, 0, 8));
-    container->addParameter(
-        OscillatorParameter(unit_id, "K", TARGET_K, generator, 0, 10));
-    container->addParameter(
-        OscillatorParameter(unit_id, "R", TARGET_R, generator, 0, 1));
-    container->addParameter(
-        OscillatorParameter(unit_id, "S", TARGET_S, generator, -1, 1));
-    container->addParameter(OscillatorParameter(
-        unit_id, "Portamento", TARGET_PORTAMENTO, generator, 0, 1));
-    container->addParameter(OscillatorParameter(
-        unit_id, "Oscillator type", TARGET_OSC_TYPE, generator, 0, 1));
-
+    for (const auto &param : kGeneratorParams)
+      container->addParameter(GeneratorParameter(param, generator, TARGET_NA));
     for (auto target : kModulationTargets) {
-      container->addParameter(ModTypeParameter(unit_id, target, generator));
-
-      const std::string env_name =
-          absl::StrFormat("%s Env ", kTargetNames[target]);
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " HT", TAG_ENV_HT, target, generator, 0, 1));
-
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " AR", TAG_ENV_AR, target, generator, 0, 1));
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " AL", TAG_ENV_AL, target, generator, 0, 1));
-
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " DR1", TAG_ENV_DR1, target, generator, 0, 1));
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " DL1", TAG_ENV_DL1, target, generator, 0, 1));
-
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " DR2", TAG_ENV_DR2, target, generator, 0, 1));
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " SL", TAG_ENV_SL, target, generator, 0, 1));
-
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " RR1", TAG_ENV_RR1, target, generator, 0, 1));
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " RL1", TAG_ENV_RL1, target, generator, 0, 1));
-
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " RR2", TAG_ENV_RR2, target, generator, 0, 1));
-
-      container->addParameter(EnvelopeParameter(
-          unit_id, env_name + " VS", TAG_ENV_VS, target, generator, 0, 1));
-
-      container->addParameter(LFOParameter(unit_id, "Type", TAG_LFO_TYPE,
-                                           target, generator, 0,
-                                           kNumLFOTypes - 1));
-      container->addParameter(LFOParameter(unit_id, "Amplitude", TAG_LFO_AMP,
-                                           target, generator, 0, 1));
-      container->addParameter(LFOParameter(unit_id, "Frequency", TAG_LFO_FREQ,
-                                           target, generator, 0, 20));
-      container->addParameter(LFOParameter(unit_id, "VelSense", TAG_LFO_VS,
-                                           target, generator, 0, 1));
+      for (const auto &param : kModulationParams)
+        container->addParameter(GeneratorParameter(param, generator, target));
     }
   }
 }
@@ -195,17 +89,26 @@ Steinberg::tresult PatchController::LoadPatch(
   Steinberg::IBStreamer streamer(stream);
 
   LOG(INFO) << "Loading from stream...";
+  // Legacy streams start with their generator count instead of the magic.
   Steinberg::uint32 num_generators;
   if (!streamer.readInt32u(num_generators)) {
-    LOG(ERROR) << "Could not read patch stream; expected generator count.";
+    LOG(ERROR) << "Could not read patch stream; expected header.";
     return Steinberg::kResultFalse;
   }
-  if (num_generators != kNumGenerators) {
+  if (num_generators == kPatchRecordMagic)
+    return LoadPatchRecord(streamer, edit_controller);
+  if (num_generators > kNumGenerators) {
     LOG(ERROR) << "Incompatible generator count. Got: " << num_generators
-               << " expected: " << kNumGenerators;
+               << " expected at most: " << kNumGenerators;
     return Steinberg::kResultFalse;
   }
 
+  // Patches saved with fewer generators leave the rest switched off.
+  for (uint32_t g = num_generators; g < kNumGenerators; g++) {
+    edit_controller->setParamNormalized(
+        TagFor(g, TAG_GENERATOR_TOGGLE, TARGET_NA), 0);
+  }
+
   while (num_generators--) {
     Steinberg::uint32 stream_gennum, num_params;
     if (!streamer.readInt32u(stream_gennum)) {
@@ -221,11 +124,74 @@ Steinberg::tresult PatchController::LoadPatch(
       Steinberg::Vst::ParamID id;
       if (!streamer.readInt32u(id)) break;
       ParamValue v;
-      CHECK(streamer.readDouble(v))
-          << "Unable to read value for param id: " << id;
+      if (!streamer.readDouble(v)) {
+        LOG(ERROR) << "Unable to read value for param id: " << id;
+        return Steinberg::kResultFalse;
+      }
       edit_controller->setParamNormalized(id, v);
     }
   }
+
+  // Global parameters, if present, follow the generators.
+  Steinberg::Vst::ParamID id;
+  while (streamer.readInt32u(id)) {
+    ParamValue v;
+    if (!streamer.readDouble(v)) break;
+    edit_controller->setParamNormalized(id, v);
+  }
+  return Steinberg::kResultOk;
+}
+
+Steinberg::tresult PatchController::LoadPatchRecord(
+    Steinberg::IBStreamer &streamer,
+    Steinberg::Vst::IEditController *edit_controller) {
+  Steinberg::uint16 version, num_generators, num_generator_params,
+      num_global_params;
+  if (!streamer.readInt16u(version) || !streamer.readInt16u(num_generators) ||
+      !streamer.readInt16u(num_generator_params) ||
+      !streamer.readInt16u(num_global_params)) {
+    LOG(ERROR) << "Truncated patch record header.";
+    return Steinberg::kResultFalse;
+  }
+  if (version > kPatchRecordVersion) {
+    LOG(ERROR) << "Patch record version " << version
+               << " is newer than supported: " << kPatchRecordVersion;
+    return Steinberg::kResultFalse;
+  }
+  if (!PatchRecordSane(num_generator_params, num_global_params)) {
+    LOG(ERROR) << "Corrupt patch record header: " << num_generator_params
+               << " generator and " << num_global_params
+               << " global parameters";
+    return Steinberg::kResultFalse;
+  }
+  PatchLayout layout;
+  layout.generator_params.resize(num_generator_params);
+  layout.global_params.resize(num_global_params);
+  std::vector<double> values;
+  if (!streamer.readInt32uArray(layout.generator_params.data(),
+                                num_generator_params) ||
+      !streamer.readInt32uArray(layout.global_params.data(),
+                                num_global_params) ||
+      !ReadPatchRecordValues(streamer, layout, num_generators, &values)) {
+    LOG(ERROR) << "Truncated patch record.";
+    return Steinberg::kResultFalse;
+  }
+
+  // Parameters this build doesn't have are rejected by the controller.
+  const uint32_t num_kept = std::min<uint32_t>(num_generators, kNumGenerators);
+  const double *value = values.data();
+  for (uint32_t g = 0; g < num_kept; g++) {
+    for (auto id : layout.generator_params) {
+      edit_controller->setParamNormalized(
+          TagFor(g, ParamFor(id), TargetFor(id)), *value++);
+    }
+  }
+  for (uint32_t g = num_kept; g < kNumGenerators; g++) {
+    edit_controller->setParamNormalized(
+        TagFor(g, TAG_GENERATOR_TOGGLE, TARGET_NA), 0);
+  }
+  for (auto id : layout.global_params)
+    edit_controller->setParamNormalized(id, *value++);
   return Steinberg::kResultOk;
 }
 
@@ -2,6 +2,10 @@
 
 #include <public.sdk/source/vst/vstparameters.h>
 
+namespace Steinberg {
+class IBStreamer;
+}  // namespace Steinberg
+
 namespace sidebands {
 
 using Steinberg::IPtr;
@@ -22,6 +26,10 @@ class PatchController {
       Steinberg::Vst::IEditController *edit_controller);
   Steinberg::tresult SavePatch(Steinberg::IBStream *stream);
 
+ private:
+  Steinberg::tresult LoadPatchRecord(
+      Steinberg::IBStreamer &streamer,
+      Steinberg::Vst::IEditController *edit_controller);
 };  // namespace PatchController
 
 }  // namespace sidebands
\ No newline at end of file
@@ -1,12 +1,13 @@
 #define NOMINMAX
 #include "controller/sidebands_controller.h"
 
-#include <absl/strings/str_format.h>
 #include <glog/logging.h>
 #include <pluginterfaces/base/ustring.h>
 
+#include <cstdio>
+#include <iterator>
+
 #include "controller/patch_controller.h"
-#include "dsp/fft.h"
 #include "globals.h"
 #include "sidebands_cids.h"
 #include "tags.h"
@@ -72,12 +73,49 @@ void SidebandsControllerBindings::Bind(vstwebview::Webview *webview) {
                                sidebands::kResponseSpectrumBufferMessageID,
                                buffer_attrs /**/
   );
+  message_listener_->Subscribe("receiveMessage",
+                               sidebands::kResponseLiveScopeMessageID,
+                               buffer_attrs);
+  message_listener_->Subscribe("receiveMessage",
+                               sidebands::kResponseLiveSpectrumMessageID,
+                               buffer_attrs);
+  message_listener_->Subscribe("receiveMessage",
+                               sidebands::kResponseDspLoadMessageID,
+                               buffer_attrs);
+  message_listener_->Subscribe(
+      "receiveMessage", sidebands::kResponseSpectrogramMessageID,
+      {
+          {
+              kWidthAttr,
+              vstwebview::WebviewMessageListener::MessageAttribute::Type::INT,
+          },
+          {
+              kHeightAttr,
+              vstwebview::WebviewMessageListener::MessageAttribute::Type::INT,
+          },
+          {
+              kProgressAttr,
+              vstwebview::WebviewMessageListener::MessageAttribute::Type::INT,
+          },
+          {
+              kVersionAttr,
+              vstwebview::WebviewMessageListener::MessageAttribute::Type::INT,
+          },
+          {
+              kBufferSizeAttr,
+              vstwebview::WebviewMessageListener::MessageAttribute::Type::INT,
+          },
+          {
+              kBufferDataAttr,
+              vstwebview::WebviewMessageListener::MessageAttribute::Type::
+                  BINARY,
+          },
+      });
 }
 
 // static
 Steinberg::FUnknown *SidebandsController::Instantiate(void *) {
-  google::InitGoogleLogging("sidebands");
-  FLAGS_stderrthreshold = 0;
+  InitProcess();
 
   return (Steinberg::Vst::IEditController *)new SidebandsController;
 }
@@ -93,9 +131,10 @@ tresult PLUGIN_API SidebandsController::initialize(FUnknown *context) {
     Steinberg::Vst::UnitInfo unitInfo;
     unitInfo.id = MakeUnitID(UNIT_GENERATOR, g);
     unitInfo.parentUnitId = Steinberg::Vst::kRootUnitId;
-    std::string full_name = absl::StrFormat("Generator Unit %d", g);
+    char name[std::size(unitInfo.name)];
+    std::snprintf(name, sizeof(name), "Generator Unit %d", g);
     Steinberg::UString(unitInfo.name, USTRINGSIZE(unitInfo.name))
-        .assign(USTRING(full_name.c_str()));
+        .assign(USTRING(name));
     unitInfo.programListId = Steinberg::Vst::kNoProgramListId;
     Steinberg::Vst::Unit *unit = new Steinberg::Vst::Unit(unitInfo);
     addUnit(unit);
@@ -198,60 +237,12 @@ Steinberg::tresult SidebandsController::endEditFromHost(
   return endEdit(paramID);
 }
 
-Steinberg::tresult SidebandsController::ProduceFFTResponseMessageFor(
-    Steinberg::Vst::IMessage *message) {
-  auto analysis_attrs = message->getAttributes();
-  int64 sample_rate, buffer_size, analysis_note, gennum;
-  if (analysis_attrs->getInt(kSampleRateAttr, sample_rate) !=
-      Steinberg::kResultOk)
-    return Steinberg::kResultFalse;
-  if (analysis_attrs->getInt(kBufferSizeAttr, buffer_size) !=
-      Steinberg::kResultOk)
-    return Steinberg::kResultFalse;
-  if (analysis_attrs->getInt(kFreqAttr, analysis_note) != Steinberg::kResultOk)
-    return Steinberg::kResultFalse;
-  if (analysis_attrs->getInt(kGennumAttr, gennum) != Steinberg::kResultOk)
-    return Steinberg::kResultFalse;
-
-  const double *buffer_data;
-  uint32 buffer_data_size;
-  if (analysis_attrs->getBinary(kBufferDataAttr, (const void *&)buffer_data,
-                                buffer_data_size) != Steinberg::kResultOk)
-    return Steinberg::kResultFalse;
-  auto fft_buffer =
-      ScalarToComplex(buffer_data, buffer_data_size / sizeof(double));
-  HanningWindow(fft_buffer);
-  FFT(fft_buffer);
-  size_t sbuffer_size = fft_buffer.size() / 2;
-  std::valarray<double> sbuffer(sbuffer_size);
-  for (int i = 0; i < sbuffer_size; i++) {
-    sbuffer[i] = std::abs(fft_buffer[i]);
-  }
-  sbuffer = sbuffer / (sbuffer.max() / 2);
-  sbuffer -= 1;
-  analysis_attrs->setBinary(kBufferDataAttr, &sbuffer[0],
-                            sbuffer_size * sizeof(double));
-  analysis_attrs->setInt(kBufferSizeAttr, sbuffer_size);
-  analysis_attrs->setInt(kGennumAttr, gennum);
-
-  return Steinberg::kResultTrue;
-}
-
 Steinberg::tresult SidebandsController::notify(
     Steinberg::Vst::IMessage *message) {
   auto *ml = sidebands_controller_bindings_->message_listener();
   if (!ml) return ComponentBase::notify(message);
 
-  tresult res;
-
-  // Intercept buffer responses for spectrum and transform it to provide an FFT.
-  if (FIDStringsEqual(message->getMessageID(),
-                      kResponseSpectrumBufferMessageID)) {
-    res = ProduceFFTResponseMessageFor(message);
-    if (res != Steinberg::kResultOk) return res;
-  }
-
-  res = ml->Notify(message);
+  tresult res = ml->Notify(message);
   if (res != Steinberg::kResultOk) return ComponentBase::notify(message);
   return res;
 }
@@ -75,9 +75,6 @@ class SidebandsController : public Steinberg::Vst::EditControllerEx1,
   DELEGATE_REFCOUNT(EditController)
 
  private:
-  Steinberg::tresult ProduceFFTResponseMessageFor(
-      Steinberg::Vst::IMessage *message);
-
   std::unique_ptr<PatchController> patch_controller_;
   Steinberg::ViewRect view_rect_{0, 0, 1024, 1200};
   std::unique_ptr<vstwebview::WebviewControllerBindings>
@@ -1,4 +1,4 @@
-export const kNumGenerators = 8;
+export const kNumGenerators = 32;
 
 export enum ParamTag {
     TAG_GENERATOR_SELECT,
@@ -20,6 +20,11 @@ export enum ParamTag {
     TAG_LFO_VS,
     TAG_LFO_TYPE,
     TAG_MODULATIONS,
+    TAG_POLYPHONY,
+    TAG_VOICE_LAYOUT,
+    TAG_BAKED_WAVETABLES,
+    TAG_PATCH_FADE,
+    TAG_DSP_LOAD,
 }
 
 export enum TargetTag {
@@ -73,3 +78,42 @@ export interface AnalysisBufferMessage {
     bufferData: Float64Array;
 }
 
+// Spectrum responses carry one value per column of the view: the loudest
+// partial in it, in dB relative to the loudest overall.
+export interface SpectrumBufferMessage {
+    messageID: string;
+    sampleRate: number;
+    bufferSize: number;
+    frequency: number;
+    gennum: number;
+    bufferData: Float32Array;
+}
+
+// A note's spectrogram: `width` frames of `height` rows of dBFS, or while it's
+// being rendered, no data and the progress so far.
+export interface SpectrogramMessage {
+    messageID: string;
+    width: number;
+    height: number;
+    progress: number;
+    version: number;
+    bufferSize: number;
+    bufferData: Float32Array;
+}
+
+// Floor of the dB values in spectrum responses; matches kSilenceThresholdDb.
+export const kSpectrumFloorDb = -96;
+
+// DSP load responses: mean, 99th percentile and maximum, in percent of the
+// time each block has to be rendered in, for process(), the player, a single
+// voice, and then each generator in turn. Match kDspLoadStatsPerPart and
+// kDspLoadParts.
+export const kDspLoadStatsPerPart = 3;
+export const kDspLoadParts = 3;
+
+export interface DspLoadMessage {
+    messageID: string;
+    bufferSize: number;
+    bufferData: Float32Array;
+}
+
@@ -0,0 +1,91 @@
+import {DspLoadMessage, kDspLoadParts, kDspLoadStatsPerPart, kNumGenerators} from "../model/sidebands_model";
+import {MakeHarmonicsView} from "./templates";
+import {GeneratorView} from "./views";
+import {controller, IMsgSubscriber, Message} from "../model/vst_model";
+
+// How often to ask for the load. Each answer covers the blocks since the last,
+// and the processor only times voices and generators while it's being asked.
+const kPollIntervalMs = 500;
+// Generator bars fill the view at this load, in percent.
+const kGeneratorScalePercent = 25;
+
+// Load meter: how much of the time it has for each block the processor spends
+// rendering it, and below, a bar for what each generator costs across all
+// voices, its mean solid and its 99th percentile as a tick.
+export class DspLoadView implements GeneratorView, IMsgSubscriber {
+    private canvas: HTMLCanvasElement | null;
+    private selectedGenerator = 0;
+    private last: DspLoadMessage | null = null;
+
+    constructor(readonly element: HTMLDivElement, readonly title: string) {
+        element.appendChild(MakeHarmonicsView());
+        this.canvas = element.querySelector('.graph-harmonics-canvas');
+        controller.subscribeMessage("kResponseDspLoadMessageID", this);
+        window.setInterval(() => this.refresh(), kPollIntervalMs);
+    }
+
+    notify(messageId: string, message: Message): void {
+        this.last = <DspLoadMessage>message;
+        this.draw();
+    }
+
+    private stat(part: number, stat: number): number {
+        if (!this.last) return 0;
+        return this.last.bufferData[part * kDspLoadStatsPerPart + stat] || 0;
+    }
+
+    private draw() {
+        if (!this.canvas) return;
+        let ctx = this.canvas.getContext("2d");
+        if (!ctx) return;
+        const width = this.canvas.width;
+        const height = this.canvas.height;
+        ctx.clearRect(0, 0, width, height);
+        ctx.font = "16px atari_st";
+        ctx.fillStyle = "#1e2a96";
+        ctx.strokeStyle = "#1e2a96";
+
+        // Overall load, as a bar across the top.
+        const load = this.stat(0, 0);
+        ctx.fillRect(12, 28, Math.min(1, load / 100) * (width - 24), 8);
+        ctx.fillText(this.title, width - ctx.measureText(this.title).width - 12, 20);
+        const f = (v: number) => v.toFixed(1);
+        ctx.font = "12px atari_st";
+        ctx.fillText(`${f(load)}% p99 ${f(this.stat(0, 1))}% max ${f(this.stat(0, 2))}%`, 12, 20);
+        ctx.fillText(`voice ${f(this.stat(2, 0))}% p99 ${f(this.stat(2, 1))}%`, 12, 52);
+
+        // Each generator, the selected one labelled.
+        const top = 60;
+        const barsHeight = height - top - 4;
+        const barWidth = (width - 24) / kNumGenerators;
+        for (let g = 0; g < kNumGenerators; g++) {
+            const part = kDspLoadParts + g;
+            const x = 12 + g * barWidth;
+            const mean = Math.min(1, this.stat(part, 0) / kGeneratorScalePercent);
+            const p99 = Math.min(1, this.stat(part, 1) / kGeneratorScalePercent);
+            ctx.globalAlpha = g == this.selectedGenerator ? 1 : 0.6;
+            ctx.fillRect(x, top + barsHeight * (1 - mean), barWidth - 1, barsHeight * mean);
+            ctx.beginPath();
+            ctx.moveTo(x, top + barsHeight * (1 - p99));
+            ctx.lineTo(x + barWidth - 1, top + barsHeight * (1 - p99));
+            ctx.stroke();
+        }
+        ctx.globalAlpha = 1;
+        const selected = kDspLoadParts + this.selectedGenerator;
+        const label = `gen ${this.selectedGenerator + 1} ${f(this.stat(selected, 0))}%`;
+        ctx.fillText(label, width - ctx.measureText(label).width - 12, 52);
+    }
+
+    refresh() {
+        controller.sendMessage("kRequestDspLoadMessageID", {});
+    }
+
+    node(): HTMLElement {
+        return this.element;
+    }
+
+    updateSelectedGenerator(gennum: number): void {
+        this.selectedGenerator = gennum;
+        this.draw();
+    }
+}
@@ -1,5 +1,12 @@
 import * as Model from "../model/sidebands_model";
-import {AnalysisBufferMessage, kNumGenerators, ParamIDFor, ParamTag} from "../model/sidebands_model";
+import {
+    AnalysisBufferMessage,
+    kNumGenerators,
+    kSpectrumFloorDb,
+    ParamIDFor,
+    ParamTag,
+    SpectrumBufferMessage
+} from "../model/sidebands_model";
 import {MakeHarmonicsView} from "./templates";
 import {GeneratorView} from "./views";
 import {controller, IDependent, IMsgSubscriber, IParameter, Message} from "../model/vst_model";
@@ -45,8 +52,12 @@ export class HarmonicsAnaylsisView implements GeneratorView, IDependent, IMsgSub
         this.refresh();
     }
 
+    private isSpectrum(): boolean {
+        return this.requestMsgId == "kRequestSpectrumBufferMessageID";
+    }
+
     notify(messageId: string, message: Message): void {
-        const msg = <AnalysisBufferMessage>message;
+        const msg = <AnalysisBufferMessage | SpectrumBufferMessage>message;
         if (msg.gennum != this.gennum) return;
         if (!this.canvas) return;
         let ctx = this.canvas.getContext("2d");
@@ -60,8 +71,11 @@ export class HarmonicsAnaylsisView implements GeneratorView, IDependent, IMsgSub
         const scalefactor = this.canvas.width / msg.bufferSize;
         for (let i = 0; i < msg.bufferData.length; i++) {
             const x = i * scalefactor;
-            const y = msg.bufferData[i] * this.canvas.height / 2;
-            ctx.lineTo(x, (this.canvas.height / 2) - y);
+            // Spectra come in dB, from the floor at the bottom to 0 at the top.
+            const y = this.isSpectrum()
+                ? (1 - msg.bufferData[i] / kSpectrumFloorDb) * this.canvas.height
+                : (this.canvas.height / 2) + msg.bufferData[i] * this.canvas.height / 2;
+            ctx.lineTo(x, this.canvas.height - y);
         }
         ctx.stroke();
         ctx.font = "16px atari_st";
@@ -70,6 +84,19 @@ export class HarmonicsAnaylsisView implements GeneratorView, IDependent, IMsgSub
     }
 
     refresh() {
+        if (this.isSpectrum()) {
+            // The processor reduces the spectrum to one value per pixel.
+            controller.sendMessage(this.requestMsgId,
+                {
+                    sampleRate: 32768,
+                    gennum: this.gennum,
+                    bufferSize: 1024,
+                    frequency: this.frequency,
+                    width: this.canvas ? this.canvas.width : 512,
+                    logAxis: 1
+                });
+            return;
+        }
         controller.sendMessage(this.requestMsgId,
             {
                 sampleRate: 32768,
@@ -0,0 +1,67 @@
+import {kSpectrumFloorDb, SpectrumBufferMessage} from "../model/sidebands_model";
+import {MakeHarmonicsView} from "./templates";
+import {GeneratorView} from "./views";
+import {controller, IMsgSubscriber, Message} from "../model/vst_model";
+
+// Frames per second asked of the processor's live analyser.
+const kLiveFrameRate = 30;
+
+// Scope or spectrum of what the synth is actually playing. Polls the processor
+// while the view exists; the processor stops listening to its output once the
+// polls stop.
+export class LiveAnalysisView implements GeneratorView, IMsgSubscriber {
+    private canvas: HTMLCanvasElement | null;
+    private timer: number;
+
+    constructor(readonly element: HTMLDivElement, readonly spectrum: boolean,
+                readonly title: string) {
+        element.appendChild(MakeHarmonicsView());
+        this.canvas = element.querySelector('.graph-harmonics-canvas');
+        controller.subscribeMessage(
+            spectrum ? "kResponseLiveSpectrumMessageID" : "kResponseLiveScopeMessageID", this);
+        this.timer = window.setInterval(() => this.refresh(), 1000 / kLiveFrameRate);
+    }
+
+    notify(messageId: string, message: Message): void {
+        const msg = <SpectrumBufferMessage>message;
+        if (!this.canvas) return;
+        let ctx = this.canvas.getContext("2d");
+        if (!ctx) return;
+        const height = this.canvas.height;
+        ctx.imageSmoothingEnabled = false;
+        ctx.clearRect(0, 0, this.canvas.width, height);
+        ctx.beginPath();
+        ctx.lineWidth = 1;
+        ctx.strokeStyle = "#1e2a96";
+        ctx.moveTo(0, this.spectrum ? height : height / 2);
+        const scalefactor = this.canvas.width / msg.bufferSize;
+        for (let i = 0; i < msg.bufferData.length; i++) {
+            const x = i * scalefactor;
+            // Spectra come in dBFS, from the floor at the bottom to 0 at the top.
+            const y = this.spectrum
+                ? (1 - msg.bufferData[i] / kSpectrumFloorDb) * height
+                : (height / 2) + msg.bufferData[i] * height / 2;
+            ctx.lineTo(x, height - y);
+        }
+        ctx.stroke();
+        ctx.font = "16px atari_st";
+        ctx.fillStyle = "#1e2a96";
+        ctx.fillText(this.title, this.canvas.width - ctx.measureText(this.title).width - 12, 20);
+    }
+
+    refresh() {
+        const width = this.canvas ? this.canvas.width : 512;
+        if (this.spectrum) {
+            controller.sendMessage("kRequestLiveSpectrumMessageID", {width: width, logAxis: 1});
+        } else {
+            controller.sendMessage("kRequestLiveScopeMessageID", {bufferSize: width});
+        }
+    }
+
+    node(): HTMLElement {
+        return this.element;
+    }
+
+    updateSelectedGenerator(gennum: number): void {
+    }
+}
@@ -6,6 +6,9 @@ import * as Env from "./envelope_editor_view";
 import {GD, GeneratorView, View} from "./views";
 import {addTab, GeneratorTabView} from "./generator_tab_view";
 import * as Viz from './harmonics_analysis_view';
+import {LiveAnalysisView} from "./live_analysis_view";
+import {SpectrogramView} from "./spectrogram_view";
+import {DspLoadView} from "./dsp_load_view";
 import {Switch} from "./switch";
 
 export class MainView implements View {
@@ -44,6 +47,18 @@ export class MainView implements View {
                     "kRequestSpectrumBufferMessageID", "kResponseSpectrumBufferMessageID",
                     256, "Spectrum")
             );
+        let live_scope_area = GD("live-scope-visual");
+        if (live_scope_area)
+            this.subViews.push(new LiveAnalysisView(<HTMLDivElement>live_scope_area, false, "Scope"));
+        let live_spectrum_area = GD("live-spectrum-visual");
+        if (live_spectrum_area)
+            this.subViews.push(new LiveAnalysisView(<HTMLDivElement>live_spectrum_area, true, "Analyser"));
+        let spectrogram_area = GD("spectrogram-visual");
+        if (spectrogram_area)
+            this.subViews.push(new SpectrogramView(<HTMLDivElement>spectrogram_area, "Note"));
+        let dsp_load_area = GD("dsp-load-visual");
+        if (dsp_load_area)
+            this.subViews.push(new DspLoadView(<HTMLDivElement>dsp_load_area, "DSP"));
 
 
         VstModel.controller.getSelectedUnit().then(selectedUnit => {
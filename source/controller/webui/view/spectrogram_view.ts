@@ -0,0 +1,100 @@
+import {kSpectrumFloorDb, SpectrogramMessage} from "../model/sidebands_model";
+import {MakeHarmonicsView} from "./templates";
+import {GeneratorView} from "./views";
+import {controller, IMsgSubscriber, Message} from "../model/vst_model";
+
+// How often to ask after the spectrogram. Answers are empty unless the patch
+// has changed since the last frames, or while they're being rendered.
+const kPollIntervalMs = 250;
+const kNote = 60;
+const kHoldMs = 1500;
+const kReleaseMs = 1500;
+
+// Spectrogram of one whole note, from note-on through its release: time
+// across, frequency up on a log axis, louder is darker.
+export class SpectrogramView implements GeneratorView, IMsgSubscriber {
+    private canvas: HTMLCanvasElement | null;
+    private version = -1;
+    private progress = 100;
+    private image: ImageData | null = null;
+
+    constructor(readonly element: HTMLDivElement, readonly title: string) {
+        element.appendChild(MakeHarmonicsView());
+        this.canvas = element.querySelector('.graph-harmonics-canvas');
+        controller.subscribeMessage("kResponseSpectrogramMessageID", this);
+        window.setInterval(() => this.refresh(), kPollIntervalMs);
+        // Nobody will want a render still in progress once the editor closes.
+        window.addEventListener("beforeunload", () =>
+            controller.sendMessage("kCancelSpectrogramMessageID", {}));
+        this.refresh();
+    }
+
+    notify(messageId: string, message: Message): void {
+        const msg = <SpectrogramMessage>message;
+        if (!this.canvas) return;
+        let ctx = this.canvas.getContext("2d");
+        if (!ctx) return;
+        const frames = msg.bufferSize && msg.bufferData;
+        if (!frames && msg.progress == this.progress) return;
+        this.progress = msg.progress;
+        if (frames) {
+            this.version = msg.version;
+            this.image = ctx.createImageData(msg.width, msg.height);
+            for (let x = 0; x < msg.width; x++) {
+                for (let y = 0; y < msg.height; y++) {
+                    const db = msg.bufferData[x * msg.height + y];
+                    const level = Math.max(0, Math.min(1, 1 - db / kSpectrumFloorDb));
+                    // Low frequencies at the bottom.
+                    const pixel = ((msg.height - 1 - y) * msg.width + x) * 4;
+                    this.image.data[pixel] = 0x1e;
+                    this.image.data[pixel + 1] = 0x2a;
+                    this.image.data[pixel + 2] = 0x96;
+                    this.image.data[pixel + 3] = Math.round(level * 255);
+                }
+            }
+        }
+        ctx.clearRect(0, 0, this.canvas.width, this.canvas.height);
+        if (this.image) {
+            createImageBitmap(this.image).then((bitmap) => {
+                if (!this.canvas) return;
+                let ctx = this.canvas.getContext("2d");
+                if (!ctx) return;
+                ctx.drawImage(bitmap, 0, 0, this.canvas.width, this.canvas.height);
+                this.drawTitle(ctx);
+            });
+        } else {
+            this.drawTitle(ctx);
+        }
+    }
+
+    private drawTitle(ctx: CanvasRenderingContext2D) {
+        if (!this.canvas) return;
+        const title = this.progress < 100 ? `${this.title} ${this.progress}%` : this.title;
+        ctx.font = "16px atari_st";
+        ctx.fillStyle = "#1e2a96";
+        ctx.fillText(title, this.canvas.width - ctx.measureText(title).width - 12, 20);
+    }
+
+    refresh() {
+        const width = this.canvas ? this.canvas.width : 256;
+        const height = this.canvas ? this.canvas.height : 128;
+        controller.sendMessage("kRequestSpectrogramMessageID",
+            {
+                note: kNote,
+                holdMs: kHoldMs,
+                releaseMs: kReleaseMs,
+                sampleRate: 48000,
+                width: width,
+                height: height,
+                logAxis: 1,
+                version: this.version
+            });
+    }
+
+    node(): HTMLElement {
+        return this.element;
+    }
+
+    updateSelectedGenerator(gennum: number): void {
+    }
+}
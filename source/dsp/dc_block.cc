@@ -27,11 +27,12 @@ DCBlock2::DCBlock2(int order)
       dp2_(0),
       scaler_(1.0 / order) {}
 
-void DCBlock2::Filter(OscBuffer &in) {
+void DCBlock2::Filter(OscBuffer &in) { Filter(std::begin(in), in.size()); }
+
+void DCBlock2::Filter(double *in, size_t bufsize) {
   {
     size_t del1size = delay1_.size();
     size_t iirdelsize = iirdelay1_.size();
-    size_t bufsize = in.size();
 
     OscBuffer *iirdel[]{&iirdelay1_, &iirdelay2_, &iirdelay3_, &iirdelay4_};
     double x1, x2, y, del;
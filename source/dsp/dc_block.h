@@ -16,6 +16,7 @@ struct DCBlock2 {
   explicit DCBlock2(int order = 128);
 
   void Filter(OscBuffer &in);
+  void Filter(double *in, size_t bufsize);
 
   OscBuffer delay1_;
   OscBuffer iirdelay1_;
@@ -1,6 +1,9 @@
 #include "dsp/fft.h"
 
+#include <glog/logging.h>
+
 #include <numbers>
+#include <utility>
 
 #include "dsp/oscbuffer.h"
 
@@ -96,4 +99,38 @@ void BlackingWindow(ComplexBuffer &buf) {
     buf[i] *= multiplier;
   }
 }
+
+FFTPlan::FFTPlan(size_t size) : twiddles_(size / 2), bit_reverse_(size) {
+  CHECK(size && (size & (size - 1)) == 0) << "FFT size must be a power of 2";
+  for (size_t k = 0; k < size / 2; k++)
+    twiddles_[k] = std::polar(1.0, -2 * std::numbers::pi * k / size);
+  int bits = 0;
+  while ((size_t(1) << bits) < size) bits++;
+  for (size_t i = 0; i < size; i++) {
+    uint32_t reversed = 0;
+    for (int b = 0; b < bits; b++) reversed |= ((i >> b) & 1) << (bits - 1 - b);
+    bit_reverse_[i] = reversed;
+  }
+}
+
+void FFTPlan::Forward(ComplexBuffer &x) const {
+  const size_t n = size();
+  CHECK_EQ(x.size(), n);
+  for (size_t i = 0; i < n; i++) {
+    if (bit_reverse_[i] > i) std::swap(x[i], x[bit_reverse_[i]]);
+  }
+  // Iterative radix-2 decimation in time.
+  for (size_t length = 2; length <= n; length *= 2) {
+    const size_t half = length / 2;
+    const size_t stride = n / length;
+    for (size_t start = 0; start < n; start += length) {
+      for (size_t k = 0; k < half; k++) {
+        const Complex t = twiddles_[k * stride] * x[start + k + half];
+        x[start + k + half] = x[start + k] - t;
+        x[start + k] += t;
+      }
+    }
+  }
+}
+
 }  // namespace sidebands
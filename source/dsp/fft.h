@@ -1,7 +1,9 @@
 #pragma once
 
 #include <complex>
+#include <cstdint>
 #include <valarray>
+#include <vector>
 
 using Complex = std::complex<double>;
 using ComplexBuffer = std::valarray<Complex>;
@@ -16,4 +18,20 @@ void HanningWindow(ComplexBuffer &buf);
 void HammingWindow(ComplexBuffer &buf);
 void BlackingWindow(ComplexBuffer &buf);
 
+// A forward FFT of one power-of-two size, with its twiddle factors and
+// bit-reversal permutation worked out once up front, for transforming a stream
+// of frames.
+class FFTPlan {
+ public:
+  explicit FFTPlan(size_t size);
+
+  size_t size() const { return bit_reverse_.size(); }
+  // In place; `x` must be size() long.
+  void Forward(ComplexBuffer &x) const;
+
+ private:
+  std::vector<Complex> twiddles_;
+  std::vector<uint32_t> bit_reverse_;
+};
+
 }  // namespace sidebands
\ No newline at end of file
@@ -2,22 +2,24 @@
 
 namespace sidebands {
 
-void Integrator::Filter(OscBuffer &buf) {
+void Integrator::Filter(OscBuffer &buf) { Filter(std::begin(buf), buf.size()); }
+
+void Integrator::Filter(double *buf, size_t size) {
   double b1 = b1_;
   double y1 = y1_;
 
   if (b1 == 1.f) {
-    for (int i = 0; i < buf.size(); i++) {
+    for (size_t i = 0; i < size; i++) {
       double y0 = buf[i];
       buf[i] = y1 = y0 + y1;
     }
   } else if (b1 == 0.f) {
-    for (int i = 0; i < buf.size(); i++) {
+    for (size_t i = 0; i < size; i++) {
       double y0 = buf[i];
       buf[i] = y1 = y0 + b1 * y1;
     }
   } else {
-    for (int i = 0; i < buf.size(); i++) {
+    for (size_t i = 0; i < size; i++) {
       double y0 = buf[i];
       buf[i] = y1 = y0 + b1 * y1;
     }
@@ -7,6 +7,7 @@ namespace sidebands {
 struct Integrator {
   explicit Integrator(double b = 0.998) : b1_(b) {}
   void Filter(OscBuffer &buf);
+  void Filter(double *buf, size_t size);
   double b1_ = 0.0;
   double y1_ = 0.f;
 };
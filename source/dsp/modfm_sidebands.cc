@@ -0,0 +1,57 @@
+#include "dsp/modfm_sidebands.h"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace sidebands {
+
+namespace {
+
+constexpr int kMaxSeriesTerms = 1000;
+constexpr double kNegligibleTerm = 1e-18;
+
+// log(|x|^m / m!), for m > 0 and x != 0.
+double LogPowerOverFactorial(double x, int m) {
+  return m * std::log(std::abs(x)) - std::lgamma(m + 1.0);
+}
+
+}  // namespace
+
+double ModFMSideband(int n, double k, double r, double s) {
+  // Writing z = exp(i wm t), the exponent is a z + b / z with these two, and
+  // the coefficient of z^n in exp(a z) exp(b / z) is
+  //
+  //   sum over j of a^(n + j) b^j / ((n + j)! j!),
+  //
+  // which for a = b = K / 2 is the series for I_n(K). Terms are summed in log
+  // form with exp(-K) folded in, so large indexes neither overflow nor
+  // underflow.
+  const double a = k * (r + s) / 2;
+  const double b = k * (r - s) / 2;
+  const int first = n < 0 ? -n : 0;
+  double sum = 0;
+  for (int j = first; j < first + kMaxSeriesTerms; j++) {
+    const int a_power = n + j;
+    const int b_power = j;
+    if ((a_power > 0 && a == 0) || (b_power > 0 && b == 0)) break;
+    double log_term = -k;
+    bool negative = false;
+    if (a_power > 0) {
+      log_term += LogPowerOverFactorial(a, a_power);
+      negative ^= a < 0 && a_power % 2;
+    }
+    if (b_power > 0) {
+      log_term += LogPowerOverFactorial(b, b_power);
+      negative ^= b < 0 && b_power % 2;
+    }
+    const double term = std::exp(log_term);
+    sum += negative ? -term : term;
+    // Terms shrink for good once the factorials outgrow |a b|.
+    if (double(a_power + 1) * (b_power + 1) > std::abs(a * b) &&
+        term < kNegligibleTerm)
+      break;
+  }
+  return sum;
+}
+
+}  // namespace sidebands
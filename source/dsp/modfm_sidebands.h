@@ -0,0 +1,14 @@
+#pragma once
+
+namespace sidebands {
+
+// Amplitude of sideband `n` of the ModFM waveform
+//
+//   exp(R K cos(wm t)) cos(wc t + S K sin(wm t)) / exp(K)
+//
+// that is, of the partial at wc + n wm. With R = 1 and S = 0 this is the
+// classic exp(-K) I_n(K), I_n being the modified Bessel function of the first
+// kind.
+double ModFMSideband(int n, double k, double r, double s);
+
+}  // namespace sidebands
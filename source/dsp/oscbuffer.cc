@@ -10,15 +10,21 @@
 namespace sidebands {
 
 namespace {
+
+// The helpers below work 8 doubles at a time. Buffers needn't be a multiple of
+// 8 long, since slices end wherever an event or automation point falls, so the
+// remainder goes through partial loads and stores.
+
 OscBuffer VapplyUnary(const OscBuffer &src,
                       const std::function<Vec8d(const Vec8d &)> &f) {
-  size_t size(src.size());
+  int size(src.size());
   OscBuffer dest(size);
   Vec8d src_vec, dst_vec;
   for (int i = 0; i < size; i += 8) {
-    src_vec.load(&(src[i]));
+    int n = std::min(8, size - i);
+    src_vec.load_partial(n, &(src[i]));
     dst_vec = f(src_vec);
-    dst_vec.store(&(dest[i]));
+    dst_vec.store_partial(n, &(dest[i]));
   }
   return dest;
 }
@@ -26,54 +32,59 @@ OscBuffer VapplyUnary(const OscBuffer &src,
 void VapplyBinaryInplace(
     OscBuffer &l, const OscBuffer &r,
     const std::function<Vec8d(const Vec8d &, const Vec8d &)> &f) {
-  size_t size(l.size());
+  int size(l.size());
   Vec8d l_vec, r_vec, dst_vec;
   for (int i = 0; i < size; i += 8) {
-    l_vec.load(&(l[i]));
-    r_vec.load(&(r[i]));
+    int n = std::min(8, size - i);
+    l_vec.load_partial(n, &(l[i]));
+    r_vec.load_partial(n, &(r[i]));
     dst_vec = f(l_vec, r_vec);
-    dst_vec.store(&(l[i]));
+    dst_vec.store_partial(n, &(l[i]));
   }
 }
 
 void VapplyBinaryInplace(OscBuffer &l, double r,
                          const std::function<Vec8d(const Vec8d &, double)> &f) {
-  size_t size(l.size());
+  int size(l.size());
   Vec8d l_vec, dst_vec;
   for (int i = 0; i < size; i += 8) {
-    l_vec.load(&(l[i]));
+    int n = std::min(8, size - i);
+    l_vec.load_partial(n, &(l[i]));
     dst_vec = f(l_vec, r);
-    dst_vec.store(&(l[i]));
+    dst_vec.store_partial(n, &(l[i]));
   }
 }
 
 OscBuffer VapplyBinary(
     const OscBuffer &l, const OscBuffer &r,
     const std::function<Vec8d(const Vec8d &, const Vec8d &)> &f) {
-  size_t size(l.size());
+  int size(l.size());
   OscBuffer dest(size);
   Vec8d l_vec, r_vec, dst_vec;
   for (int i = 0; i < size; i += 8) {
-    l_vec.load(&(l[i]));
-    r_vec.load(&(r[i]));
+    int n = std::min(8, size - i);
+    l_vec.load_partial(n, &(l[i]));
+    r_vec.load_partial(n, &(r[i]));
     dst_vec = f(l_vec, r_vec);
-    dst_vec.store(&(dest[i]));
+    dst_vec.store_partial(n, &(dest[i]));
   }
   return dest;
 }
 
 OscBuffer VapplyBinary(const OscBuffer &l, double r,
                        const std::function<Vec8d(const Vec8d &, double)> &f) {
-  size_t size(l.size());
+  int size(l.size());
   OscBuffer dest(size);
   Vec8d l_vec, dst_vec;
   for (int i = 0; i < size; i += 8) {
-    l_vec.load(&(l[i]));
+    int n = std::min(8, size - i);
+    l_vec.load_partial(n, &(l[i]));
     dst_vec = f(l_vec, r);
-    dst_vec.store(&(dest[i]));
+    dst_vec.store_partial(n, &(dest[i]));
   }
   return dest;
 }
+
 }  // namespace
 
 OscBuffer Vsin(const OscBuffer &src) {
@@ -125,13 +136,31 @@ OscBuffer Vadd(const OscBuffer &l, double r) {
 }
 
 void VaddInplace(OscBuffer &l, const OscBuffer &r) {
-  VapplyBinaryInplace(l, r,
-                      [](const Vec8d &l, const Vec8d &r) { return l + r; });
+  VaddInplace(std::begin(l), std::begin(r), l.size());
+}
+
+void VaddInplace(double *l, const double *r, size_t size) {
+  Vec8d l_vec, r_vec;
+  for (size_t i = 0; i < size; i += 8) {
+    int n = std::min<size_t>(8, size - i);
+    l_vec.load_partial(n, l + i);
+    r_vec.load_partial(n, r + i);
+    (l_vec + r_vec).store_partial(n, l + i);
+  }
 }
 
 void VmulInplace(OscBuffer &l, const OscBuffer &r) {
-  VapplyBinaryInplace(l, r,
-                      [](const Vec8d &l, const Vec8d &r) { return l * r; });
+  VmulInplace(std::begin(l), std::begin(r), l.size());
+}
+
+void VmulInplace(double *l, const double *r, size_t size) {
+  Vec8d l_vec, r_vec;
+  for (size_t i = 0; i < size; i += 8) {
+    int n = std::min<size_t>(8, size - i);
+    l_vec.load_partial(n, l + i);
+    r_vec.load_partial(n, r + i);
+    (l_vec * r_vec).store_partial(n, l + i);
+  }
 }
 
 void VdivInplace(OscBuffer &l, const OscBuffer &r) {
@@ -144,6 +173,52 @@ void VsubInplace(OscBuffer &l, const OscBuffer &r) {
                       [](const Vec8d &l, const Vec8d &r) { return l - r; });
 }
 
+void VmulAddInplace(OscBuffer &acc, const OscBuffer &l, const OscBuffer &r) {
+  VmulAddInplace(std::begin(acc), std::begin(l), std::begin(r), acc.size());
+}
+
+void VmulAddInplace(double *acc, const double *l, const double *r,
+                    size_t size) {
+  Vec8d acc_vec, l_vec, r_vec;
+  for (size_t i = 0; i < size; i += 8) {
+    int n = std::min<size_t>(8, size - i);
+    acc_vec.load_partial(n, acc + i);
+    l_vec.load_partial(n, l + i);
+    r_vec.load_partial(n, r + i);
+    acc_vec = mul_add(l_vec, r_vec, acc_vec);
+    acc_vec.store_partial(n, acc + i);
+  }
+}
+
+void Vramp(OscBuffer &buffer, double start, double step) {
+  Vramp(std::begin(buffer), buffer.size(), start, step);
+}
+
+void Vramp(double *buffer, size_t size, double start, double step) {
+  const Vec8d index(0, 1, 2, 3, 4, 5, 6, 7);
+  const Vec8d start_vec(start), step_vec(step);
+  for (size_t i = 0; i < size; i += 8) {
+    int n = std::min<size_t>(8, size - i);
+    // Computed from the index rather than accumulated, so there's no drift.
+    mul_add(index + double(i), step_vec, start_vec)
+        .store_partial(n, buffer + i);
+  }
+}
+
+double Vpeak(const OscBuffer &buffer) {
+  return Vpeak(std::begin(buffer), buffer.size());
+}
+
+double Vpeak(const double *buffer, size_t size) {
+  Vec8d peak(0.0), vec;
+  for (size_t i = 0; i < size; i += 8) {
+    int n = std::min<size_t>(8, size - i);
+    vec.load_partial(n, buffer + i);
+    peak = max(peak, abs(vec));
+  }
+  return horizontal_max(peak);
+}
+
 void VaddInplace(OscBuffer &l, double r) {
   VapplyBinaryInplace(l, r,
                       [](const Vec8d &l, const Vec8d &r) { return l + r; });
@@ -165,18 +240,21 @@ void VsubInplace(OscBuffer &l, double r) {
 }
 
 void ToFloat(const OscBuffer &src, float *out_buffer) {
-  size_t size(src.size());
-  OscBuffer dest(size);
+  ToFloat(std::begin(src), src.size(), out_buffer);
+}
+
+void ToFloat(const double *src, size_t size, float *out_buffer) {
   Vec8d src_vec;
-  for (int i = 0; i < size; i += 8) {
-    src_vec.load(&(src[i]));
+  for (size_t i = 0; i < size; i += 8) {
+    int n = std::min<size_t>(8, size - i);
+    src_vec.load_partial(n, src + i);
     Vec8f dst_vec = to_float(src_vec);
-    dst_vec.store(out_buffer + i);
+    dst_vec.store_partial(n, out_buffer + i);
   }
 }
 
 void linspace(OscBuffer &linspaced, double start, double end, size_t num) {
-  double delta = (end - start) / (num - 1);
+  double delta = num > 1 ? (end - start) / (num - 1) : 0.0;
   int x = 0;
   std::generate(std::begin(linspaced), std::end(linspaced),
                 [&x, start, delta]() { return (start + delta * x++); });
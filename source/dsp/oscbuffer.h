@@ -17,10 +17,25 @@ OscBuffer Vsub(const OscBuffer &l, const OscBuffer &r);
 OscBuffer Vadd(const OscBuffer &l, const OscBuffer &r);
 
 void VaddInplace(OscBuffer &l, const OscBuffer &r);
+void VaddInplace(double *l, const double *r, size_t size);
 void VmulInplace(OscBuffer &l, const OscBuffer &r);
+void VmulInplace(double *l, const double *r, size_t size);
 void VdivInplace(OscBuffer &l, const OscBuffer &r);
 void VsubInplace(OscBuffer &l, const OscBuffer &r);
 
+// acc += l * r, for accumulating scaled signals into a mix.
+void VmulAddInplace(OscBuffer &acc, const OscBuffer &l, const OscBuffer &r);
+void VmulAddInplace(double *acc, const double *l, const double *r,
+                    size_t size);
+
+// buffer[i] = start + step * i.
+void Vramp(OscBuffer &buffer, double start, double step);
+void Vramp(double *buffer, size_t size, double start, double step);
+
+// Largest absolute value in `buffer`.
+double Vpeak(const OscBuffer &buffer);
+double Vpeak(const double *buffer, size_t size);
+
 OscBuffer Vmul(const OscBuffer &l, double r);
 OscBuffer Vdiv(const OscBuffer &l, double r);
 OscBuffer Vsub(const OscBuffer &l, double r);
@@ -32,6 +47,7 @@ void VdivInplace(OscBuffer &l, double r);
 void VsubInplace(OscBuffer &l, double r);
 
 void ToFloat(const OscBuffer &src, float *out);
+void ToFloat(const double *src, size_t size, float *out);
 
 void linspace(OscBuffer &linspaced, double start, double end, size_t num);
 
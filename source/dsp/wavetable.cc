@@ -0,0 +1,67 @@
+#include "dsp/wavetable.h"
+
+#include <glog/logging.h>
+
+#include <cmath>
+
+#include "dsp/fft.h"
+
+namespace sidebands {
+
+namespace {
+
+constexpr size_t kMaxHarmonic = Wavetable::kCycleSamples / 2;
+
+}  // namespace
+
+Wavetable::Wavetable(const OscBuffer &cycle) {
+  CHECK_EQ(cycle.size(), kCycleSamples);
+  ComplexBuffer spectrum = ScalarToComplex(&cycle[0], kCycleSamples);
+  FFT(spectrum);
+
+  for (size_t harmonics = kMaxHarmonic; harmonics >= 1; harmonics >>= 1) {
+    // Drop the bins above `harmonics`, along with their negative frequency
+    // mirrors, then take the inverse transform as conj(FFT(conj(X))) / N.
+    ComplexBuffer bins(kCycleSamples);
+    for (size_t k = 0; k < kCycleSamples; k++) {
+      if (k <= harmonics || k >= kCycleSamples - harmonics)
+        bins[k] = std::conj(spectrum[k]);
+    }
+    FFT(bins);
+    auto &level = levels_.emplace_back(kCycleSamples + 1);
+    for (size_t i = 0; i < kCycleSamples; i++)
+      level[i] = bins[i].real() / kCycleSamples;
+    level[kCycleSamples] = level[0];
+  }
+}
+
+void Wavetable::Play(double frequency, double sample_rate, double start_cycle,
+                     OscBuffer &out) const {
+  Play(frequency, sample_rate, start_cycle, std::begin(out), out.size());
+}
+
+void Wavetable::Play(double frequency, double sample_rate, double start_cycle,
+                     double *out, size_t frames) const {
+  // Pick the first level whose top harmonic is under Nyquist; at the very top
+  // of the range only the fundamental is left.
+  const double max_harmonic = sample_rate / 2 / std::abs(frequency);
+  size_t level_num = 0;
+  while (level_num + 1 < levels_.size() &&
+         double(kMaxHarmonic >> level_num) > max_harmonic)
+    level_num++;
+  const auto &level = levels_[level_num];
+
+  const double step =
+      std::fmod(frequency / sample_rate, 1.0) * double(kCycleSamples);
+  double position = (start_cycle - std::floor(start_cycle)) * kCycleSamples;
+  for (size_t i = 0; i < frames; i++) {
+    const size_t index = size_t(position);
+    const double frac = position - double(index);
+    out[i] = level[index] + frac * (level[index + 1] - level[index]);
+    position += step;
+    if (position >= kCycleSamples) position -= kCycleSamples;
+    if (position < 0) position += kCycleSamples;
+  }
+}
+
+}  // namespace sidebands
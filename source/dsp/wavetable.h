@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "dsp/oscbuffer.h"
+
+namespace sidebands {
+
+// One cycle of a periodic waveform, band limited at each octave so it can be
+// played back at any pitch without aliasing.
+class Wavetable {
+ public:
+  static constexpr size_t kCycleSamples = 2048;
+
+  // Builds the table from one cycle of kCycleSamples samples.
+  explicit Wavetable(const OscBuffer &cycle);
+
+  // Writes the waveform at `frequency` into `out`, beginning `start_cycle`
+  // cycles in. Reads the level with the most harmonics that all stay below
+  // Nyquist, interpolating linearly between samples.
+  void Play(double frequency, double sample_rate, double start_cycle,
+            OscBuffer &out) const;
+  // As above, into the first `frames` of `out`.
+  void Play(double frequency, double sample_rate, double start_cycle,
+            double *out, size_t frames) const;
+
+ private:
+  // Level l holds harmonics up to (kCycleSamples / 2) >> l, plus a copy of its
+  // first sample at the end so interpolation needn't wrap.
+  std::vector<std::vector<double>> levels_;
+};
+
+}  // namespace sidebands
@@ -1,10 +1,21 @@
 #include "globals.h"
 
+#include <glog/logging.h>
+
 #include <cmath>
+#include <mutex>
 #include <numeric>
 
 namespace sidebands {
 
+void InitProcess() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    google::InitGoogleLogging("sidebands");
+    FLAGS_stderrthreshold = 0;
+  });
+}
+
 double EnvelopeRampCoefficient(double start_level, double end_level,
                                size_t length_in_samples) {
   return 1.0 + (std::log(end_level) - std::log(start_level)) /
@@ -4,9 +4,17 @@
 
 #include <bitset>
 #include <cstddef>
+#include <cstdint>
 
 namespace sidebands {
 
+// A position on the player's running sample clock, counted from activation.
+using SamplePosition = int64_t;
+
+// Process-wide setup, such as logging, shared by every plugin instance. Each
+// instance calls it, but only the first call does anything.
+void InitProcess();
+
 // Calculate exponential ramping coefficient for envelope stages.
 double EnvelopeRampCoefficient(double start_level, double end_level,
                                size_t length_in_samples);
@@ -20,6 +28,33 @@ constexpr const char *kRequestSpectrumBufferMessageID =
 constexpr const char *kResponseSpectrumBufferMessageID =
     "kResponseSpectrumBufferMessageID";
 constexpr const char *kEnvelopeStageMessageID = "kEnvelopeStageMessageID";
+// What the synth is actually playing, rather than a one-off render of the
+// patch.
+constexpr const char *kRequestLiveScopeMessageID = "kRequestLiveScopeMessageID";
+constexpr const char *kResponseLiveScopeMessageID =
+    "kResponseLiveScopeMessageID";
+constexpr const char *kRequestLiveSpectrumMessageID =
+    "kRequestLiveSpectrumMessageID";
+constexpr const char *kResponseLiveSpectrumMessageID =
+    "kResponseLiveSpectrumMessageID";
+// Spectrogram of a whole note, rendered in the background. Requests are
+// answered straight away, with the frames once they're ready and with the
+// progress until then.
+constexpr const char *kRequestSpectrogramMessageID =
+    "kRequestSpectrogramMessageID";
+constexpr const char *kResponseSpectrogramMessageID =
+    "kResponseSpectrogramMessageID";
+constexpr const char *kCancelSpectrogramMessageID =
+    "kCancelSpectrogramMessageID";
+// DSP load since the last request. Responses are buffers of floats: the
+// kDspLoadStatsPerPart statistics of each of kDspLoadParts, then of each
+// generator, all as percentages of the time blocks have to be rendered in.
+constexpr const char *kRequestDspLoadMessageID = "kRequestDspLoadMessageID";
+constexpr const char *kResponseDspLoadMessageID = "kResponseDspLoadMessageID";
+// Mean, 99th percentile and maximum.
+constexpr size_t kDspLoadStatsPerPart = 3;
+// process(), the player within it, and a single voice.
+constexpr size_t kDspLoadParts = 3;
 
 constexpr const char *kNoteIdAttr = "noteId";
 constexpr const char *kTargetAttr = "target";
@@ -29,5 +64,18 @@ constexpr const char *kSampleRateAttr = "sampleRate";
 constexpr const char *kBufferSizeAttr = "bufferSize";
 constexpr const char *kBufferDataAttr = "bufferData";
 constexpr const char *kFreqAttr = "frequency";
+// Spectrum requests: columns wanted, and whether they're spaced by octave
+// rather than by Hz.
+constexpr const char *kWidthAttr = "width";
+constexpr const char *kLogAxisAttr = "logAxis";
+// Spectrogram requests and responses.
+constexpr const char *kNoteAttr = "note";
+constexpr const char *kHoldMsAttr = "holdMs";
+constexpr const char *kReleaseMsAttr = "releaseMs";
+constexpr const char *kHeightAttr = "height";
+constexpr const char *kProgressAttr = "progress";
+// Patch version of the frames sent, and of those the view already has, which
+// aren't sent again.
+constexpr const char *kVersionAttr = "version";
 
 }  // namespace sidebands
\ No newline at end of file
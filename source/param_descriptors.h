@@ -0,0 +1,126 @@
+#pragma once
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include "constants.h"
+#include "tags.h"
+
+namespace sidebands {
+
+using Steinberg::Vst::ParamValue;
+
+// How a generator parameter's value changes; see ParamStore.
+enum class ParamKind : uint8_t {
+  UNUSED,
+  // Ramps between automation points.
+  SAMPLE_ACCURATE,
+  // Takes the last automation point of a block straight away.
+  STEPPED,
+  // Stepped, holding a bitset in its plain value.
+  BITSET,
+};
+
+// Plain range of BITSET parameters.
+constexpr uint8_t kBitsetWidth = 255;
+
+// Everything about a generator parameter that both the controller and the
+// processor declare it with, so neither builds it up call by call. Titles are
+// "Gen <n> <prefix><target><suffix>", with the target's name only for
+// parameters repeated per modulation target.
+struct ParamDescriptor {
+  ParamTag tag;
+  // TARGET_NA for parameters repeated per modulation target.
+  TargetTag target;
+  ParamKind kind;
+  ParamValue min, max, default_value;
+  const char *title_prefix;
+  const char *title_suffix = "";
+};
+
+// Generator-wide parameters.
+constexpr ParamDescriptor kGeneratorParams[]{
+    {TAG_GENERATOR_TOGGLE, TARGET_NA, ParamKind::STEPPED, 0, 1, 0, "On"},
+    {TAG_OSC, TARGET_C, ParamKind::SAMPLE_ACCURATE, 0, 8, 1,
+     "ModFMOscillator C"},
+    {TAG_OSC, TARGET_A, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.5,
+     "ModFMOscillator A"},
+    {TAG_OSC, TARGET_M, ParamKind::SAMPLE_ACCURATE, 0, 8, 4,
+     "ModFMOscillator M"},
+    {TAG_OSC, TARGET_K, ParamKind::SAMPLE_ACCURATE, 0, 10, 1,
+     "ModFMOscillator K"},
+    {TAG_OSC, TARGET_R, ParamKind::SAMPLE_ACCURATE, 0, 1, 1,
+     "ModFMOscillator R"},
+    {TAG_OSC, TARGET_S, ParamKind::SAMPLE_ACCURATE, -1, 1, 0,
+     "ModFMOscillator S"},
+    {TAG_OSC, TARGET_PORTAMENTO, ParamKind::SAMPLE_ACCURATE, 0, 1, 0,
+     "ModFMOscillator Portamento"},
+    {TAG_OSC, TARGET_OSC_TYPE, ParamKind::STEPPED, 0, 1, 0 /* MODFM */,
+     "ModFMOscillator Oscillator type"},
+};
+
+// Parameters repeated for each of kModulationTargets.
+constexpr ParamDescriptor kModulationParams[]{
+    {TAG_MODULATIONS, TARGET_NA, ParamKind::BITSET, 0, kBitsetWidth, 0,
+     "Mod Types ", " (bitset)"},
+    {TAG_ENV_HT, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.0,
+     "Envelope ", " Env HT"},
+    {TAG_ENV_AR, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.19,
+     "Envelope ", " Env AR"},
+    {TAG_ENV_AL, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.9,
+     "Envelope ", " Env AL"},
+    {TAG_ENV_DR1, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.2,
+     "Envelope ", " Env DR1"},
+    {TAG_ENV_DL1, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.5,
+     "Envelope ", " Env DL1"},
+    {TAG_ENV_DR2, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.5,
+     "Envelope ", " Env DR2"},
+    {TAG_ENV_SL, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.3,
+     "Envelope ", " Env SL"},
+    {TAG_ENV_RR1, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.6,
+     "Envelope ", " Env RR1"},
+    {TAG_ENV_RL1, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.10,
+     "Envelope ", " Env RL1"},
+    {TAG_ENV_RR2, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.15,
+     "Envelope ", " Env RR2"},
+    {TAG_ENV_VS, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 1,
+     "Envelope ", " Env VS"},
+    {TAG_LFO_TYPE, TARGET_NA, ParamKind::STEPPED, 0, kNumLFOTypes - 1,
+     ParamValue(LFOType::SIN), "LFO ", " Type"},
+    {TAG_LFO_FREQ, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 20, 10, "LFO ",
+     " Frequency"},
+    {TAG_LFO_AMP, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 0.5, "LFO ",
+     " Amplitude"},
+    {TAG_LFO_VS, TARGET_NA, ParamKind::SAMPLE_ACCURATE, 0, 1, 1, "LFO ",
+     " VelSense"},
+};
+
+constexpr int kNumGeneratorParams =
+    std::size(kGeneratorParams) +
+    std::size(kModulationTargets) * std::size(kModulationParams);
+
+// The default of `param` for generator `gennum` and, for parameters repeated
+// per modulation target, `target`. Most defaults are the same for every
+// generator, but only the first is switched on, each has its own carrier
+// ratio, and amplitude and FM level start out enveloped.
+constexpr ParamValue DefaultValueFor(const ParamDescriptor &param, int gennum,
+                                     TargetTag target) {
+  switch (param.tag) {
+    case TAG_GENERATOR_TOGGLE:
+      return gennum == 0;
+    case TAG_OSC:
+      return param.target == TARGET_C ? std::min(1.0 + gennum, param.max)
+                                      : param.default_value;
+    case TAG_MODULATIONS:
+      return target == TARGET_A || target == TARGET_K
+                 ? ParamValue(1 << Modulation::Envelope)
+                 : param.default_value;
+    default:
+      return param.default_value;
+  }
+}
+
+}  // namespace sidebands
@@ -0,0 +1,122 @@
+#include "processor/live_analyser.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace sidebands {
+
+namespace {
+
+// Room for a few frame periods of output at high sample rates.
+constexpr size_t kMaxIncomingSamples = 1 << 15;
+// Windows left unanalysed beyond this many are skipped to catch up.
+constexpr size_t kMaxPendingWindows = 8;
+
+}  // namespace
+
+LiveAnalyser::LiveAnalyser(OutputTap *tap)
+    : tap_(tap),
+      plan_(kFrameSize),
+      window_(kFrameSize),
+      incoming_(kMaxIncomingSamples),
+      latest_(kFrameSize),
+      bins_(kFrameSize),
+      held_(kFrameSize / 2, 0.0),
+      scope_(kFrameSize, 0.0f),
+      spectrum_(kFrameSize / 2, 0.0) {
+  // Periodic Hann, so overlapping windows sum flat.
+  for (size_t i = 0; i < kFrameSize; i++) {
+    window_[i] = 0.5 * (1 - std::cos(2 * std::numbers::pi * i / kFrameSize));
+    window_gain_ += window_[i];
+  }
+  window_gain_ /= 2;
+  pending_.reserve(kFrameSize + kMaxIncomingSamples);
+  thread_ = std::thread(&LiveAnalyser::Run, this);
+}
+
+LiveAnalyser::~LiveAnalyser() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+  tap_->set_active(false);
+}
+
+void LiveAnalyser::Request() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  last_request_ = std::chrono::steady_clock::now();
+  if (!tap_->active()) {
+    tap_->Skip();
+    tap_->set_active(true);
+    wake_.notify_all();
+  }
+}
+
+std::vector<float> LiveAnalyser::Scope() const {
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  return scope_;
+}
+
+std::vector<double> LiveAnalyser::Spectrum() const {
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  return spectrum_;
+}
+
+void LiveAnalyser::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    if (!tap_->active()) {
+      wake_.wait(lock, [this] { return stop_ || tap_->active(); });
+      continue;
+    }
+    wake_.wait_for(lock, kFramePeriod, [this] { return stop_; });
+    if (stop_) break;
+    if (std::chrono::steady_clock::now() - last_request_ > kIdleTimeout) {
+      VLOG(1) << "No live analysis requests; switching the output tap off. "
+              << tap_->dropped() << " samples dropped so far.";
+      tap_->set_active(false);
+      continue;
+    }
+    lock.unlock();
+    Analyse();
+    lock.lock();
+  }
+}
+
+void LiveAnalyser::Analyse() {
+  size_t read;
+  while ((read = tap_->Read(incoming_.data(), incoming_.size())) > 0)
+    pending_.insert(pending_.end(), incoming_.begin(),
+                    incoming_.begin() + read);
+
+  // Fall behind by no more than a few windows.
+  const size_t max_pending = kFrameSize + kMaxPendingWindows * kHopSize;
+  if (pending_.size() > max_pending)
+    pending_.erase(pending_.begin(), pending_.end() - max_pending);
+
+  if (pending_.size() < kFrameSize) return;
+
+  // The scope shows the newest samples; the spectrum holds the peak of every
+  // window completed since the last frame.
+  std::copy(pending_.end() - kFrameSize, pending_.end(), latest_.begin());
+  while (pending_.size() >= kFrameSize) {
+    for (size_t i = 0; i < kFrameSize; i++)
+      bins_[i] = pending_[i] * window_[i];
+    plan_.Forward(bins_);
+    for (size_t i = 0; i < held_.size(); i++)
+      held_[i] = std::max(held_[i], std::abs(bins_[i]) / window_gain_);
+    pending_.erase(pending_.begin(), pending_.begin() + kHopSize);
+  }
+
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  scope_.swap(latest_);
+  spectrum_.swap(held_);
+  std::fill(held_.begin(), held_.end(), 0.0);
+}
+
+}  // namespace sidebands
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dsp/fft.h"
+#include "processor/util/output_tap.h"
+
+namespace sidebands {
+
+// Watches the player's output through an OutputTap for the live scope and
+// spectrum views. A background thread drains the tap, runs a short-time
+// Fourier transform over overlapping Hann windows, and keeps the latest
+// frame for the message thread to send on. The tap is only switched on while
+// views keep asking for frames; once they stop, the thread sleeps and the
+// audio thread stops writing.
+class LiveAnalyser {
+ public:
+  static constexpr size_t kFrameSize = 2048;
+  static constexpr size_t kHopSize = kFrameSize / 4;
+  static constexpr auto kFramePeriod = std::chrono::milliseconds(33);
+  static constexpr auto kIdleTimeout = std::chrono::seconds(2);
+
+  explicit LiveAnalyser(OutputTap *tap);
+  ~LiveAnalyser();
+
+  // Called for each view request; keeps the tap on.
+  void Request();
+
+  // The most recent kFrameSize samples, oldest first.
+  std::vector<float> Scope() const;
+  // Amplitude of each of the kFrameSize / 2 bins, a full scale sine reading
+  // 1, held at its peak over the windows since the last frame was published.
+  std::vector<double> Spectrum() const;
+
+ private:
+  void Run();
+  // Drains the tap and analyses every window it completes.
+  void Analyse();
+
+  OutputTap *const tap_;
+  const FFTPlan plan_;
+  std::vector<double> window_;
+  // Amplitude of a full scale sine after windowing, to normalise bins by.
+  double window_gain_ = 0;
+
+  // Analysis state; only touched by the analyser thread.
+  std::vector<float> incoming_;
+  std::vector<float> pending_;
+  std::vector<float> latest_;
+  ComplexBuffer bins_;
+  std::vector<double> held_;
+
+  // The published frame.
+  mutable std::mutex frame_mutex_;
+  std::vector<float> scope_;
+  std::vector<double> spectrum_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::chrono::steady_clock::time_point last_request_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace sidebands
@@ -5,7 +5,14 @@
 #include <glog/logging.h>
 #include <pluginterfaces/base/ustring.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
 #include "constants.h"
+#include "param_descriptors.h"
 #include "tags.h"
 
 using Steinberg::Vst::ParamID;
@@ -15,15 +22,63 @@ namespace sidebands {
 
 namespace {
 
-void WriteParameter(Steinberg::IBStreamer &streamer, int gennum, ParamTag param,
-                    TargetTag target, ParamValue value) {
-  // Format is tag followed by value.
-  // Everything is float, at least for now, because our parameter framework
-  // doesn't really know anything else.
-  streamer.writeInt32u(TagFor(gennum, param, target));
-  streamer.writeDouble(value);
+constexpr int kOnSlot = ParamSlotFor(TAG_GENERATOR_TOGGLE, TARGET_NA);
+constexpr int kCSlot = ParamSlotFor(TAG_OSC, TARGET_C);
+constexpr int kASlot = ParamSlotFor(TAG_OSC, TARGET_A);
+constexpr int kMSlot = ParamSlotFor(TAG_OSC, TARGET_M);
+constexpr int kKSlot = ParamSlotFor(TAG_OSC, TARGET_K);
+constexpr int kRSlot = ParamSlotFor(TAG_OSC, TARGET_R);
+constexpr int kSSlot = ParamSlotFor(TAG_OSC, TARGET_S);
+constexpr int kPortamentoSlot = ParamSlotFor(TAG_OSC, TARGET_PORTAMENTO);
+constexpr int kOscTypeSlot = ParamSlotFor(TAG_OSC, TARGET_OSC_TYPE);
+
+bool IsStructuralParam(ParamID param_id) {
+  switch (ParamFor(param_id)) {
+    case TAG_GENERATOR_TOGGLE:
+    case TAG_MODULATIONS:
+    case TAG_BAKED_WAVETABLES:
+      return true;
+    case TAG_OSC:
+      return TargetFor(param_id) == TARGET_OSC_TYPE;
+    default:
+      return false;
+  }
 }
 
+// Parameters baked into wavetables.
+bool IsWavetableParam(ParamID param_id) {
+  if (ParamFor(param_id) != TAG_OSC) return false;
+  switch (TargetFor(param_id)) {
+    case TARGET_C:
+    case TARGET_M:
+    case TARGET_K:
+    case TARGET_R:
+    case TARGET_S:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Marks a change to a GeneratorPatch's values for the length of its scope, so
+// readers on other threads know to retry.
+class ValuesChange {
+ public:
+  explicit ValuesChange(std::atomic<uint32_t> &sequence)
+      : sequence_(sequence) {
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  ~ValuesChange() {
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+  }
+
+ private:
+  std::atomic<uint32_t> &sequence_;
+};
+
 }  // namespace
 
 // static
@@ -31,29 +86,54 @@ bool PatchProcessor::ValidParam(ParamID param_id) {
   return GeneratorFor(param_id) < kNumGenerators;
 }
 
-PatchProcessor::PatchProcessor() {
+PatchProcessor::PatchProcessor()
+    : polyphony_(TagFor(0, TAG_POLYPHONY, TARGET_NA), 1, kMaxVoices, 0),
+      voice_layout_(TagFor(0, TAG_VOICE_LAYOUT, TARGET_NA), 0,
+                    kNumVoiceLayouts - 1, 0),
+      baked_wavetables_(TagFor(0, TAG_BAKED_WAVETABLES, TARGET_NA), 0, 1, 0),
+      patch_fade_(TagFor(0, TAG_PATCH_FADE, TARGET_NA), 0, kMaxPatchFadeMs,
+                  0) {
+  polyphony_.setValue(kDefaultNumVoices);
+  patch_fade_.setValue(kDefaultPatchFadeMs);
+  voice_layout_.setValue(ParamValue(VoiceLayout::PER_VOICE));
   for (int g = 0; g < kNumGenerators; g++) {
-    auto unit_id = MakeUnitID(UNIT_GENERATOR, g);
-
-    generators_[g] = std::make_unique<GeneratorPatch>(g, unit_id);
+    generators_[g] =
+        std::make_unique<GeneratorPatch>(g, MakeUnitID(UNIT_GENERATOR, g));
   }
 }
 
 void PatchProcessor::BeginParameterChange(
     ParamID param_id, Steinberg::Vst::IParamValueQueue *p_queue) {
+  if (auto *global = GlobalParameter(param_id)) {
+    if (p_queue->getPointCount()) global->beginChanges(p_queue);
+    if (IsStructuralParam(param_id)) StructureChanged();
+    return;
+  }
   uint8_t gen_num = GeneratorFor(param_id);
   generators_[gen_num]->BeginParameterChange(param_id, p_queue);
+  changed_generators_.set(gen_num);
+  if (IsStructuralParam(param_id)) StructureChanged();
+  // Wavetables are rebaked once the block's automation has settled.
+  if (IsWavetableParam(param_id) && baked_wavetables())
+    wavetable_params_changed_ = true;
 }
 
 void PatchProcessor::EndParameterChanges() {
-  for (auto &generator : generators_) {
-    generator->EndChanges();
+  for (int g = 0; g < kNumGenerators; g++) {
+    if (changed_generators_[g]) generators_[g]->EndChanges();
+  }
+  changed_generators_.reset();
+  if (wavetable_params_changed_) {
+    wavetable_params_changed_ = false;
+    StructureChanged();
   }
 }
 
 void PatchProcessor::AdvanceParameterChanges(uint32_t num_samples) {
-  for (auto &item : generators_) {
-    item->AdvanceParameterChanges(num_samples);
+  if (changed_generators_.none()) return;
+  for (int g = 0; g < kNumGenerators; g++) {
+    if (changed_generators_[g])
+      generators_[g]->AdvanceParameterChanges(num_samples);
   }
 }
 
@@ -61,19 +141,87 @@ Steinberg::tresult PatchProcessor::LoadPatch(Steinberg::IBStream *stream) {
   // called when we load a preset, the model has to be reloaded
   Steinberg::IBStreamer streamer(stream, kLittleEndian);
 
-  Steinberg::uint32 num_generators;
-  if (!streamer.readInt32u(num_generators)) {
-    LOG(ERROR) << "Could not read patch stream; expected generator count.";
+  // Legacy streams start with their generator count instead of the magic.
+  Steinberg::uint32 magic;
+  if (!streamer.readInt32u(magic)) {
+    LOG(ERROR) << "Could not read patch stream; expected header.";
+    return Steinberg::kResultFalse;
+  }
+  if (magic != kPatchRecordMagic) return LoadLegacyPatch(streamer, magic);
+
+  Steinberg::uint16 version, num_generators, num_generator_params,
+      num_global_params;
+  if (!streamer.readInt16u(version) || !streamer.readInt16u(num_generators) ||
+      !streamer.readInt16u(num_generator_params) ||
+      !streamer.readInt16u(num_global_params)) {
+    LOG(ERROR) << "Truncated patch record header.";
+    return Steinberg::kResultFalse;
+  }
+  if (version > kPatchRecordVersion) {
+    LOG(ERROR) << "Patch record version " << version
+               << " is newer than supported: " << kPatchRecordVersion;
+    return Steinberg::kResultFalse;
+  }
+  if (!PatchRecordSane(num_generator_params, num_global_params)) {
+    LOG(ERROR) << "Corrupt patch record header: " << num_generator_params
+               << " generator and " << num_global_params
+               << " global parameters";
+    return Steinberg::kResultFalse;
+  }
+  PatchLayout layout;
+  layout.generator_params.resize(num_generator_params);
+  layout.global_params.resize(num_global_params);
+  std::vector<double> values;
+  if (!streamer.readInt32uArray(layout.generator_params.data(),
+                                num_generator_params) ||
+      !streamer.readInt32uArray(layout.global_params.data(),
+                                num_global_params) ||
+      !ReadPatchRecordValues(streamer, layout, num_generators, &values)) {
+    LOG(ERROR) << "Truncated patch record.";
     return Steinberg::kResultFalse;
   }
-  if (num_generators != kNumGenerators) {
+  LoadRecord(PatchLayoutMap(layout),
+             std::min<size_t>(num_generators, kNumGenerators), values.data());
+  StructureChanged();
+  return Steinberg::kResultOk;
+}
+
+Steinberg::tresult PatchProcessor::LoadLegacyPatch(
+    Steinberg::IBStreamer &streamer, uint32_t num_generators) {
+  if (num_generators > kNumGenerators) {
     LOG(ERROR) << "Incompatible generator count. Got: " << num_generators
-               << " expected: " << kNumGenerators;
+               << " expected at most: " << kNumGenerators;
     return Steinberg::kResultFalse;
   }
-  for (auto &generator : generators_) {
-    generator->LoadPatch(streamer);
+  // Patches saved with fewer generators leave the rest switched off.
+  for (uint32_t g = 0; g < kNumGenerators; g++) {
+    if (g >= num_generators) {
+      generators_[g]->set_on(false);
+      continue;
+    }
+    if (generators_[g]->LoadPatch(streamer) != Steinberg::kResultOk) {
+      PatchLoaded();
+      return Steinberg::kResultFalse;
+    }
+  }
+
+  // Global parameters follow the generators. Older patches don't have them,
+  // in which case the current values are kept.
+  Steinberg::Vst::ParamID id;
+  while (streamer.readInt32u(id)) {
+    ParamValue v;
+    if (!streamer.readDouble(v)) {
+      LOG(ERROR) << "Unable to read value for param id: " << TagStr(id);
+      break;
+    }
+    auto *global = GlobalParameter(id);
+    if (!global) {
+      LOG(ERROR) << "Unknown global parameter: " << TagStr(id);
+      continue;
+    }
+    global->setValueNormalized(v);
   }
+  PatchLoaded();
 
   return Steinberg::kResultOk;
 }
@@ -82,14 +230,131 @@ Steinberg::tresult PatchProcessor::SavePatch(Steinberg::IBStream *stream) {
   // called when we load a preset, the model has to be reloaded
   Steinberg::IBStreamer streamer(stream, kLittleEndian);
 
-  streamer.writeInt32u(kNumGenerators);
-  for (int i = 0; i < kNumGenerators; i++) {
-    generators_[i]->SavePatch(streamer);
-  }
+  const auto &layout = PatchLayout::Current();
+  std::vector<double> values(layout.RecordSize(kNumGenerators));
+  SaveRecord(values.data());
+
+  streamer.writeInt32u(kPatchRecordMagic);
+  streamer.writeInt16u(kPatchRecordVersion);
+  streamer.writeInt16u(kNumGenerators);
+  streamer.writeInt16u(layout.generator_params.size());
+  streamer.writeInt16u(layout.global_params.size());
+  streamer.writeInt32uArray(layout.generator_params.data(),
+                            layout.generator_params.size());
+  streamer.writeInt32uArray(layout.global_params.data(),
+                            layout.global_params.size());
+  if (!streamer.writeDoubleArray(values.data(), values.size()))
+    return Steinberg::kResultFalse;
 
   return Steinberg::kResultOk;
 }
 
+void PatchProcessor::LoadRecord(const PatchLayoutMap &map,
+                                size_t num_generators, const double *values) {
+  const size_t stride = map.layout().generator_params.size();
+  for (size_t g = 0; g < kNumGenerators; g++) {
+    if (g < num_generators)
+      generators_[g]->LoadRecord(map, values + g * stride);
+    else
+      generators_[g]->set_on(false);
+  }
+  const double *global_values = values + num_generators * stride;
+  const auto &global_params = map.layout().global_params;
+  for (size_t i = 0; i < global_params.size(); i++) {
+    auto *global = GlobalParameter(global_params[i]);
+    if (global) global->setValueNormalized(global_values[i]);
+  }
+}
+
+void PatchProcessor::SaveRecord(double *values) const {
+  const auto &layout = PatchLayout::Current();
+  const size_t stride = layout.generator_params.size();
+  for (size_t g = 0; g < kNumGenerators; g++)
+    generators_[g]->SaveRecord(values + g * stride);
+  double *global_values = values + kNumGenerators * stride;
+  for (size_t i = 0; i < layout.global_params.size(); i++)
+    global_values[i] =
+        GlobalParameter(layout.global_params[i])->getValueNormalized();
+}
+
+uint64_t PatchProcessor::SoundHash() const {
+  // FNV-1a, over the record of each generator that's on.
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto add = [&hash](const void *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      hash ^= static_cast<const unsigned char *>(data)[i];
+      hash *= 0x100000001b3ull;
+    }
+  };
+  const size_t stride = PatchLayout::Current().generator_params.size();
+  std::vector<double> values(stride);
+  for (size_t g = 0; g < kNumGenerators; g++) {
+    generators_[g]->SaveRecord(values.data());
+    const bool on = values[kOnSlot] >= 0.5;
+    add(&on, sizeof(on));
+    if (on) add(values.data(), values.size() * sizeof(double));
+  }
+  const bool baked = baked_wavetables();
+  add(&baked, sizeof(baked));
+  return hash;
+}
+
+void PatchProcessor::CopyFrom(const PatchProcessor &other) {
+  const auto &layout = PatchLayout::Current();
+  std::vector<double> values(layout.RecordSize(kNumGenerators));
+  other.SaveRecord(values.data());
+  LoadRecord(PatchLayoutMap(layout), kNumGenerators, values.data());
+  StructureChanged();
+}
+
+void PatchProcessor::PatchLoaded() {
+  StructureChanged();
+}
+
+void PatchProcessor::StructureChanged() {
+  structure_version_.fetch_add(1, std::memory_order_release);
+  WakeStructureWaiters();
+}
+
+void PatchProcessor::WakeStructureWaiters() {
+  structure_wakes_.fetch_add(1, std::memory_order_release);
+  structure_wakes_.notify_all();
+}
+
+int PatchProcessor::polyphony() const {
+  return std::clamp(int(std::lround(polyphony_.getValue())), 1, kMaxVoices);
+}
+
+VoiceLayout PatchProcessor::voice_layout() const {
+  return static_cast<VoiceLayout>(int(std::lround(voice_layout_.getValue())));
+}
+
+bool PatchProcessor::baked_wavetables() const {
+  return baked_wavetables_.getValue() >= 0.5;
+}
+
+double PatchProcessor::patch_fade_ms() const { return patch_fade_.getValue(); }
+
+ProcessorParameterValue *PatchProcessor::GlobalParameter(ParamID param_id) {
+  switch (ParamFor(param_id)) {
+    case TAG_POLYPHONY:
+      return &polyphony_;
+    case TAG_VOICE_LAYOUT:
+      return &voice_layout_;
+    case TAG_BAKED_WAVETABLES:
+      return &baked_wavetables_;
+    case TAG_PATCH_FADE:
+      return &patch_fade_;
+    default:
+      return nullptr;
+  }
+}
+
+const ProcessorParameterValue *PatchProcessor::GlobalParameter(
+    ParamID param_id) const {
+  return const_cast<PatchProcessor *>(this)->GlobalParameter(param_id);
+}
+
 Steinberg::tresult GeneratorPatch::LoadPatch(Steinberg::IBStreamer &streamer) {
   Steinberg::uint32 stream_gennum, num_params;
   if (!streamer.readInt32u(stream_gennum)) {
@@ -105,198 +370,165 @@ Steinberg::tresult GeneratorPatch::LoadPatch(Steinberg::IBStreamer &streamer) {
     LOG(ERROR) << "Unable to read parameter count for generator: " << gennum_;
     return Steinberg::kResultFalse;
   }
+  ValuesChange change(values_sequence_);
+  wavetable_version_.fetch_add(1, std::memory_order_release);
   while (num_params--) {
     Steinberg::Vst::ParamID id;
     if (!streamer.readInt32u(id)) break;
     ParamValue v;
-    CHECK(streamer.readDouble(v))
-        << "Unable to read value for param id: " << TagStr(id);
-    ParamKey k{ParamFor(id), TargetFor(id)};
-    const auto &it = parameters_.find(k);
-    if (it == parameters_.end()) {
+    if (!streamer.readDouble(v)) {
+      LOG(ERROR) << "Unable to read value for param id: " << TagStr(id);
+      return Steinberg::kResultFalse;
+    }
+    auto slot = ParamSlotFor(id);
+    if (slot == kNoParamSlot || !store_.Declared(slot)) {
       LOG(ERROR) << " Missing parameter for id: " << TagStr(id);
       continue;
     }
-    it->second->setValueNormalized(v);
+    store_.SetNormalizedValue(slot, v);
   }
   return Steinberg::kResultOk;
 }
 
-Steinberg::tresult GeneratorPatch::SavePatch(Steinberg::IBStreamer &streamer) {
-  // First write generator number, then the # of parameters.
-  streamer.writeInt32u(gennum_);
-  streamer.writeInt32u(parameters_.size());
-  for (auto &param : parameters_) {
-    // Format is tag followed by value.
-    // Everything is float, at least for now, because the parameter framework
-    // doesn't really know anything else.
-
-    auto nv = param.second->getValueNormalized();
-    WriteParameter(streamer, gennum_, param.first.parameter, param.first.target,
-                   nv);
+void GeneratorPatch::LoadRecord(const PatchLayoutMap &map,
+                                const double *values) {
+  ValuesChange change(values_sequence_);
+  wavetable_version_.fetch_add(1, std::memory_order_release);
+  if (map.identity()) {
+    store_.LoadNormalized(values);
+    return;
+  }
+  const auto &slots = map.slots();
+  for (size_t i = 0; i < slots.size(); i++) {
+    if (slots[i] == kNoParamSlot || !store_.Declared(slots[i])) continue;
+    store_.SetNormalizedValue(slots[i], values[i]);
   }
-  return Steinberg::kResultOk;
 }
 
-void GeneratorPatch::DeclareParameter(ProcessorParameterValue *value) {
-  auto param_key = ParamKeyFor(value->getParamID());
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
+void GeneratorPatch::SaveRecord(double *values) const {
+  // Copy until nothing changed the values during the copy.
+  while (true) {
+    const uint32_t before = values_sequence_.load(std::memory_order_acquire);
+    if (before & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    store_.SaveNormalized(values);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (values_sequence_.load(std::memory_order_relaxed) == before) return;
+  }
+}
 
-  parameters_[param_key] = value;
+ParamRef GeneratorPatch::DeclareParameter(ParamTag param, TargetTag target,
+                                          ParamStore::Kind kind,
+                                          ParamValue min, ParamValue max,
+                                          ParamValue default_value) {
+  auto slot = ParamSlotFor(param, target);
+  CHECK_NE(slot, kNoParamSlot) << "No slot for parameter: "
+                               << TagStr(TagFor(gennum_, param, target));
+  store_.Declare(slot, TagFor(gennum_, param, target), kind, min, max,
+                 default_value);
+  return ParamRef(&store_, slot);
 }
 
 GeneratorPatch::GeneratorPatch(uint32_t gen, Steinberg::Vst::UnitID unit_id)
-    : gennum_(gen),
-      on_(TagFor(gennum_, TAG_GENERATOR_TOGGLE, TARGET_NA), 0, 1, gen == 0),
-      c_(TagFor(gennum_, TAG_OSC, TARGET_C), 1 + gennum_, 0, 8),
-      a_(TagFor(gennum_, TAG_OSC, TARGET_A), 0.5, 0, 1),
-      m_(TagFor(gennum_, TAG_OSC, TARGET_M), 4, 0, 8),
-      k_(TagFor(gennum_, TAG_OSC, TARGET_K), 1, 0, 10),
-      r_(TagFor(gennum_, TAG_OSC, TARGET_R), 1, 0, 1),
-      s_(TagFor(gennum_, TAG_OSC, TARGET_S), 0, -1, 1),
-      portamento_(TagFor(gennum_, TAG_OSC, TARGET_PORTAMENTO), 0, 0, 1),
-      osc_type_(TagFor(gennum_, TAG_OSC, TARGET_OSC_TYPE), 0, 1,
-                0 /* MODFM */) {
-  DeclareParameter(&on_);
-  DeclareParameter(&c_);
-  DeclareParameter(&a_);
-  DeclareParameter(&m_);
-  DeclareParameter(&k_);
-  DeclareParameter(&r_);
-  DeclareParameter(&s_);
-  DeclareParameter(&osc_type_);
-  DeclareParameter(&portamento_);
-
-  for (auto &target : kModulationTargets) {
-    std::bitset<kBitsetWidth> mod_set;
-    if (target == TARGET_A || target == TARGET_K)
-      mod_set.set(Modulation::Envelope);
+    : gennum_(gen) {
+  for (const auto &param : kGeneratorParams) {
+    DeclareParameter(param.tag, param.target, param.kind, param.min, param.max,
+                     DefaultValueFor(param, gen, TARGET_NA));
+  }
+
+  for (auto target : kModulationTargets) {
+    for (const auto &param : kModulationParams) {
+      DeclareParameter(param.tag, target, param.kind, param.min, param.max,
+                       DefaultValueFor(param, gen, target));
+    }
+    auto ref = [this, target](ParamTag param) {
+      return ParamRef(&store_, ParamSlotFor(param, target));
+    };
     EnvelopeValues envelope_values{
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_HT, target), 0.0, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_AR, target), 0.19, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_AL, target), 0.9, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_DR1, target), 0.2, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_DL1, target), 0.5, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_DR2, target), 0.5, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_SL, target), 0.3, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_RR1, target), 0.6, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_RL1, target), 0.10, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_RR2, target), 0.15, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_ENV_VS, target), 1, 0, 1),
+        ref(TAG_ENV_HT),  ref(TAG_ENV_AR),  ref(TAG_ENV_AL), ref(TAG_ENV_DR1),
+        ref(TAG_ENV_DL1), ref(TAG_ENV_DR2), ref(TAG_ENV_SL), ref(TAG_ENV_RR1),
+        ref(TAG_ENV_RL1), ref(TAG_ENV_RR2), ref(TAG_ENV_VS),
     };
     LFOValues lfo_values{
-        Parameter(TagFor(gennum_, TAG_LFO_TYPE, target), 0, 1,
-                  Steinberg::Vst::ParamValue(LFOType::SIN)),
-        SampleAccurateValue(TagFor(gennum_, TAG_LFO_FREQ, target), 10, 0, 20),
-        SampleAccurateValue(TagFor(gennum_, TAG_LFO_AMP, target), 0.5, 0, 1),
-        SampleAccurateValue(TagFor(gennum_, TAG_LFO_VS, target), 1, 0, 1),
+        ref(TAG_LFO_TYPE),
+        ref(TAG_LFO_FREQ),
+        ref(TAG_LFO_AMP),
+        ref(TAG_LFO_VS),
     };
-    auto mod_target = std::make_unique<ModParams>(
-        target,
-        BitsetParameter(TagFor(gennum_, ParamTag::TAG_MODULATIONS, target),
-                        mod_set),
-        envelope_values, lfo_values);
-    mod_targets_[target] = std::move(mod_target);
-  };
-
-  // Take pointers _after_ the vector is fully constructed, just in case things
-  // get moved.
-  for (auto &mt : mod_targets_) {
-    if (!mt) continue;
-    DeclareParameter(&mt->modulations);  // bitset
-    DeclareParameter(&mt->envelope_parameters.HT);
-    DeclareParameter(&mt->envelope_parameters.AL);
-    DeclareParameter(&mt->envelope_parameters.AR);
-    DeclareParameter(&mt->envelope_parameters.DL1);
-    DeclareParameter(&mt->envelope_parameters.DR1);
-    DeclareParameter(&mt->envelope_parameters.DR2);
-    DeclareParameter(&mt->envelope_parameters.SL);
-    DeclareParameter(&mt->envelope_parameters.RR1);
-    DeclareParameter(&mt->envelope_parameters.RR2);
-    DeclareParameter(&mt->envelope_parameters.VS);
-    DeclareParameter(&mt->lfo_parameters.type);
-    DeclareParameter(&mt->lfo_parameters.amplitude);
-    DeclareParameter(&mt->lfo_parameters.frequency);
-    DeclareParameter(&mt->lfo_parameters.velocity_sensivity);
+    mod_targets_[target] = std::make_unique<ModParams>(
+        target, ref(TAG_MODULATIONS), envelope_values, lfo_values);
   }
 }
 
 void GeneratorPatch::BeginParameterChange(
     ParamID param_id, Steinberg::Vst::IParamValueQueue *p_queue) {
   if (!p_queue->getPointCount()) return;
-
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
   if (GeneratorFor(param_id) != gennum_) return;
 
-  auto key = ParamKeyFor(param_id);
-  const auto &param_it = parameters_.find(key);
-  if (param_it == parameters_.end()) return;
-  auto param = param_it->second;
-  param->beginChanges(p_queue);
-  sa_changed_params_.push_back(param_id);
+  auto slot = ParamSlotFor(param_id);
+  if (slot == kNoParamSlot || !store_.Declared(slot)) return;
+  ValuesChange change(values_sequence_);
+  store_.BeginChanges(slot, p_queue);
+  if (IsWavetableParam(param_id)) {
+    wavetable_automated_ = true;
+    wavetable_version_.fetch_add(1, std::memory_order_release);
+  }
 }
 
 void GeneratorPatch::EndChanges() {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  while (!sa_changed_params_.empty()) {
-    auto changed_param = sa_changed_params_.front();
-    auto key = ParamKeyFor(changed_param);
-    auto pdesc = parameters_[key];
-    sa_changed_params_.pop_back();
-    pdesc->endChanges();
-  }
+  ValuesChange change(values_sequence_);
+  wavetable_automated_ = false;
+  store_.EndChanges();
 }
 
 void GeneratorPatch::AdvanceParameterChanges(uint32_t num_samples) {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  for (auto &pdesc : parameters_) {
-    pdesc.second->advance(num_samples);
-  }
+  ValuesChange change(values_sequence_);
+  if (wavetable_automated_)
+    wavetable_version_.fetch_add(1, std::memory_order_release);
+  store_.Advance(num_samples);
 }
 
 bool GeneratorPatch::on() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return on_.getValue();
+  return store_.Value(kOnSlot);
+}
+
+void GeneratorPatch::set_on(bool on) {
+  ValuesChange change(values_sequence_);
+  store_.SetValue(kOnSlot, on);
 }
 
 ParamValue GeneratorPatch::c() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return c_.getValue();
+  return store_.Value(kCSlot);
 }
 
 ParamValue GeneratorPatch::a() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return a_.getValue();
+  return store_.Value(kASlot);
 }
 
 ParamValue GeneratorPatch::m() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return m_.getValue();
+  return store_.Value(kMSlot);
 }
 
 ParamValue GeneratorPatch::k() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return k_.getValue();
+  return store_.Value(kKSlot);
 }
 
 ParamValue GeneratorPatch::r() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return r_.getValue();
+  return store_.Value(kRSlot);
 }
 
 ParamValue GeneratorPatch::s() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return s_.getValue();
+  return store_.Value(kSSlot);
 }
 
 ParamValue GeneratorPatch::portamento() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return portamento_.getValue();
+  return store_.Value(kPortamentoSlot);
 }
 
 GeneratorPatch::OscType GeneratorPatch::osc_type() const {
-  std::lock_guard<std::mutex> params_lock(patch_mutex_);
-  return static_cast<OscType>(int(osc_type_.getValue()));
+  return static_cast<OscType>(int(store_.Value(kOscTypeSlot)));
 }
 
 GeneratorPatch::ModParams *GeneratorPatch::ModulationParams(
@@ -333,8 +565,34 @@ std::function<double()> GeneratorPatch::ParameterGetterFor(
   }
 }
 
+ParamValue GeneratorPatch::ParameterValueFor(TargetTag dest) const {
+  return store_.Value(ParamSlotFor(TAG_OSC, dest));
+}
+
+ParamValue GeneratorPatch::ParameterRampFor(TargetTag dest) const {
+  return store_.Ramp(ParamSlotFor(TAG_OSC, dest));
+}
+
+void GeneratorPatch::FillParameter(TargetTag dest, OscParam &buffer) const {
+  FillParameter(dest, std::begin(buffer), buffer.size());
+}
+
+void GeneratorPatch::FillParameter(TargetTag dest, double *buffer,
+                                   size_t frames) const {
+  const int slot = ParamSlotFor(TAG_OSC, dest);
+  const ParamValue value = store_.Value(slot);
+  const ParamValue ramp = store_.Ramp(slot);
+  if (ramp == 0.0) {
+    std::fill(buffer, buffer + frames, value);
+    return;
+  }
+  // The store has already advanced to the end of the slice, so ramp back to
+  // where it started.
+  Vramp(buffer, frames, value - ramp * frames, ramp);
+}
+
 GeneratorPatch::ModParams::ModParams(
-    TargetTag target, const BitsetParameter &modulations,
+    TargetTag target, const ParamRef &modulations,
     const GeneratorPatch::EnvelopeValues &envelope_parameters,
     const GeneratorPatch::LFOValues &lfo_parameters)
     : target(target), modulations(modulations),
@@ -3,18 +3,17 @@
 #include <pluginterfaces/vst/ivstparameterchanges.h>
 #include <pluginterfaces/vst/vsttypes.h>
 
+#include <atomic>
 #include <bitset>
-#include <deque>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <unordered_map>
 #include <variant>
-#include <vector>
 
 #include "constants.h"
+#include "dsp/oscbuffer.h"
+#include "processor/patch_record.h"
+#include "processor/util/param_store.h"
 #include "processor/util/parameter.h"
-#include "processor/util/sample_accurate_value.h"
 #include "tags.h"
 
 namespace Steinberg {
@@ -34,11 +33,16 @@ class GeneratorPatch {
   void EndChanges();
   void AdvanceParameterChanges(uint32_t num_samples);
 
+  // Legacy patch streams: (tag, value) pairs.
   Steinberg::tresult LoadPatch(Steinberg::IBStreamer &stream);
-  Steinberg::tresult SavePatch(Steinberg::IBStreamer &stream);
+  // This generator's values in a patch record.
+  void LoadRecord(const PatchLayoutMap &map, const double *values);
+  void SaveRecord(double *values) const;
 
-  // Accessors for various parameters to ensure locking.
+  // Accessors. These read the values unguarded, so are for the thread
+  // changing them; see values_sequence_.
   bool on() const;
+  void set_on(bool on);
   ParamValue c() const;
   ParamValue a() const;
   ParamValue m() const;
@@ -50,22 +54,22 @@ class GeneratorPatch {
   OscType osc_type() const;
 
   struct EnvelopeValues {
-    SampleAccurateValue HT, AR, AL, DR1, DL1, DR2, SL, RR1, RL1, RR2;
-    SampleAccurateValue VS;  // velocity sensitivity
+    ParamRef HT, AR, AL, DR1, DL1, DR2, SL, RR1, RL1, RR2;
+    ParamRef VS;  // velocity sensitivity
   };
   struct LFOValues {
-    Parameter type;
-    SampleAccurateValue frequency;
-    SampleAccurateValue amplitude;
-    SampleAccurateValue velocity_sensivity;
+    ParamRef type;
+    ParamRef frequency;
+    ParamRef amplitude;
+    ParamRef velocity_sensivity;
   };
   struct ModParams {
     // clang++ on Mac seems to need explicit constrctor here
-    ModParams(TargetTag target, const BitsetParameter &modulations,
+    ModParams(TargetTag target, const ParamRef &modulations,
               const EnvelopeValues &envelope_parameters,
               const LFOValues &lfo_parameters);
     TargetTag target;
-    BitsetParameter modulations;  // bitset
+    ParamRef modulations;  // bitset
     EnvelopeValues envelope_parameters;
     LFOValues lfo_parameters;
   };
@@ -74,24 +78,43 @@ class GeneratorPatch {
   std::bitset<Modulation::NumModulators> ModTypesFor(
       TargetTag destination) const;
   std::function<double()> ParameterGetterFor(TargetTag dest) const;
+  // Current value of `dest`. Unlike ParameterGetterFor, allocates nothing, so
+  // is what the audio thread uses.
+  ParamValue ParameterValueFor(TargetTag dest) const;
+  // Per-sample change in the value of `dest` over the current slice, if it's
+  // being automated.
+  ParamValue ParameterRampFor(TargetTag dest) const;
+  // Fill `buffer` with the value of `dest` at each sample of the current
+  // slice, following any automation ramp to its value at the slice's end.
+  void FillParameter(TargetTag dest, OscParam &buffer) const;
+  void FillParameter(TargetTag dest, double *buffer, size_t frames) const;
   uint32_t gennum() const { return gennum_; }
+  // Counts changes to the oscillator parameters wavetables are baked from, C,
+  // M, K, R and S, including each step of their automation. Any thread.
+  uint32_t wavetable_version() const {
+    return wavetable_version_.load(std::memory_order_acquire);
+  }
 
  private:
-  void DeclareParameter(ProcessorParameterValue *value);
+  ParamRef DeclareParameter(ParamTag param, TargetTag target,
+                            ParamStore::Kind kind, ParamValue min,
+                            ParamValue max, ParamValue default_value);
 
   const uint32_t gennum_;
 
-  mutable std::mutex patch_mutex_;
+  // Odd while the values are being changed. Only one thread changes them at a
+  // time: the audio thread while processing, otherwise whichever thread is
+  // loading state. Any other thread reads them with SaveRecord, which retries
+  // if they changed underneath it, so changing them never waits on a lock.
+  std::atomic<uint32_t> values_sequence_{0};
+  std::atomic<uint32_t> wavetable_version_{0};
+  // Whether the current block automates wavetable parameters.
+  bool wavetable_automated_ = false;
 
-  Parameter on_;
-  SampleAccurateValue c_, a_, m_, k_, r_, s_, portamento_;
-  Parameter osc_type_;
+  // All parameter values, indexed by ParamSlotFor.
+  ParamStore store_;
 
   std::unique_ptr<ModParams> mod_targets_[NUM_TARGETS];
-
-  std::unordered_map<ParamKey, ProcessorParameterValue *, ParamKey::Hash>
-      parameters_;
-  std::deque<Steinberg::Vst::ParamID> sa_changed_params_;
 };
 
 // Manages the processing of parameter changes from the processor loop.
@@ -104,12 +127,88 @@ class PatchProcessor {
   void EndParameterChanges();
   void AdvanceParameterChanges(uint32_t num_samples);
 
+  // Patch streams are a patch record with its header and layout. Streams
+  // from before records, of (tag, value) pairs, still load.
   Steinberg::tresult LoadPatch(Steinberg::IBStream *stream);
   Steinberg::tresult SavePatch(Steinberg::IBStream *stream);
 
+  // Load `num_generators` generators' worth of record `values`, in the
+  // layout of `map`. This doesn't count as a structure change: callers either
+  // install a program prepared for the values, or call StructureChanged
+  // themselves.
+  void LoadRecord(const PatchLayoutMap &map, size_t num_generators,
+                  const double *values);
+  // Fill `values` with the patch as a record of kNumGenerators generators in
+  // the current layout.
+  void SaveRecord(double *values) const;
+  // Take on all of `other`'s values. `other` may be changing on another
+  // thread, such as the live patch while the audio thread plays it.
+  void CopyFrom(const PatchProcessor &other);
+
   static bool ValidParam(ParamID param_id);
 
+  // Global engine settings. These are read when the processor is activated,
+  // so changes take effect on the next activation.
+  int polyphony() const;
+  VoiceLayout voice_layout() const;
+  // Whether generators with static, harmonic oscillator settings play back a
+  // baked wavetable rather than synthesising directly. Takes effect at once.
+  bool baked_wavetables() const;
+  // How long sounding voices take to fade out before a patch loaded with
+  // SidebandsProcessor::setState takes over, and back in after; zero swaps
+  // straight away.
+  double patch_fade_ms() const;
+
+  // Counts changes to anything renderers compile ahead of time: generator
+  // toggles, oscillator types and modulation routing, and with baked
+  // wavetables, the oscillator parameters they're baked from. Renderers
+  // compile once per version rather than re-reading it all every slice.
+  // Bumping it wakes compilers blocked in WaitForStructureChange, which
+  // never locks, so it's safe on the audio thread.
+  uint64_t structure_version() const {
+    return structure_version_.load(std::memory_order_acquire);
+  }
+  void StructureChanged();
+  // For compiler threads, never the audio thread: blocks until the structure
+  // changes or WakeStructureWaiters is called, after `wakes` was read from
+  // structure_wakes().
+  uint32_t structure_wakes() const {
+    return structure_wakes_.load(std::memory_order_acquire);
+  }
+  void WaitForStructureChange(uint32_t wakes) const {
+    structure_wakes_.wait(wakes, std::memory_order_acquire);
+  }
+  // Wakes blocked compilers without a change, e.g. to have them stop.
+  void WakeStructureWaiters();
+  // A hash of everything that shapes how a note sounds: the values of the
+  // generators that are on, and whether wavetables are baked. For caching
+  // analysis of the patch, which stays valid across changes that leave the
+  // values as they were, such as automation holding still. Not for the audio
+  // thread: it allocates.
+  uint64_t SoundHash() const;
+
   std::unique_ptr<GeneratorPatch> generators_[kNumGenerators];
+
+ private:
+  ProcessorParameterValue *GlobalParameter(ParamID param_id);
+  const ProcessorParameterValue *GlobalParameter(ParamID param_id) const;
+  Steinberg::tresult LoadLegacyPatch(Steinberg::IBStreamer &streamer,
+                                     uint32_t num_generators);
+  void PatchLoaded();
+
+  Parameter polyphony_;
+  Parameter voice_layout_;
+  Parameter baked_wavetables_;
+  Parameter patch_fade_;
+
+  // Generators with parameter changes in the current block.
+  std::bitset<kNumGenerators> changed_generators_;
+  // Whether the current block changes parameters baked into wavetables.
+  bool wavetable_params_changed_ = false;
+  std::atomic<uint64_t> structure_version_{0};
+  // Bumped with the structure version, and waited on in its place: 32 bits, so
+  // that waiting and waking go straight to the futex, with no lock.
+  std::atomic<uint32_t> structure_wakes_{0};
 };
 
 }  // namespace sidebands
\ No newline at end of file
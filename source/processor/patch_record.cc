@@ -0,0 +1,75 @@
+#include "processor/patch_record.h"
+
+#include <base/source/fstreamer.h>
+
+#include <algorithm>
+
+#include "constants.h"
+#include "processor/util/param_store.h"
+#include "tags.h"
+
+namespace sidebands {
+
+namespace {
+
+constexpr ParamTag kGlobalParamTags[]{TAG_POLYPHONY, TAG_VOICE_LAYOUT,
+                                      TAG_BAKED_WAVETABLES, TAG_PATCH_FADE};
+
+PatchLayout MakeCurrentLayout() {
+  PatchLayout layout;
+  layout.generator_params.resize(kNumUsedParamSlots);
+  for (int param = 0; param < TAG_NUM_TAGS; param++) {
+    for (int target = 0; target < NUM_TARGETS; target++) {
+      auto tag = ParamTag(param);
+      auto target_tag = TargetTag(target);
+      const int slot = ParamSlotFor(tag, target_tag);
+      if (slot == kNoParamSlot) continue;
+      layout.generator_params[slot] = TagFor(0, tag, target_tag);
+    }
+  }
+  for (auto tag : kGlobalParamTags)
+    layout.global_params.push_back(TagFor(0, tag, TARGET_NA));
+  return layout;
+}
+
+}  // namespace
+
+// static
+const PatchLayout &PatchLayout::Current() {
+  static const PatchLayout layout = MakeCurrentLayout();
+  return layout;
+}
+
+bool PatchRecordSane(size_t num_generator_params, size_t num_global_params) {
+  return num_generator_params <= kMaxRecordGeneratorParams &&
+         num_global_params <= kMaxRecordGlobalParams;
+}
+
+bool ReadPatchRecordValues(Steinberg::IBStreamer &streamer,
+                           const PatchLayout &layout, size_t num_generators,
+                           std::vector<double> *values) {
+  const size_t stride = layout.generator_params.size();
+  const size_t num_kept = std::min<size_t>(num_generators, kNumGenerators);
+  values->resize(layout.RecordSize(num_kept));
+  if (!streamer.readDoubleArray(values->data(), num_kept * stride))
+    return false;
+  // Generators past kNumGenerators are read through one at a time, so that
+  // nothing is sized by how many there are.
+  std::vector<double> skipped(stride);
+  for (size_t g = num_kept; g < num_generators; g++) {
+    if (!streamer.readDoubleArray(skipped.data(), stride)) return false;
+  }
+  return streamer.readDoubleArray(values->data() + num_kept * stride,
+                                  layout.global_params.size());
+}
+
+PatchLayoutMap::PatchLayoutMap(const PatchLayout &from)
+    : layout_(from),
+      identity_(from.generator_params ==
+                PatchLayout::Current().generator_params) {
+  slots_.reserve(from.generator_params.size());
+  for (auto param_id : from.generator_params)
+    slots_.push_back(ParamSlotFor(param_id));
+}
+
+}  // namespace sidebands
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Steinberg {
+class IBStreamer;
+}  // namespace Steinberg
+
+namespace sidebands {
+
+// A patch record holds the normalised value of every parameter at a fixed
+// position: each generator's parameters in turn, by ParamStore slot, followed
+// by the global parameters. It loads with one bulk copy per generator.
+//
+// Records are stored along with their PatchLayout, which names the parameter
+// at each position. Records with a different layout, from builds with other
+// parameters, are mapped onto the current one parameter by parameter.
+// Records with fewer generators than kNumGenerators leave the rest switched
+// off; records with more load the first kNumGenerators. Parameters this build
+// doesn't have are skipped.
+constexpr uint32_t kPatchRecordMagic = 0x54504253;  // "SBPT"
+// Bumped for changes to the record format itself, rather than to the set of
+// parameters, which the layout takes care of.
+constexpr uint16_t kPatchRecordVersion = 1;
+
+struct PatchLayout {
+  // ID of the parameter at each position of a generator's values, with
+  // generator 0 in the ID.
+  std::vector<Steinberg::Vst::ParamID> generator_params;
+  std::vector<Steinberg::Vst::ParamID> global_params;
+
+  // The layout this build reads and writes: one value per used ParamStore
+  // slot.
+  static const PatchLayout &Current();
+
+  // Number of values in a record with `num_generators`.
+  size_t RecordSize(size_t num_generators) const {
+    return num_generators * generator_params.size() + global_params.size();
+  }
+
+  bool operator==(const PatchLayout &other) const = default;
+};
+
+// Sanity limits on the parameter counts in a record's header, far beyond what
+// any build has. Records past them are corrupt, and are refused before
+// anything is sized by their counts. Generator counts need no limit: only the
+// first kNumGenerators are ever kept.
+constexpr size_t kMaxRecordGeneratorParams = 4096;
+constexpr size_t kMaxRecordGlobalParams = 1024;
+
+bool PatchRecordSane(size_t num_generator_params, size_t num_global_params);
+
+// Reads the values of a record of `num_generators` in `layout` from
+// `streamer` into `values`: those of the first kNumGenerators, then the
+// globals, skipping any generators past them. False if the stream ends first.
+bool ReadPatchRecordValues(Steinberg::IBStreamer &streamer,
+                           const PatchLayout &layout, size_t num_generators,
+                           std::vector<double> *values);
+
+// How values of a record in another layout map onto the current one.
+class PatchLayoutMap {
+ public:
+  explicit PatchLayoutMap(const PatchLayout &from);
+
+  // Whether each generator's values can be bulk-copied as they are.
+  bool identity() const { return identity_; }
+  // ParamStore slot for each of the layout's generator parameters, or
+  // kNoParamSlot for those this build doesn't have.
+  const std::vector<int> &slots() const { return slots_; }
+  const PatchLayout &layout() const { return layout_; }
+
+ private:
+  PatchLayout layout_;
+  std::vector<int> slots_;
+  bool identity_;
+};
+
+}  // namespace sidebands
@@ -0,0 +1,431 @@
+#include "processor/preset_bank.h"
+
+#include <glog/logging.h>
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "constants.h"
+#include "processor/patch_processor.h"
+
+namespace sidebands {
+
+namespace internal {
+
+// The header, decoded. In the file each field is little-endian, at the offset
+// given, 48 bytes in all.
+struct BankHeader {
+  uint32_t magic;                 // 0
+  uint16_t version;               // 4
+  uint16_t num_generators;        // 6
+  uint16_t num_generator_params;  // 8
+  uint16_t num_global_params;     // 10
+  uint32_t num_presets;           // 12
+  // Entries in the index; a power of two.
+  uint32_t index_size;  // 16
+  uint32_t reserved;    // 20
+  uint64_t index_offset;    // 24
+  uint64_t names_offset;    // 32
+  uint64_t records_offset;  // 40
+};
+
+}  // namespace internal
+
+namespace {
+
+using internal::BankHeader;
+
+constexpr uint32_t kPresetBankMagic = 0x4b424253;  // "SBBK"
+constexpr uint16_t kPresetBankVersion = 1;
+constexpr uint32_t kEmptyIndexEntry = ~0u;
+
+constexpr size_t kHeaderSize = 48;
+// Index entries are a 64-bit name hash and a 32-bit preset, padded to 16
+// bytes; name entries the offset of the name's characters from the start of
+// the names, and their length.
+constexpr size_t kIndexEntrySize = 16;
+constexpr size_t kIndexPresetOffset = 8;
+constexpr size_t kNameEntrySize = 8;
+
+constexpr uint64_t Align8(uint64_t offset) { return (offset + 7) & ~7ull; }
+
+// Whether `count` items of `item_size` at `offset` lie within `size` bytes.
+bool InBounds(uint64_t offset, uint64_t count, uint64_t item_size,
+              uint64_t size) {
+  if (offset > size) return false;
+  return item_size == 0 || count <= (size - offset) / item_size;
+}
+
+// Unsigned integers as the file stores them, whatever the host's byte order.
+template <typename T>
+T LoadLittleEndian(const char *bytes) {
+  T value = 0;
+  for (size_t i = 0; i < sizeof(T); i++)
+    value |= T(static_cast<unsigned char>(bytes[i])) << (8 * i);
+  return value;
+}
+
+template <typename T>
+void StoreLittleEndian(T value, char *bytes) {
+  for (size_t i = 0; i < sizeof(T); i++)
+    bytes[i] = static_cast<char>(value >> (8 * i));
+}
+
+BankHeader LoadHeader(const char *bytes) {
+  BankHeader header;
+  header.magic = LoadLittleEndian<uint32_t>(bytes);
+  header.version = LoadLittleEndian<uint16_t>(bytes + 4);
+  header.num_generators = LoadLittleEndian<uint16_t>(bytes + 6);
+  header.num_generator_params = LoadLittleEndian<uint16_t>(bytes + 8);
+  header.num_global_params = LoadLittleEndian<uint16_t>(bytes + 10);
+  header.num_presets = LoadLittleEndian<uint32_t>(bytes + 12);
+  header.index_size = LoadLittleEndian<uint32_t>(bytes + 16);
+  header.reserved = LoadLittleEndian<uint32_t>(bytes + 20);
+  header.index_offset = LoadLittleEndian<uint64_t>(bytes + 24);
+  header.names_offset = LoadLittleEndian<uint64_t>(bytes + 32);
+  header.records_offset = LoadLittleEndian<uint64_t>(bytes + 40);
+  return header;
+}
+
+void StoreHeader(const BankHeader &header, char *bytes) {
+  StoreLittleEndian(header.magic, bytes);
+  StoreLittleEndian(header.version, bytes + 4);
+  StoreLittleEndian(header.num_generators, bytes + 6);
+  StoreLittleEndian(header.num_generator_params, bytes + 8);
+  StoreLittleEndian(header.num_global_params, bytes + 10);
+  StoreLittleEndian(header.num_presets, bytes + 12);
+  StoreLittleEndian(header.index_size, bytes + 16);
+  StoreLittleEndian(header.reserved, bytes + 20);
+  StoreLittleEndian(header.index_offset, bytes + 24);
+  StoreLittleEndian(header.names_offset, bytes + 32);
+  StoreLittleEndian(header.records_offset, bytes + 40);
+}
+
+uint64_t IndexHash(const char *entry) {
+  return LoadLittleEndian<uint64_t>(entry);
+}
+
+uint32_t IndexPreset(const char *entry) {
+  return LoadLittleEndian<uint32_t>(entry + kIndexPresetOffset);
+}
+
+}  // namespace
+
+// The bank file's contents. Mapped where the platform allows, otherwise read
+// in full.
+class PresetBank::MappedFile {
+ public:
+  static std::unique_ptr<MappedFile> Open(const std::string &path) {
+    auto file = std::unique_ptr<MappedFile>(new MappedFile);
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return nullptr;
+    file->buffer_.assign(std::istreambuf_iterator<char>(in),
+                         std::istreambuf_iterator<char>());
+    file->data_ = file->buffer_.data();
+    file->size_ = file->buffer_.size();
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+      ::close(fd);
+      return nullptr;
+    }
+    void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    file->data_ = static_cast<const char *>(data);
+    file->size_ = st.st_size;
+#endif
+    return file;
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data_) ::munmap(const_cast<char *>(data_), size_);
+#endif
+  }
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile() = default;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  std::vector<char> buffer_;
+#endif
+};
+
+// static
+std::unique_ptr<PresetBank> PresetBank::Open(const std::string &path) {
+  auto file = MappedFile::Open(path);
+  if (!file) {
+    LOG(ERROR) << "Unable to open preset bank: " << path;
+    return nullptr;
+  }
+  const uint64_t size = file->size();
+  if (size < kHeaderSize) {
+    LOG(ERROR) << "Preset bank too short: " << path;
+    return nullptr;
+  }
+  const BankHeader header = LoadHeader(file->data());
+  if (header.magic != kPresetBankMagic) {
+    LOG(ERROR) << "Not a preset bank: " << path;
+    return nullptr;
+  }
+  if (header.version > kPresetBankVersion) {
+    LOG(ERROR) << "Preset bank version " << header.version
+               << " is newer than supported: " << kPresetBankVersion;
+    return nullptr;
+  }
+
+  if (!PatchRecordSane(header.num_generator_params,
+                       header.num_global_params)) {
+    LOG(ERROR) << "Corrupt preset bank layout: " << path;
+    return nullptr;
+  }
+
+  PatchLayout layout;
+  const uint64_t num_layout_params =
+      header.num_generator_params + header.num_global_params;
+  if (!InBounds(kHeaderSize, num_layout_params, sizeof(uint32_t), size)) {
+    LOG(ERROR) << "Truncated preset bank layout: " << path;
+    return nullptr;
+  }
+  const char *params = file->data() + kHeaderSize;
+  for (uint64_t i = 0; i < num_layout_params; i++) {
+    const uint32_t param_id =
+        LoadLittleEndian<uint32_t>(params + i * sizeof(uint32_t));
+    if (i < header.num_generator_params)
+      layout.generator_params.push_back(param_id);
+    else
+      layout.global_params.push_back(param_id);
+  }
+
+  const uint64_t num_presets = header.num_presets;
+  const uint64_t index_size = header.index_size;
+  const uint64_t record_size = layout.RecordSize(header.num_generators);
+  const bool index_ok = index_size > num_presets &&
+                        (index_size & (index_size - 1)) == 0 &&
+                        header.index_offset % 8 == 0 &&
+                        InBounds(header.index_offset, index_size,
+                                 kIndexEntrySize, size);
+  const bool names_ok =
+      InBounds(header.names_offset, num_presets, kNameEntrySize, size);
+  const bool records_ok =
+      header.records_offset % 8 == 0 &&
+      InBounds(header.records_offset, num_presets * record_size,
+               sizeof(double), size);
+  if (!index_ok || !names_ok || !records_ok) {
+    LOG(ERROR) << "Corrupt preset bank: " << path;
+    return nullptr;
+  }
+  // Every preset the index names must exist, and there must be empty entries
+  // to stop lookups of names that aren't there.
+  const char *index = file->data() + header.index_offset;
+  uint64_t num_indexed = 0;
+  for (uint64_t i = 0; i < index_size; i++) {
+    const uint32_t preset = IndexPreset(index + i * kIndexEntrySize);
+    if (preset == kEmptyIndexEntry) continue;
+    if (preset >= num_presets || ++num_indexed > num_presets) {
+      LOG(ERROR) << "Corrupt preset bank index: " << path;
+      return nullptr;
+    }
+  }
+  const char *names = file->data() + header.names_offset;
+  for (uint64_t i = 0; i < num_presets; i++) {
+    const char *entry = names + i * kNameEntrySize;
+    if (!InBounds(header.names_offset + LoadLittleEndian<uint32_t>(entry),
+                  LoadLittleEndian<uint32_t>(entry + 4), 1, size)) {
+      LOG(ERROR) << "Corrupt preset name in bank: " << path;
+      return nullptr;
+    }
+  }
+
+  return std::unique_ptr<PresetBank>(
+      new PresetBank(std::move(file), header, layout));
+}
+
+PresetBank::PresetBank(std::unique_ptr<MappedFile> file,
+                       const internal::BankHeader &header,
+                       const PatchLayout &layout)
+    : file_(std::move(file)),
+      header_(std::make_unique<const BankHeader>(header)),
+      index_(file_->data() + header.index_offset),
+      names_(file_->data() + header.names_offset),
+      records_(reinterpret_cast<const double *>(file_->data() +
+                                                header.records_offset)),
+      record_size_(layout.RecordSize(header.num_generators)),
+      map_(layout) {}
+
+PresetBank::~PresetBank() = default;
+
+// static
+uint64_t PresetBank::Hash(std::string_view name) {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : name) {
+    hash ^= c;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+size_t PresetBank::size() const { return header_->num_presets; }
+
+std::string_view PresetBank::name(size_t preset) const {
+  const char *entry = names_ + preset * kNameEntrySize;
+  return std::string_view(names_ + LoadLittleEndian<uint32_t>(entry),
+                          LoadLittleEndian<uint32_t>(entry + 4));
+}
+
+// Open validates the index, but lookups are bounded all the same, so that
+// nothing about the file can keep them probing forever.
+std::optional<size_t> PresetBank::Find(std::string_view name) const {
+  const uint64_t hash = Hash(name);
+  const uint32_t mask = header_->index_size - 1;
+  for (uint32_t probe = 0, i = hash & mask; probe < header_->index_size;
+       probe++, i = (i + 1) & mask) {
+    const char *entry = index_ + i * kIndexEntrySize;
+    const uint32_t preset = IndexPreset(entry);
+    if (preset == kEmptyIndexEntry) return std::nullopt;
+    if (IndexHash(entry) == hash && preset < size() &&
+        this->name(preset) == name)
+      return preset;
+  }
+  return std::nullopt;
+}
+
+std::optional<size_t> PresetBank::FindHash(uint64_t hash) const {
+  const uint32_t mask = header_->index_size - 1;
+  for (uint32_t probe = 0, i = hash & mask; probe < header_->index_size;
+       probe++, i = (i + 1) & mask) {
+    const char *entry = index_ + i * kIndexEntrySize;
+    const uint32_t preset = IndexPreset(entry);
+    if (preset == kEmptyIndexEntry) return std::nullopt;
+    if (IndexHash(entry) == hash && preset < size()) return preset;
+  }
+  return std::nullopt;
+}
+
+const double *PresetBank::Record(size_t preset) const {
+  return records_ + preset * record_size_;
+}
+
+void PresetBank::Apply(size_t preset, PatchProcessor *patch) const {
+  CHECK_LT(preset, size());
+  // Records are copied straight out of the file where the host's doubles are
+  // little-endian too; elsewhere they're decoded first.
+  if constexpr (std::endian::native == std::endian::little) {
+    patch->LoadRecord(map_, header_->num_generators, Record(preset));
+  } else {
+    const char *bytes = reinterpret_cast<const char *>(Record(preset));
+    std::vector<double> values(record_size_);
+    for (size_t i = 0; i < record_size_; i++) {
+      values[i] = std::bit_cast<double>(
+          LoadLittleEndian<uint64_t>(bytes + i * sizeof(double)));
+    }
+    patch->LoadRecord(map_, header_->num_generators, values.data());
+  }
+  patch->StructureChanged();
+}
+
+void PresetBankWriter::Add(const std::string &name,
+                           const PatchProcessor &patch) {
+  const size_t record_size = PatchLayout::Current().RecordSize(kNumGenerators);
+  auto [it, added] = presets_.emplace(name, names_.size());
+  if (added) {
+    names_.push_back(name);
+    records_.resize(records_.size() + record_size);
+  }
+  patch.SaveRecord(records_.data() + it->second * record_size);
+}
+
+bool PresetBankWriter::Write(const std::string &path) const {
+  const auto &layout = PatchLayout::Current();
+  const uint64_t num_presets = names_.size();
+  uint32_t index_size = 1;
+  while (index_size < 2 * num_presets) index_size *= 2;
+
+  BankHeader header{};
+  header.magic = kPresetBankMagic;
+  header.version = kPresetBankVersion;
+  header.num_generators = kNumGenerators;
+  header.num_generator_params = layout.generator_params.size();
+  header.num_global_params = layout.global_params.size();
+  header.num_presets = num_presets;
+  header.index_size = index_size;
+  header.index_offset = Align8(
+      kHeaderSize +
+      sizeof(uint32_t) *
+          (layout.generator_params.size() + layout.global_params.size()));
+  header.names_offset = header.index_offset + kIndexEntrySize * index_size;
+  uint64_t names_size = kNameEntrySize * num_presets;
+  for (const auto &name : names_) names_size += name.size();
+  header.records_offset = Align8(header.names_offset + names_size);
+
+  std::vector<char> data(header.records_offset +
+                         sizeof(double) * records_.size());
+  StoreHeader(header, data.data());
+  char *params = data.data() + kHeaderSize;
+  for (auto param_id : layout.generator_params) {
+    StoreLittleEndian(param_id, params);
+    params += sizeof(uint32_t);
+  }
+  for (auto param_id : layout.global_params) {
+    StoreLittleEndian(param_id, params);
+    params += sizeof(uint32_t);
+  }
+
+  char *index = data.data() + header.index_offset;
+  for (uint32_t i = 0; i < index_size; i++) {
+    StoreLittleEndian(kEmptyIndexEntry,
+                      index + i * kIndexEntrySize + kIndexPresetOffset);
+  }
+  char *names = data.data() + header.names_offset;
+  uint32_t name_offset = kNameEntrySize * num_presets;
+  for (uint32_t preset = 0; preset < num_presets; preset++) {
+    const auto &name = names_[preset];
+    StoreLittleEndian(name_offset, names + preset * kNameEntrySize);
+    StoreLittleEndian(uint32_t(name.size()),
+                      names + preset * kNameEntrySize + 4);
+    std::memcpy(names + name_offset, name.data(), name.size());
+    name_offset += name.size();
+
+    const uint64_t hash = PresetBank::Hash(name);
+    uint32_t i = hash & (index_size - 1);
+    while (IndexPreset(index + i * kIndexEntrySize) != kEmptyIndexEntry)
+      i = (i + 1) & (index_size - 1);
+    StoreLittleEndian(hash, index + i * kIndexEntrySize);
+    StoreLittleEndian(preset, index + i * kIndexEntrySize + kIndexPresetOffset);
+  }
+  char *records = data.data() + header.records_offset;
+  for (size_t i = 0; i < records_.size(); i++) {
+    StoreLittleEndian(std::bit_cast<uint64_t>(records_[i]),
+                      records + i * sizeof(double));
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(data.data(), data.size());
+  if (!out) {
+    LOG(ERROR) << "Unable to write preset bank: " << path;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "processor/patch_record.h"
+
+namespace sidebands {
+
+class PatchProcessor;
+
+namespace internal {
+struct BankHeader;
+}  // namespace internal
+
+// A file of named patch records, memory-mapped and read in place. A hash index
+// finds presets by name in constant time, and applying one is a bulk copy of
+// its record into the patch.
+//
+// Layout, little-endian, with the index and records 8-byte aligned:
+//   header
+//   layout: generator then global parameter IDs, shared by all records
+//   index: open-addressed hash table of (name hash, preset)
+//   names: (offset, length) per preset, then the names' characters
+//   records: one per preset, each PatchLayout::RecordSize values
+class PresetBank {
+ public:
+  // Map the bank at `path`; null if it can't be read or isn't valid.
+  static std::unique_ptr<PresetBank> Open(const std::string &path);
+  ~PresetBank();
+
+  static uint64_t Hash(std::string_view name);
+
+  size_t size() const;
+  std::string_view name(size_t preset) const;
+  std::optional<size_t> Find(std::string_view name) const;
+  // First preset whose name has `hash`.
+  std::optional<size_t> FindHash(uint64_t hash) const;
+
+  // Record values of `preset`, in the bank's layout.
+  const double *Record(size_t preset) const;
+  // Load `preset` into `patch`. Not for the patch being played: go through
+  // SidebandsProcessor::LoadPreset, which hands it to the audio thread.
+  void Apply(size_t preset, PatchProcessor *patch) const;
+
+ private:
+  class MappedFile;
+
+  PresetBank(std::unique_ptr<MappedFile> file,
+             const internal::BankHeader &header, const PatchLayout &layout);
+
+  std::unique_ptr<MappedFile> file_;
+  // Decoded from the file; the index and names are decoded as they're read.
+  std::unique_ptr<const internal::BankHeader> header_;
+  const char *index_;
+  const char *names_;
+  const double *records_;
+  size_t record_size_;
+  PatchLayoutMap map_;
+};
+
+// Collects patches and writes them out as a PresetBank file.
+class PresetBankWriter {
+ public:
+  // Add the patch's current values under `name`, replacing any preset already
+  // of that name.
+  void Add(const std::string &name, const PatchProcessor &patch);
+  bool Write(const std::string &path) const;
+
+ private:
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, size_t> presets_;
+  std::vector<double> records_;
+};
+
+}  // namespace sidebands
@@ -4,13 +4,19 @@
 #include <glog/logging.h>
 #include <pluginterfaces/vst/ivstevents.h>
 #include <pluginterfaces/vst/ivstparameterchanges.h>
-#include <public.sdk/source/vst/utility/processdataslicer.h>
 
-#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <set>
+#include <vector>
 
+#include "constants.h"
 #include "globals.h"
+#include "processor/live_analyser.h"
 #include "processor/patch_processor.h"
+#include "processor/spectrogram.h"
+#include "processor/synthesis/analytic_spectrum.h"
 #include "processor/synthesis/player.h"
 #include "sidebands_cids.h"
 #include "tags.h"
@@ -19,7 +25,9 @@ using namespace Steinberg;
 
 namespace sidebands {
 
-SidebandsProcessor::SidebandsProcessor() {
+SidebandsProcessor::SidebandsProcessor()
+    : output_tap_(kOutputTapSamples), slicer_(kMaxSliceSamples) {
+  pending_events_.reserve(kMaxPendingEvents);
   setControllerClass(kSidebandsControllerUID);
 }
 
@@ -48,10 +56,41 @@ tresult PLUGIN_API SidebandsProcessor::terminate() {
 }
 
 tresult PLUGIN_API SidebandsProcessor::setActive(TBool state) {
+  if (state) {
+    // Polyphony and voice layout size the voice pool, so they only take effect
+    // here, when the host (re)activates the plugin.
+    player_ = std::make_unique<Player>(patch_.get(), processSetup.sampleRate,
+                                       patch_->polyphony(),
+                                       patch_->voice_layout(), &output_tap_,
+                                       &dsp_load_);
+    dsp_load_.Prepare(processSetup.sampleRate);
+    dsp_load_percent_ = -1;
+    // Connect asynchronous events to update the UI.
+    player_->events.EnvelopeStageChange.connect(
+        &SidebandsProcessor::SendEnvelopeStageChangedEvent, this);
+  }
   return AudioEffect::setActive(state);
 }
 
+tresult PLUGIN_API SidebandsProcessor::setProcessing(TBool state) {
+  processing_ = state;
+  // A patch still waiting would otherwise wait until processing restarts.
+  if (!state && player_) {
+    auto program = standby_patch_.TakeOver(patch_.get());
+    if (program && player_->ReadyToInstallProgram())
+      player_->InstallProgram(std::move(program));
+    patch_fade_.Set(1.0, 0);
+  }
+  return AudioEffect::setProcessing(state);
+}
+
 tresult PLUGIN_API SidebandsProcessor::process(Vst::ProcessData &data) {
+  const Ticks start = ReadTicks();
+  dsp_load_.BeginBlock(data.numSamples);
+
+  // Patches loaded by setState take over between blocks.
+  if (standby_patch_.ready()) TakeOverStandbyPatch();
+
   Vst::IParameterChanges *p_changes = data.inputParameterChanges;
 
   // Parameter changes here.
@@ -71,81 +110,156 @@ tresult PLUGIN_API SidebandsProcessor::process(Vst::ProcessData &data) {
     }
   }
 
-  // Process inbound note/controller events.
-  auto *input_events = data.inputEvents;
-  if (input_events) {
+  // Queue inbound note/controller events in the order they fall in the block;
+  // they're dispatched at the start of the slice they land in. Events at the
+  // same offset keep the order they arrived in. Hosts almost always send them
+  // sorted already, so an insertion sort in place does next to no work, and
+  // unlike std::stable_sort never allocates. Past kMaxPendingEvents in a
+  // block, events are dropped rather than growing the queue.
+  pending_events_.clear();
+  if (auto *input_events = data.inputEvents) {
     int num_events = input_events->getEventCount();
     for (int i = 0; i < num_events; i++) {
       Vst::Event event;
-      input_events->getEvent(i, event);
-      switch (event.type) {
-        case Vst::Event::kNoteOnEvent:
-          player_->NoteOn(std::chrono::high_resolution_clock::now(),
-                          event.noteOn.noteId, event.noteOn.velocity,
-                          event.noteOn.pitch);
-          break;
-        case Vst::Event::kNoteOffEvent:
-          player_->NoteOff(event.noteOff.noteId, event.noteOff.pitch);
-          break;
-        case Vst::Event::kLegacyMIDICCOutEvent:
-          VLOG(1) << "Legacy CC control# " << std::hex
-                  << (int)event.midiCCOut.controlNumber
-                  << " value: " << (int)event.midiCCOut.value;
-          break;
-        default:
-          LOG(INFO) << "Other VST event type: " << event.type;
-          break;
+      if (input_events->getEvent(i, event) != kResultOk) continue;
+      if (pending_events_.size() == kMaxPendingEvents) break;
+      size_t pos = pending_events_.size();
+      pending_events_.push_back(event);
+      for (; pos > 0 &&
+             pending_events_[pos - 1].sampleOffset > event.sampleOffset;
+           pos--) {
+        pending_events_[pos] = pending_events_[pos - 1];
       }
+      pending_events_[pos] = event;
     }
   }
+  size_t next_event = 0;
+
+  // Process the block in slices split at parameter changes and events, so
+  // that they're reflected where they happen rather than once per block.
+  const int32 block_samples = data.numSamples;
+  auto processing_fn = [this, &next_event, block_samples](
+                           Steinberg::Vst::ProcessData &data,
+                           int32 slice_start) {
+    // Events before the end of this slice start here. The slicer cuts at
+    // event offsets, so that's exactly where they were scheduled unless the
+    // block has more than it cuts at; anything out of range goes at the
+    // nearest end of the block.
+    const int32 slice_end = slice_start + data.numSamples;
+    while (next_event < pending_events_.size() &&
+           (pending_events_[next_event].sampleOffset < slice_end ||
+            slice_end == block_samples)) {
+      HandleEvent(pending_events_[next_event++]);
+    }
 
-  // Process data in kSampleAccurateChunkSizeSamples so parameters changed
-  // mid-buffer have a chance to be reflected on a chunk by chunk basis.
-  Steinberg::Vst::ProcessDataSlicer slicer(kSampleAccurateChunkSizeSamples);
-  auto processing_fn = [this](Steinberg::Vst::ProcessData &data) {
-    auto *outputs = data.outputs;
+    // Advance parameters to the state they'd be in this slice.
+    patch_->AdvanceParameterChanges(data.numSamples);
 
-    // Advance parameters to the state they'd be in this chunk.
-    patch_->AdvanceParameterChanges(kSampleAccurateChunkSizeSamples);
+    if (!data.numOutputs || !data.outputs[0].numChannels) return;
+    auto &output = data.outputs[0];
 
-    // For now just the same thing on all channels. We'll eventually develop
-    // stereo functionality.
+    // The player renders straight into the first channel. For now every other
+    // channel gets the same thing; we'll eventually develop stereo
+    // functionality.
     if (data.symbolicSampleSize ==
         Steinberg::Vst::SymbolicSampleSizes::kSample32) {
-      std::vector<Vst::Sample32> output_buffer(data.numSamples, 0.0);
-      player_->Perform32(nullptr, output_buffer.data(), data.numSamples);
-      for (auto channel = 0; channel < outputs[0].numChannels; ++channel) {
-        for (auto sample_index = 0; sample_index < data.numSamples;
-             ++sample_index) {
-          outputs[0].channelBuffers32[channel][sample_index] =
-              output_buffer[sample_index];
-        }
+      auto **channels = output.channelBuffers32;
+      player_->Perform32(nullptr, channels[0], data.numSamples);
+      patch_fade_.Apply(channels[0], data.numSamples);
+      for (auto channel = 1; channel < output.numChannels; ++channel) {
+        std::memcpy(channels[channel], channels[0],
+                    data.numSamples * sizeof(Vst::Sample32));
       }
-      return;
-    }
-
-    if (data.symbolicSampleSize ==
-        Steinberg::Vst::SymbolicSampleSizes::kSample64) {
-      std::vector<Vst::Sample64> output_buffer(data.numSamples, 0.0);
-      player_->Perform64(nullptr, output_buffer.data(), data.numSamples);
-      for (auto channel = 0; channel < outputs[0].numChannels; ++channel) {
-        for (auto sample_index = 0; sample_index < data.numSamples;
-             ++sample_index) {
-          outputs[0].channelBuffers64[channel][sample_index] =
-              output_buffer[sample_index];
-        }
+    } else {
+      auto **channels = output.channelBuffers64;
+      player_->Perform64(nullptr, channels[0], data.numSamples);
+      patch_fade_.Apply(channels[0], data.numSamples);
+      for (auto channel = 1; channel < output.numChannels; ++channel) {
+        std::memcpy(channels[channel], channels[0],
+                    data.numSamples * sizeof(Vst::Sample64));
       }
-      return;
     }
   };
-  slicer.process<Steinberg::Vst::kSample32>(data, processing_fn);
+  slicer_.Process(data, processing_fn);
+
+  // Blocks with no samples (parameter flushes) have no slices, but may still
+  // carry events.
+  while (next_event < pending_events_.size()) {
+    HandleEvent(pending_events_[next_event++]);
+  }
 
   patch_->EndParameterChanges();
 
+  dsp_load_.EndBlock(ReadTicks() - start);
+  WriteDspLoad(data.outputParameterChanges);
+
   return kResultOk;
 }
 
+void SidebandsProcessor::WriteDspLoad(Vst::IParameterChanges *changes) {
+  if (!changes) return;
+  const double load = std::clamp(dsp_load_.smoothed_load(), 0.0, 1.0);
+  const int percent = std::lround(load * 100);
+  if (percent == dsp_load_percent_) return;
+  int32 index;
+  if (auto *queue = changes->addParameterData(
+          TagFor(0, TAG_DSP_LOAD, TARGET_NA), index)) {
+    queue->addPoint(0, load, index);
+    dsp_load_percent_ = percent;
+  }
+}
+
+void SidebandsProcessor::TakeOverStandbyPatch() {
+  const int64 fade_samples =
+      std::llround(patch_->patch_fade_ms() * processSetup.sampleRate / 1000);
+  // Sounding voices fade out under the old patch first, then back in under
+  // the new one.
+  if (player_->sounding() && fade_samples && patch_fade_.gain() != 0.0) {
+    if (patch_fade_.target() != 0.0) patch_fade_.Set(0.0, fade_samples);
+    return;
+  }
+  // The program for the last swap hasn't been handed over yet; next block.
+  if (!player_->ReadyToInstallProgram()) return;
+  if (auto program = standby_patch_.TakeOver(patch_.get()))
+    player_->InstallProgram(std::move(program));
+  patch_fade_.Set(1.0, fade_samples);
+}
+
+void SidebandsProcessor::HandleEvent(const Vst::Event &event) {
+  switch (event.type) {
+    case Vst::Event::kNoteOnEvent:
+      player_->NoteOn(event.noteOn.noteId, event.noteOn.velocity,
+                      event.noteOn.pitch);
+      break;
+    case Vst::Event::kNoteOffEvent:
+      player_->NoteOff(event.noteOff.noteId, event.noteOff.pitch);
+      break;
+    case Vst::Event::kLegacyMIDICCOutEvent:
+      VLOG(1) << "Legacy CC control# " << std::hex
+              << (int)event.midiCCOut.controlNumber
+              << " value: " << (int)event.midiCCOut.value;
+      break;
+    default:
+      // Other event types aren't used. Nothing is logged: this runs on the
+      // audio thread.
+      break;
+  }
+}
+
 tresult SidebandsProcessor::notify(Vst::IMessage *message) {
+  if (FIDStringsEqual(message->getMessageID(), kRequestLiveScopeMessageID) ||
+      FIDStringsEqual(message->getMessageID(),
+                      kRequestLiveSpectrumMessageID)) {
+    return SendLiveAnalysis(message);
+  }
+  if (FIDStringsEqual(message->getMessageID(), kRequestDspLoadMessageID))
+    return SendDspLoad();
+  if (FIDStringsEqual(message->getMessageID(), kRequestSpectrogramMessageID))
+    return SendSpectrogram(message);
+  if (FIDStringsEqual(message->getMessageID(), kCancelSpectrogramMessageID)) {
+    if (spectrogram_renderer_) spectrogram_renderer_->Cancel();
+    return kResultOk;
+  }
   if (!FIDStringsEqual(message->getMessageID(),
                        kRequestAnalysisBufferMessageID) &&
       !FIDStringsEqual(message->getMessageID(),
@@ -153,24 +267,59 @@ tresult SidebandsProcessor::notify(Vst::IMessage *message) {
     return ComponentBase::notify(message);
   }
 
+  // Analysis works from a copy of the patch; the live one is the audio
+  // thread's.
+  PatchProcessor patch;
+  patch.CopyFrom(*patch_);
+
   auto attributes = message->getAttributes();
 
-  int64 buffer_size;
-  int64 frequency;
-  int64 sample_rate;
-  int64 gennum;
+  int64 buffer_size = 0;
+  int64 frequency = 0;
+  int64 sample_rate = 0;
+  int64 gennum = -1;
   attributes->getInt(kBufferSizeAttr, buffer_size);
   attributes->getInt(kFreqAttr, frequency);
   attributes->getInt(kSampleRateAttr, sample_rate);
   attributes->getInt(kGennumAttr, gennum);
+  // Generator -1 is all of them, mixed.
+  if (gennum < -1 || gennum >= kNumGenerators) return kInvalidArgument;
+  buffer_size = std::clamp<int64>(buffer_size, 1, kMaxAnalysisBufferSize);
+
+  // Spectra are worked out from the patch directly and sent already reduced to
+  // the view's width, as floats.
+  if (FIDStringsEqual(message->getMessageID(),
+                      kRequestSpectrumBufferMessageID)) {
+    int64 width = buffer_size / 2;
+    int64 log_axis = 0;
+    attributes->getInt(kWidthAttr, width);
+    attributes->getInt(kLogAxisAttr, log_axis);
+    width = std::clamp<int64>(width, 1, kMaxSpectrogramSize);
+
+    Spectrum spectrum;
+    if (gennum == -1) {
+      for (auto &generator : patch.generators_) {
+        if (!generator->on()) continue;
+        AddGeneratorSpectrum(*generator, frequency, sample_rate,
+                             generator->a(), spectrum);
+      }
+    } else {
+      AddGeneratorSpectrum(*patch.generators_[gennum], frequency,
+                           sample_rate, 1.0, spectrum);
+    }
+    const auto columns =
+        SpectrumColumns(spectrum, sample_rate, width, log_axis != 0);
+    return SendBufferResponse(kResponseSpectrumBufferMessageID, sample_rate,
+                              gennum, frequency, columns.data(),
+                              columns.size(), sizeof(float));
+  }
 
   OscBuffer buffer(buffer_size);
-
-  // Produce buffer by making a one-off generator. Unless the generator is
-  // -1, in which case do a bunch and mix them together.
   if (gennum == -1) {
+    // Waveforms come from one-off generators, all of them mixed together for
+    // generator -1.
     buffer = 0.0;
-    for (auto &generator : patch_->generators_) {
+    for (auto &generator : patch.generators_) {
       if (!generator->on()) continue;
       OscBuffer mix_buffer(buffer_size);
       Generator analysis_generator;
@@ -181,27 +330,135 @@ tresult SidebandsProcessor::notify(Vst::IMessage *message) {
     }
   } else {
     Generator analysis_generator;
-    analysis_generator.Synthesize(sample_rate, *patch_->generators_[gennum],
+    analysis_generator.Synthesize(sample_rate, *patch.generators_[gennum],
                                   buffer, frequency);
   }
 
-  // Send a response with the buffer data.
-  if (auto env_change_message = owned(allocateMessage())) {
-    if (FIDStringsEqual(message->getMessageID(),
-                        kRequestAnalysisBufferMessageID))
-      env_change_message->setMessageID(kResponseAnalysisBufferMessageID);
-    else
-      env_change_message->setMessageID(kResponseSpectrumBufferMessageID);
+  return SendBufferResponse(kResponseAnalysisBufferMessageID, sample_rate,
+                            gennum, frequency, &buffer[0], buffer.size(),
+                            sizeof(double));
+}
+
+tresult SidebandsProcessor::SendLiveAnalysis(Vst::IMessage *message) {
+  if (!live_analyser_)
+    live_analyser_ = std::make_unique<LiveAnalyser>(&output_tap_);
+  live_analyser_->Request();
+
+  auto attributes = message->getAttributes();
+  const int64 sample_rate = processSetup.sampleRate;
+  if (FIDStringsEqual(message->getMessageID(), kRequestLiveScopeMessageID)) {
+    int64 buffer_size = LiveAnalyser::kFrameSize;
+    attributes->getInt(kBufferSizeAttr, buffer_size);
+    const auto scope = live_analyser_->Scope();
+    const size_t size =
+        std::clamp<size_t>(buffer_size, 1, LiveAnalyser::kFrameSize);
+    return SendBufferResponse(kResponseLiveScopeMessageID, sample_rate, -1, 0,
+                              scope.data() + scope.size() - size, size,
+                              sizeof(float));
+  }
+
+  int64 width = LiveAnalyser::kFrameSize / 2;
+  int64 log_axis = 0;
+  attributes->getInt(kWidthAttr, width);
+  attributes->getInt(kLogAxisAttr, log_axis);
+  width = std::clamp<int64>(width, 1, kMaxSpectrogramSize);
+  const auto bins = live_analyser_->Spectrum();
+  Spectrum spectrum;
+  spectrum.reserve(bins.size());
+  const double bin_width = double(sample_rate) / LiveAnalyser::kFrameSize;
+  for (size_t i = 1; i < bins.size(); i++)
+    spectrum.push_back({i * bin_width, bins[i]});
+  // Relative to full scale, so the level of the output shows.
+  const auto columns =
+      SpectrumColumns(spectrum, sample_rate, width, log_axis != 0, 1.0);
+  return SendBufferResponse(kResponseLiveSpectrumMessageID, sample_rate, -1, 0,
+                            columns.data(), columns.size(), sizeof(float));
+}
+
+tresult SidebandsProcessor::SendDspLoad() {
+  dsp_load_.Request();
+  const auto snapshot = dsp_load_.TakeSnapshot();
+  std::vector<float> stats;
+  stats.reserve((kDspLoadParts + kNumGenerators) * kDspLoadStatsPerPart);
+  auto append = [&stats](const LoadStats::Summary &summary) {
+    stats.push_back(summary.mean * 100);
+    stats.push_back(summary.p99 * 100);
+    stats.push_back(summary.max * 100);
+  };
+  append(snapshot.process);
+  append(snapshot.player);
+  append(snapshot.voice);
+  for (const auto &generator : snapshot.generators) append(generator);
+  return SendBufferResponse(kResponseDspLoadMessageID,
+                            processSetup.sampleRate, -1, 0, stats.data(),
+                            stats.size(), sizeof(float));
+}
+
+tresult SidebandsProcessor::SendSpectrogram(Vst::IMessage *message) {
+  if (!spectrogram_renderer_)
+    spectrogram_renderer_ = std::make_unique<SpectrogramRenderer>(patch_.get());
+
+  auto attributes = message->getAttributes();
+  SpectrogramRequest request;
+  int64 value;
+  if (attributes->getInt(kNoteAttr, value) == kResultOk) request.pitch = value;
+  if (attributes->getInt(kHoldMsAttr, value) == kResultOk)
+    request.hold_ms = std::clamp<int64>(value, 0, kMaxSpectrogramMs);
+  if (attributes->getInt(kReleaseMsAttr, value) == kResultOk)
+    request.release_ms = std::clamp<int64>(value, 0, kMaxSpectrogramMs);
+  if (attributes->getInt(kSampleRateAttr, value) == kResultOk && value > 0)
+    request.sample_rate = std::min<int64>(value, kMaxSpectrogramSampleRate);
+  if (attributes->getInt(kWidthAttr, value) == kResultOk)
+    request.width = std::clamp<int64>(value, 1, kMaxSpectrogramSize);
+  if (attributes->getInt(kHeightAttr, value) == kResultOk)
+    request.height = std::clamp<int64>(value, 1, kMaxSpectrogramSize);
+  if (attributes->getInt(kLogAxisAttr, value) == kResultOk)
+    request.log_axis = value != 0;
+  int64 have_version = -1;
+  attributes->getInt(kVersionAttr, have_version);
+
+  const auto spectrogram = spectrogram_renderer_->Get(request);
+  auto response = owned(allocateMessage());
+  if (!response) return kResultFalse;
+  response->setMessageID(kResponseSpectrogramMessageID);
+  auto *resp_attributes = response->getAttributes();
+  resp_attributes->setInt(kWidthAttr, request.width);
+  resp_attributes->setInt(kHeightAttr, request.height);
+  if (!spectrogram) {
+    resp_attributes->setInt(kProgressAttr, spectrogram_renderer_->progress());
+    resp_attributes->setInt(kBufferSizeAttr, 0);
+  } else {
+    resp_attributes->setInt(kProgressAttr, 100);
+    resp_attributes->setInt(kVersionAttr, spectrogram->patch_hash);
+    // The view already has these frames.
+    if (have_version == int64(spectrogram->patch_hash)) {
+      resp_attributes->setInt(kBufferSizeAttr, 0);
+    } else {
+      resp_attributes->setInt(kBufferSizeAttr, spectrogram->frames.size());
+      resp_attributes->setBinary(kBufferDataAttr, spectrogram->frames.data(),
+                                 spectrogram->frames.size() * sizeof(float));
+    }
+  }
+  sendMessage(response);
+  return kResultOk;
+}
+
+tresult SidebandsProcessor::SendBufferResponse(const char *message_id,
+                                               int64 sample_rate,
+                                               int64 gennum, int64 frequency,
+                                               const void *data, size_t size,
+                                               size_t element_size) {
+  if (auto response = owned(allocateMessage())) {
+    response->setMessageID(message_id);
 
-    auto *resp_attributes = env_change_message->getAttributes();
+    auto *resp_attributes = response->getAttributes();
     resp_attributes->setInt(kSampleRateAttr, sample_rate);
-    resp_attributes->setInt(kBufferSizeAttr, buffer.size());
+    resp_attributes->setInt(kBufferSizeAttr, size);
     resp_attributes->setInt(kGennumAttr, gennum);
     resp_attributes->setInt(kFreqAttr, frequency);
 
-    resp_attributes->setBinary(kBufferDataAttr, &buffer[0],
-                               buffer.size() * sizeof(double));
-    sendMessage(env_change_message);
+    resp_attributes->setBinary(kBufferDataAttr, data, size * element_size);
+    sendMessage(response);
 
     return Steinberg::kResultOk;
   }
@@ -215,11 +472,6 @@ SidebandsProcessor::setupProcessing(Vst::ProcessSetup &newSetup) {
             << " maxSamplesPerBlock: " << newSetup.maxSamplesPerBlock
             << " patch instance: " << patch_.get();
 
-  player_ = std::make_unique<Player>(patch_.get(), newSetup.sampleRate);
-  // Connect asynchronous events to update the UI.
-  player_->events.EnvelopeStageChange.connect(
-      &SidebandsProcessor::SendEnvelopeStageChangedEvent, this);
-
   return AudioEffect::setupProcessing(newSetup);
 }
 
@@ -236,7 +488,31 @@ tresult PLUGIN_API SidebandsProcessor::setState(IBStream *state) {
   // Here you set the state of the component (Processor part)
   if (!state) return kResultFalse;
 
-  return patch_->LoadPatch(state);
+  return LoadPatchWith(
+      [state](PatchProcessor *patch) { return patch->LoadPatch(state); });
+}
+
+tresult SidebandsProcessor::LoadPreset(const PresetBank &bank, size_t preset) {
+  if (preset >= bank.size()) {
+    LOG(ERROR) << "No preset " << preset << " in bank of " << bank.size();
+    return kInvalidArgument;
+  }
+  return LoadPatchWith([&bank, preset](PatchProcessor *patch) {
+    bank.Apply(preset, patch);
+    return kResultOk;
+  });
+}
+
+tresult SidebandsProcessor::LoadPatchWith(
+    const std::function<tresult(PatchProcessor *)> &load) {
+  // With nothing rendering, the patch can be loaded in place.
+  if (!player_ || !processing_) return load(patch_.get());
+
+  auto standby = std::make_unique<PatchProcessor>();
+  standby->CopyFrom(*patch_);
+  if (load(standby.get()) != kResultOk) return kResultFalse;
+  standby_patch_.Queue(*standby, player_->PrepareProgram(*standby));
+  return kResultOk;
 }
 
 tresult PLUGIN_API SidebandsProcessor::getState(IBStream *state) {
@@ -1,15 +1,28 @@
 #pragma once
 
+#include <pluginterfaces/vst/ivstevents.h>
 #include <pluginterfaces/vst/ivstparameterchanges.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <vector>
 
+#include "globals.h"
 #include "processor/patch_processor.h"
+#include "processor/preset_bank.h"
+#include "processor/standby_patch.h"
+#include "processor/util/block_slicer.h"
+#include "processor/util/dsp_load.h"
+#include "processor/util/gain_ramp.h"
+#include "processor/util/output_tap.h"
 #include "public.sdk/source/vst/vstaudioeffect.h"
 
 namespace sidebands {
 
+class LiveAnalyser;
 class Player;
+class SpectrogramRenderer;
 
 class SidebandsProcessor : public Steinberg::Vst::AudioEffect {
  public:
@@ -18,6 +31,7 @@ class SidebandsProcessor : public Steinberg::Vst::AudioEffect {
 
   // Create function
   static Steinberg::FUnknown *Instantiate(void * /*context*/) {
+    InitProcess();
     return (Steinberg::Vst::IAudioProcessor *)new SidebandsProcessor;
   }
 
@@ -41,6 +55,9 @@ class SidebandsProcessor : public Steinberg::Vst::AudioEffect {
   Steinberg::tresult PLUGIN_API
   canProcessSampleSize(Steinberg::int32 symbolicSampleSize) override;
 
+  Steinberg::tresult PLUGIN_API
+  setProcessing(Steinberg::TBool state) override;
+
   /** Here we go...the process call */
   Steinberg::tresult PLUGIN_API
   process(Steinberg::Vst::ProcessData &data) override;
@@ -50,12 +67,62 @@ class SidebandsProcessor : public Steinberg::Vst::AudioEffect {
   Steinberg::tresult PLUGIN_API getState(Steinberg::IBStream *state) override;
   Steinberg::tresult notify(Steinberg::Vst::IMessage *message) override;
 
+  // Switch to `preset` from `bank`, the way setState loads a patch.
+  Steinberg::tresult LoadPreset(const PresetBank &bank, size_t preset);
+
  private:
+  // Load a patch with `load`: into the live patch when nothing's rendering,
+  // otherwise into a standby patch, decoded and compiled on this thread for
+  // the audio thread to take over. Loads that leave out some parameters keep
+  // their current values either way.
+  Steinberg::tresult LoadPatchWith(
+      const std::function<Steinberg::tresult(PatchProcessor *)> &load);
   void SendEnvelopeStageChangedEvent(int note_id, int gennum, TargetTag target,
                                      off_t stage);
+  // Load the standby patch into the live one, once sounding voices have faded
+  // out. Called at the start of a block.
+  void TakeOverStandbyPatch();
+  // Dispatch a note/controller event to the player.
+  void HandleEvent(const Steinberg::Vst::Event &event);
+  // Reply to a live scope or spectrum request from the latest analysed frame.
+  Steinberg::tresult SendLiveAnalysis(Steinberg::Vst::IMessage *message);
+  // Reply to a spectrogram request with the spectrogram or its progress.
+  Steinberg::tresult SendSpectrogram(Steinberg::Vst::IMessage *message);
+  // Reply to a load meter request with the load since the last one.
+  Steinberg::tresult SendDspLoad();
+  // Report the smoothed load through the read-only DSP load parameter, when
+  // it has moved by a whole percent.
+  void WriteDspLoad(Steinberg::Vst::IParameterChanges *changes);
+  // Reply to an analysis request with `size` elements of `element_size` bytes.
+  Steinberg::tresult SendBufferResponse(const char *message_id,
+                                        Steinberg::int64 sample_rate,
+                                        Steinberg::int64 gennum,
+                                        Steinberg::int64 frequency,
+                                        const void *data, size_t size,
+                                        size_t element_size);
 
   std::unique_ptr<PatchProcessor> patch_;
+  // A patch loaded by setState or LoadPreset while processing, for process()
+  // to take over.
+  StandbyPatch standby_patch_;
+  // Fades the output out and back in around patch swaps.
+  GainRamp patch_fade_;
+  std::atomic<bool> processing_{false};
+  // What the player renders, for the live views. Outlives the player.
+  OutputTap output_tap_;
+  // Where the audio thread's time goes, for the load meter. Also outlives the
+  // player.
+  DspLoadMeter dsp_load_;
+  // Last percentage written to the DSP load parameter.
+  int dsp_load_percent_ = -1;
   std::unique_ptr<Player> player_;
+  // Started by the first live view request.
+  std::unique_ptr<LiveAnalyser> live_analyser_;
+  // Started by the first spectrogram request.
+  std::unique_ptr<SpectrogramRenderer> spectrogram_renderer_;
+  BlockSlicer slicer_;
+  // Events for the current block, sorted by sample offset.
+  std::vector<Steinberg::Vst::Event> pending_events_;
 };
 
 //------------------------------------------------------------------------
@@ -0,0 +1,164 @@
+#include "processor/spectrogram.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numbers>
+#include <numeric>
+
+#include "constants.h"
+#include "processor/synthesis/analytic_spectrum.h"
+#include "processor/synthesis/player.h"
+
+namespace sidebands {
+
+namespace {
+
+// Rendering counts for this share of the progress, the transform the rest.
+constexpr int kRenderProgress = 50;
+constexpr int32_t kSpectrogramNoteId = 0;
+
+}  // namespace
+
+SpectrogramRenderer::SpectrogramRenderer(PatchProcessor *patch)
+    : patch_(patch), plan_(kFrameSize), window_(kFrameSize) {
+  for (size_t i = 0; i < kFrameSize; i++) {
+    window_[i] = 0.5 * (1 - std::cos(2 * std::numbers::pi * i / kFrameSize));
+    window_gain_ += window_[i];
+  }
+  window_gain_ /= 2;
+  thread_ = std::thread(&SpectrogramRenderer::Run, this);
+}
+
+SpectrogramRenderer::~SpectrogramRenderer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    cancel_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+}
+
+std::shared_ptr<const Spectrogram> SpectrogramRenderer::Get(
+    const SpectrogramRequest &request) {
+  const uint64_t hash = patch_->SoundHash();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (result_ && result_->request == request && result_->patch_hash == hash)
+    return result_;
+  if (pending_ && *pending_ == request && pending_hash_ == hash)
+    return nullptr;
+  // Anything else in progress is now out of date.
+  cancel_ = pending_.has_value();
+  pending_ = request;
+  pending_hash_ = hash;
+  progress_ = 0;
+  wake_.notify_all();
+  return nullptr;
+}
+
+void SpectrogramRenderer::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!pending_) return;
+  pending_.reset();
+  cancel_ = true;
+}
+
+void SpectrogramRenderer::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this] { return stop_ || pending_; });
+    if (stop_) return;
+    const SpectrogramRequest request = *pending_;
+    const uint64_t hash = pending_hash_;
+    cancel_ = false;
+    lock.unlock();
+    auto result = Render(request, hash);
+    lock.lock();
+    // Only finish the request if it's still the one wanted.
+    if (result && pending_ && *pending_ == request &&
+        pending_hash_ == hash) {
+      result_ = std::move(result);
+      pending_.reset();
+    }
+  }
+}
+
+std::shared_ptr<const Spectrogram> SpectrogramRenderer::Render(
+    const SpectrogramRequest &request, uint64_t patch_hash) {
+  const SampleRate sample_rate = request.sample_rate;
+  const size_t hold_samples = sample_rate * request.hold_ms / 1000;
+  const size_t total_samples =
+      hold_samples + size_t(sample_rate * request.release_ms / 1000);
+  const size_t width = std::max(request.width, 1);
+  const size_t height = std::max(request.height, 1);
+
+  // Play the note through a player of its own, one voice, a slice at a time,
+  // on a copy of the patch. The live patch belongs to the audio thread, and a
+  // player on it would have its compiler rebuild the live program.
+  std::vector<double> audio(total_samples);
+  {
+    PatchProcessor patch;
+    patch.CopyFrom(*patch_);
+    Player player(&patch, sample_rate, 1, VoiceLayout::PER_VOICE);
+    player.NoteOn(kSpectrogramNoteId, request.velocity, request.pitch);
+    bool released = false;
+    for (size_t position = 0; position < total_samples;) {
+      if (cancel_) return nullptr;
+      if (position == hold_samples && !released) {
+        player.NoteOff(kSpectrogramNoteId, request.pitch);
+        released = true;
+      }
+      size_t frames = std::min<size_t>(kMaxSliceSamples,
+                                       total_samples - position);
+      if (position < hold_samples)
+        frames = std::min(frames, hold_samples - position);
+      player.Perform64(nullptr, &audio[position], frames);
+      position += frames;
+      progress_ = int(kRenderProgress * position / total_samples);
+    }
+  }
+
+  // Then a window centred on each frame's time, all in parallel.
+  auto spectrogram = std::make_shared<Spectrogram>();
+  spectrogram->request = request;
+  spectrogram->patch_hash = patch_hash;
+  spectrogram->frames.resize(width * height);
+  std::vector<size_t> frame_nums(width);
+  std::iota(frame_nums.begin(), frame_nums.end(), 0);
+  std::atomic<size_t> frames_done{0};
+  std::for_each(
+      std::execution::par, frame_nums.begin(), frame_nums.end(),
+      [&](size_t frame) {
+        if (cancel_) return;
+        const int64_t start = int64_t((frame + 0.5) * total_samples / width) -
+                              int64_t(kFrameSize / 2);
+        ComplexBuffer bins(kFrameSize);
+        for (size_t i = 0; i < kFrameSize; i++) {
+          const int64_t t = start + int64_t(i);
+          if (t >= 0 && t < int64_t(total_samples))
+            bins[i] = audio[t] * window_[i];
+        }
+        plan_.Forward(bins);
+        Spectrum spectrum;
+        spectrum.reserve(kFrameSize / 2);
+        const double bin_width = sample_rate / kFrameSize;
+        for (size_t i = 1; i < kFrameSize / 2; i++)
+          spectrum.push_back({i * bin_width, std::abs(bins[i]) / window_gain_});
+        const auto columns = SpectrumColumns(std::move(spectrum), sample_rate,
+                                             height, request.log_axis, 1.0);
+        std::copy(columns.begin(), columns.end(),
+                  spectrogram->frames.begin() + frame * height);
+        progress_ = kRenderProgress + int((100 - kRenderProgress) *
+                                          (frames_done.fetch_add(1) + 1) /
+                                          width);
+      });
+  if (cancel_) return nullptr;
+  VLOG(1) << "Rendered a " << width << "x" << height << " spectrogram of "
+          << total_samples << " samples";
+  return spectrogram;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "dsp/fft.h"
+#include "processor/patch_processor.h"
+
+namespace sidebands {
+
+using Steinberg::Vst::SampleRate;
+
+// One note to render and how to lay out its spectrogram.
+struct SpectrogramRequest {
+  int pitch = 60;
+  double velocity = 1.0;
+  // Time from note-on to note-off, and then how long to follow the release.
+  int hold_ms = 1000;
+  int release_ms = 1000;
+  SampleRate sample_rate = 48000;
+  // Time frames, and frequency rows per frame.
+  int width = 128;
+  int height = 128;
+  bool log_axis = true;
+
+  bool operator==(const SpectrogramRequest &) const = default;
+};
+
+struct Spectrogram {
+  SpectrogramRequest request;
+  // PatchProcessor::SoundHash() of the patch rendered.
+  uint64_t patch_hash;
+  // `width` frames of `height` rows, in dBFS as laid out by SpectrumColumns.
+  std::vector<float> frames;
+};
+
+// Renders a whole note, from note-on through its release, with the same
+// player, voice and generator code as live playback, and takes a spectrogram
+// of it. The note is played on a private copy of the patch. Work happens on a
+// background thread; the frames are transformed in parallel. The last result
+// is kept and handed back for as long as neither the request nor the way the
+// patch sounds changes.
+class SpectrogramRenderer {
+ public:
+  static constexpr size_t kFrameSize = 2048;
+
+  explicit SpectrogramRenderer(PatchProcessor *patch);
+  ~SpectrogramRenderer();
+
+  // The spectrogram for `request` of the patch as it is now, if it's ready.
+  // Otherwise starts rendering it, cancelling any other request in progress,
+  // and returns null.
+  std::shared_ptr<const Spectrogram> Get(const SpectrogramRequest &request);
+  // Abandons the request in progress, if any.
+  void Cancel();
+  // How far through the request in progress, 0 to 100.
+  int progress() const { return progress_.load(std::memory_order_relaxed); }
+
+ private:
+  void Run();
+  // Null if cancelled part way.
+  std::shared_ptr<const Spectrogram> Render(const SpectrogramRequest &request,
+                                            uint64_t patch_hash);
+
+  PatchProcessor *const patch_;
+  const FFTPlan plan_;
+  std::vector<double> window_;
+  double window_gain_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  // The request being worked on or waiting to be, and the result last
+  // finished.
+  std::optional<SpectrogramRequest> pending_;
+  uint64_t pending_hash_ = 0;
+  std::shared_ptr<const Spectrogram> result_;
+  std::atomic<bool> cancel_{false};
+  std::atomic<int> progress_{0};
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace sidebands
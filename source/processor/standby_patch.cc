@@ -0,0 +1,42 @@
+#include "processor/standby_patch.h"
+
+#include <thread>
+
+#include "constants.h"
+
+namespace sidebands {
+
+StandbyPatch::StandbyPatch()
+    : record_(PatchLayout::Current().RecordSize(kNumGenerators)),
+      map_(PatchLayout::Current()) {}
+
+void StandbyPatch::Queue(const PatchProcessor &patch,
+                         std::unique_ptr<RenderProgram> program) {
+  // Claim the record, unless the audio thread is reading it.
+  State state = state_.load(std::memory_order_acquire);
+  while (state == State::READING ||
+         !state_.compare_exchange_weak(state, State::WRITING,
+                                       std::memory_order_acquire)) {
+    if (state == State::READING) {
+      std::this_thread::yield();
+      state = state_.load(std::memory_order_acquire);
+    }
+  }
+  patch.SaveRecord(record_.data());
+  // Any program still waiting is freed here, rather than on the audio thread.
+  program_ = std::move(program);
+  state_.store(State::READY, std::memory_order_release);
+}
+
+std::unique_ptr<RenderProgram> StandbyPatch::TakeOver(PatchProcessor *live) {
+  State state = State::READY;
+  if (!state_.compare_exchange_strong(state, State::READING,
+                                      std::memory_order_acquire))
+    return nullptr;
+  live->LoadRecord(map_, kNumGenerators, record_.data());
+  auto program = std::move(program_);
+  state_.store(State::EMPTY, std::memory_order_release);
+  return program;
+}
+
+}  // namespace sidebands
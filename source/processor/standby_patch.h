@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "processor/patch_processor.h"
+#include "processor/synthesis/render_program.h"
+
+namespace sidebands {
+
+// A patch decoded, validated and compiled off the audio thread, waiting for
+// the audio thread to load it into the live patch at the start of a block.
+// It's kept as a patch record, so taking it over is a bulk copy, with nothing
+// allocated or freed on the audio thread, and no lock held while decoding.
+class StandbyPatch {
+ public:
+  StandbyPatch();
+
+  // Off the audio thread: queue `patch`'s values and the program prepared for
+  // them, replacing any patch still waiting. Waits while the audio thread is
+  // taking one over.
+  void Queue(const PatchProcessor &patch,
+             std::unique_ptr<RenderProgram> program);
+
+  bool ready() const {
+    return state_.load(std::memory_order_acquire) == State::READY;
+  }
+
+  // Load the waiting patch into `live`, returning its program to install; or
+  // nullptr if no patch is waiting. Called from the audio thread, or with it
+  // stopped. Takes no locks; installing the program counts the structure
+  // change.
+  std::unique_ptr<RenderProgram> TakeOver(PatchProcessor *live);
+
+ private:
+  enum class State { EMPTY, WRITING, READY, READING };
+
+  std::atomic<State> state_{State::EMPTY};
+  // The waiting patch, as a record of kNumGenerators in the current layout.
+  std::vector<double> record_;
+  std::unique_ptr<RenderProgram> program_;
+  const PatchLayoutMap map_;
+};
+
+}  // namespace sidebands
@@ -0,0 +1,112 @@
+#include "processor/synthesis/analytic_spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "constants.h"
+#include "dsp/integrator.h"
+#include "dsp/modfm_sidebands.h"
+
+namespace sidebands {
+
+namespace {
+
+constexpr int kMaxSidebands = 1024;
+// Sidebands this small are well under the silence threshold.
+constexpr double kNegligibleSideband = 1e-7;
+// Partials closer than this (in Hz) are the same partial.
+constexpr double kSameFrequency = 1e-9;
+
+// The analog oscillator's leaky integrator at `frequency`. Its DC blocker
+// passes everything but DC, so only the DC partial is dropped for it.
+Complex IntegratorResponse(double frequency, SampleRate sample_rate) {
+  const double omega = 2 * std::numbers::pi * frequency / sample_rate;
+  return 1.0 / (1.0 - Integrator().b1_ * std::polar(1.0, -omega));
+}
+
+}  // namespace
+
+void AddGeneratorSpectrum(const GeneratorPatch &patch, double note_freq,
+                          SampleRate sample_rate, double gain,
+                          Spectrum &spectrum) {
+  const bool analog = patch.osc_type() == GeneratorPatch::OscType::ANALOG;
+  // The analog oscillator starts from a ModFM pulse train with ten times the
+  // index, and no R or S.
+  const double k = analog ? patch.k() * 10 : patch.k();
+  const double r = analog ? 1.0 : patch.r();
+  const double s = analog ? 0.0 : patch.s();
+  const double carrier = note_freq * patch.c();
+  const double modulator = carrier * patch.m();
+  const double nyquist = sample_rate / 2;
+
+  for (int n = 0; n <= kMaxSidebands; n++) {
+    bool negligible = true;
+    for (int sideband : {n, -n}) {
+      if (n == 0 && sideband < 0) continue;
+      const double amplitude = ModFMSideband(sideband, k, r, s);
+      if (std::abs(amplitude) >= kNegligibleSideband) negligible = false;
+      double frequency = carrier + sideband * modulator;
+      Complex partial = amplitude * gain;
+      if (analog) {
+        if (frequency == 0) continue;
+        partial *= IntegratorResponse(frequency, sample_rate);
+      }
+      // Every partial starts in cosine phase, so a negative frequency folds
+      // over as the conjugate.
+      if (frequency < 0) {
+        frequency = -frequency;
+        partial = std::conj(partial);
+      }
+      if (frequency >= nyquist) continue;
+      spectrum.push_back({frequency, partial});
+    }
+    // Past the peak the sidebands only get smaller, and past Nyquist on both
+    // sides, none of them are heard.
+    if (n > k && negligible) break;
+    if (n * std::abs(modulator) >= nyquist + std::abs(carrier)) break;
+  }
+}
+
+std::vector<float> SpectrumColumns(Spectrum spectrum, SampleRate sample_rate,
+                                   size_t width, bool log_axis,
+                                   double reference) {
+  std::sort(spectrum.begin(), spectrum.end(),
+            [](const Partial &a, const Partial &b) {
+              return a.frequency < b.frequency;
+            });
+  const double nyquist = sample_rate / 2;
+  const double log_span = std::log(nyquist / kMinDisplayFrequency);
+  // Peak-hold: each column keeps its loudest partial.
+  std::vector<double> columns(width, 0.0);
+  double peak = 0;
+  for (size_t i = 0; i < spectrum.size();) {
+    Complex amplitude = 0;
+    const double frequency = spectrum[i].frequency;
+    for (; i < spectrum.size() &&
+           spectrum[i].frequency - frequency < kSameFrequency;
+         i++)
+      amplitude += spectrum[i].amplitude;
+    double position = frequency / nyquist;
+    if (log_axis) {
+      if (frequency < kMinDisplayFrequency) continue;
+      position = std::log(frequency / kMinDisplayFrequency) / log_span;
+    }
+    const size_t column = size_t(position * width);
+    if (column >= width) continue;
+    columns[column] = std::max(columns[column], std::abs(amplitude));
+    peak = std::max(peak, columns[column]);
+  }
+
+  std::vector<float> db(width, float(kSilenceThresholdDb));
+  if (reference > 0) peak = reference;
+  if (peak == 0) return db;
+  for (size_t c = 0; c < width; c++) {
+    if (columns[c] == 0) continue;
+    db[c] = float(std::max(kSilenceThresholdDb,
+                           20 * std::log10(columns[c] / peak)));
+  }
+  return db;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <vector>
+
+#include "dsp/fft.h"
+#include "processor/patch_processor.h"
+
+namespace sidebands {
+
+using Steinberg::Vst::SampleRate;
+
+// Lowest frequency on a logarithmic spectrum axis.
+constexpr double kMinDisplayFrequency = 20.0;
+
+// One line of a spectrum worked out from the patch, with its amplitude and
+// phase at the start of the note.
+struct Partial {
+  double frequency;
+  Complex amplitude;
+};
+
+using Spectrum = std::vector<Partial>;
+
+// Appends the partials of the generator's oscillator playing `note_freq`,
+// scaled by `gain`, up to Nyquist. They come from the oscillator's sidebands
+// in closed form, so this costs no synthesis or FFT and has no leakage.
+void AddGeneratorSpectrum(const GeneratorPatch &patch, double note_freq,
+                          SampleRate sample_rate, double gain,
+                          Spectrum &spectrum);
+
+// The spectrum reduced to `width` columns for display, spaced evenly in Hz or,
+// with `log_axis`, by octave from kMinDisplayFrequency. Each column holds the
+// loudest partial in it in dB, no lower than kSilenceThresholdDb, relative to
+// `reference` or if that's zero, to the loudest partial overall. Partials at
+// the same frequency are combined first.
+std::vector<float> SpectrumColumns(Spectrum spectrum, SampleRate sample_rate,
+                                   size_t width, bool log_axis,
+                                   double reference = 0);
+
+}  // namespace sidebands
@@ -7,16 +7,30 @@ namespace sidebands {
 void EnvelopeGenerator::Amplitudes(
     SampleRate sample_rate, OscBuffer &buffer, ParamValue velocity,
     const GeneratorPatch::ModParams *parameters) {
+  Amplitudes(sample_rate, std::begin(buffer), buffer.size(), velocity,
+             parameters);
+}
+
+void EnvelopeGenerator::Amplitudes(
+    SampleRate sample_rate, double *buffer, size_t frames, ParamValue velocity,
+    const GeneratorPatch::ModParams *parameters) {
   std::lock_guard<std::mutex> stages_lock(stages_mutex_);
   const auto &ev = parameters->envelope_parameters;
 
-  for (int i = 0; i < buffer.size(); i++) {
-    buffer[i] = NextSample(sample_rate, ev);
-  }
-
   // Apply velocity scaling.
   auto velocity_scale = ev.VS.getValue() * velocity + (1 - ev.VS.getValue());
-  VmulInplace(buffer, velocity_scale);
+  for (size_t i = 0; i < frames; i++) {
+    buffer[i] = NextSample() * velocity_scale;
+  }
+  Publish();
+}
+
+void EnvelopeGenerator::Publish() {
+  playing_.store(current_stage_ != 0, std::memory_order_relaxed);
+  level_.store(current_level_, std::memory_order_relaxed);
+  rising_.store(current_stage_ != 0 && current_stage_ != sustain_stage_ &&
+                    stages_[current_stage_].coefficient > 1.0,
+                std::memory_order_relaxed);
 }
 
 void EnvelopeGenerator::SetStage(off_t stage_number) {
@@ -25,10 +39,12 @@ void EnvelopeGenerator::SetStage(off_t stage_number) {
   if (current_stage_ >= stages_.size()) current_stage_ = 0;
 
   events.StageChange(current_stage_);
+
+  // Past the end of the last stage; the envelope has finished.
+  if (current_stage_ == 0) events.Done();
 }
 
-ParamValue EnvelopeGenerator::NextSample(
-    SampleRate sample_rate, const GeneratorPatch::EnvelopeValues &ev) {
+ParamValue EnvelopeGenerator::NextSample() {
   // Off or sustain...
   if (current_stage_ == 0 || current_stage_ == sustain_stage_)
     return current_level_;
@@ -44,7 +60,7 @@ ParamValue EnvelopeGenerator::NextSample(
   return current_level_;
 }
 
-off_t EnvelopeGenerator::AddStage(double sample_rate, const std::string &name,
+off_t EnvelopeGenerator::AddStage(double sample_rate, const char *name,
                                   double start_level, double end_level,
                                   double duration) {
   off_t idx = stages_.size();
@@ -66,9 +82,7 @@ void EnvelopeGenerator::On(SampleRate sample_rate,
   stages_.clear();
   const auto &env = parameters->envelope_parameters;
 
-  stages_ = {
-      Stage{"OFF", minimum_level_, minimum_level_, 0, 0},
-  };
+  stages_.push_back(Stage{"OFF", minimum_level_, minimum_level_, 0, 0});
   AddStage(sample_rate, "HT", minimum_level_, minimum_level_,
            env.HT.getValue());
   AddStage(sample_rate, "Attack", minimum_level_, env.AL.getValue(),
@@ -85,6 +99,7 @@ void EnvelopeGenerator::On(SampleRate sample_rate,
            env.RR2.getValue());
   SetStage(1);
   current_level_ = minimum_level_;
+  Publish();
 
   events.Start();
 }
@@ -95,6 +110,7 @@ void EnvelopeGenerator::Release(SampleRate sample_rate,
 
   events.Release();
   SetStage(release_stage_);
+  Publish();
 }
 
 void EnvelopeGenerator::Reset() {
@@ -105,6 +121,7 @@ void EnvelopeGenerator::Reset() {
   current_sample_index_ = 0;
   current_level_ = minimum_level_;
   current_stage_ = 0;
+  Publish();
 }
 
 Modulation::Type EnvelopeGenerator::mod_type() const {
@@ -112,8 +129,39 @@ Modulation::Type EnvelopeGenerator::mod_type() const {
 }
 
 bool EnvelopeGenerator::Playing() const {
+  return playing_.load(std::memory_order_relaxed);
+}
+
+ParamValue EnvelopeGenerator::Level() const {
+  return level_.load(std::memory_order_relaxed);
+}
+
+EnvelopeGenerator::Segment EnvelopeGenerator::CurrentSegment() const {
+  std::lock_guard<std::mutex> stages_lock(stages_mutex_);
+  // Off and sustain hold their level indefinitely.
+  if (current_stage_ == 0 || current_stage_ == sustain_stage_)
+    return {current_level_, 1.0, INT64_MAX};
+
+  const auto &stage = stages_[current_stage_];
+  auto samples_left = int64_t(
+      std::ceil(stage.duration_samples - double(current_sample_index_)));
+  return {current_level_, stage.coefficient ? stage.coefficient : 1.0,
+          (std::max)(samples_left, int64_t(0))};
+}
+
+void EnvelopeGenerator::CommitSegment(double level, int64_t samples) {
+  std::lock_guard<std::mutex> stages_lock(stages_mutex_);
+  current_level_ = level;
+  if (current_stage_ != 0 && current_stage_ != sustain_stage_)
+    current_sample_index_ += samples;
+  Publish();
+}
+
+ParamValue EnvelopeGenerator::Step() {
   std::lock_guard<std::mutex> stages_lock(stages_mutex_);
-  return current_stage_ != 0;
+  const ParamValue level = NextSample();
+  Publish();
+  return level;
 }
 
 }  // namespace sidebands
@@ -2,7 +2,9 @@
 
 #include <pluginterfaces/vst/vsttypes.h>
 
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 
 #include "dsp/oscbuffer.h"
 #include "processor/events.h"
@@ -18,13 +20,15 @@ namespace ui {
 class GraphicalEnvelopeEditorView;
 }  // namespace ui
 
-class EnvelopeGenerator : public IModulationSource {
+class EnvelopeGenerator final : public IModulationSource {
  public:
   explicit EnvelopeGenerator()
       : minimum_level_(0.0001),
         current_stage_(0),
         current_level_(minimum_level_),
-        current_sample_index_(0) {}
+        current_sample_index_(0) {
+    stages_.reserve(kNumStages);
+  }
 
   // IModulationSource overrides
   void On(SampleRate sample_rate,
@@ -35,26 +39,59 @@ class EnvelopeGenerator : public IModulationSource {
   void Amplitudes(SampleRate sample_rate, OscBuffer &buffer,
                   ParamValue velocity,
                   const GeneratorPatch::ModParams *parameters) override;
+  // Playing and Level read what the envelope last published, without
+  // locking, so are cheap to ask each slice.
   bool Playing() const override;
+  ParamValue Level() const override;
   Modulation::Type mod_type() const override;
 
+  // Whether the envelope is in a stage that takes it up, as a release can
+  // when its first level is above the sustain level.
+  bool Rising() const { return rising_.load(std::memory_order_relaxed); }
+
+  // As above, into the first `frames` of `buffer`.
+  void Amplitudes(SampleRate sample_rate, double *buffer, size_t frames,
+                  ParamValue velocity,
+                  const GeneratorPatch::ModParams *parameters);
+
+  // Direct access to the current stage, for renderers that advance many
+  // envelopes at once. For the next `samples_left` samples the level simply
+  // scales by `coefficient` each sample; the sample after that is a stage
+  // transition and has to go through Step().
+  struct Segment {
+    double level;
+    double coefficient;
+    int64_t samples_left;
+  };
+  Segment CurrentSegment() const;
+  // Record `samples` samples of the current segment as rendered, ending at
+  // `level`.
+  void CommitSegment(double level, int64_t samples);
+  // Produce a single sample, handling any stage transition.
+  ParamValue Step();
+
   EnvelopeEvents events;
 
  private:
-  ParamValue NextSample(SampleRate sample_rate,
-                        const GeneratorPatch::EnvelopeValues &ev);
+  ParamValue NextSample();
+  // Update playing_, level_ and rising_ from the stage state. With
+  // stages_mutex_ held.
+  void Publish();
 
   struct Stage {
-    std::string name;
+    const char *name;
     double start_level;
     double end_level;
     double coefficient;
     double duration_samples;
   };
-  off_t AddStage(double sample_rate, const std::string &name,
-                 double start_level, double end_level, double duration);
+  off_t AddStage(double sample_rate, const char *name, double start_level,
+                 double end_level, double duration);
   void SetStage(off_t stage_number);
 
+  // OFF, then HT through Release2. Room for them all is reserved up front, so
+  // that notes starting don't allocate.
+  static constexpr size_t kNumStages = 8;
   mutable std::mutex stages_mutex_;
   std::vector<Stage> stages_;
   off_t current_stage_ = 0;
@@ -64,6 +101,10 @@ class EnvelopeGenerator : public IModulationSource {
   const ParamValue minimum_level_;
   double current_level_;
   off_t current_sample_index_;
+
+  std::atomic<bool> playing_{false};
+  std::atomic<ParamValue> level_{0.0};
+  std::atomic<bool> rising_{false};
 };
 
 }  // namespace sidebands
\ No newline at end of file
@@ -10,16 +10,33 @@
 
 namespace sidebands {
 
+namespace {
+
+const double kSilenceThreshold = std::pow(10.0, kSilenceThresholdDb / 20.0);
+
+}  // namespace
+
+GeneratorScratch::GeneratorScratch() : out(kMaxSliceSamples) {
+  for (int target = 0; target < NUM_TARGETS; target++) {
+    value[target].resize(kMaxSliceSamples);
+    envelope[target].resize(kMaxSliceSamples);
+    lfo[target].resize(kMaxSliceSamples);
+  }
+}
+
 Generator::Generator() = default;
 
-void Generator::Produce(SampleRate sample_rate, GeneratorPatch &patch,
-                        OscParam &buffer, TargetTag target) {
-  auto value = patch.ParameterGetterFor(target)();
-  std::fill(std::begin(buffer), std::end(buffer), value);
-  auto mod_opt = patch.ModulationParams(target);
+// static
+bool Generator::Audible(ParamValue peak) { return peak >= kSilenceThreshold; }
+
+void Generator::Produce(SampleRate sample_rate,
+                        const GeneratorProgram &program, OscParam &buffer,
+                        TargetTag target) {
+  program.patch->FillParameter(target, buffer);
+  auto mod_opt = program.mod_params[target];
   if (mod_opt) {
     OscBuffer mod_a(buffer.size());
-    auto mod_types = patch.ModTypesFor(target);
+    const auto &mod_types = program.mod_types[target];
     for (int i = 0; i < Modulation::NumModulators; i++) {
       Modulation::Type mod_type = Modulation::Type(i);
       if (mod_types.test(mod_type)) {
@@ -33,6 +50,32 @@ void Generator::Produce(SampleRate sample_rate, GeneratorPatch &patch,
   }
 }
 
+const double *Generator::Produce(SampleRate sample_rate,
+                                 const GeneratorProgram &program,
+                                 GeneratorScratch &scratch, size_t frames,
+                                 TargetTag target) {
+  double *const value = std::begin(scratch.value[target]);
+  program.patch->FillParameter(target, value, frames);
+  const auto *mod_opt = program.mod_params[target];
+  if (!mod_opt) return value;
+  const auto &mod_types = program.mod_types[target];
+  const auto &envelope = modulators_[target][Modulation::Envelope];
+  if (mod_types.test(Modulation::Envelope) && envelope) {
+    double *const amplitudes = std::begin(scratch.envelope[target]);
+    static_cast<EnvelopeGenerator *>(envelope.get())
+        ->Amplitudes(sample_rate, amplitudes, frames, velocity_, mod_opt);
+    VmulInplace(value, amplitudes, frames);
+  }
+  const auto &lfo = modulators_[target][Modulation::LFO];
+  if (mod_types.test(Modulation::LFO) && lfo) {
+    double *const amplitudes = std::begin(scratch.lfo[target]);
+    static_cast<LFO *>(lfo.get())
+        ->Amplitudes(sample_rate, amplitudes, frames, velocity_, mod_opt);
+    VmulInplace(value, amplitudes, frames);
+  }
+  return value;
+}
+
 void Generator::Synthesize(SampleRate sample_rate, GeneratorPatch &patch,
                            OscBuffer &out_buffer,
                            Steinberg::Vst::ParamValue base_freq) {
@@ -50,69 +93,114 @@ void Generator::Synthesize(SampleRate sample_rate, GeneratorPatch &patch,
   o->Perform(sample_rate, out_buffer, params);
 }
 
-void Generator::Perform(SampleRate sample_rate, GeneratorPatch &patch,
-                        OscBuffer &out_buffer,
-                        Steinberg::Vst::ParamValue base_freq) {
-  auto frames_per_buffer = out_buffer.size();
-  OscParams params(frames_per_buffer);
+void Generator::Perform(SampleRate sample_rate, const GeneratorProgram &program,
+                        GeneratorScratch &scratch, double *mix_buffer,
+                        size_t frames, Steinberg::Vst::ParamValue base_freq) {
+  if (o_->osc_type() == program.osc_type && WavetableCurrent(program)) {
+    PlayWavetable(sample_rate, program, scratch, mix_buffer, frames,
+                  base_freq);
+    RetireIfInaudible(program);
+    return;
+  }
+  // The program's kernel fits so long as this generator has every modulator
+  // it routes and the oscillator it expects, which can stop being the case
+  // when the patch changes mid-note.
+  if (program.pipeline && (program.mods & ~configured_mods_) == 0 &&
+      o_->osc_type() == program.osc_type) {
+    program.pipeline(sample_rate, program, *this, scratch, mix_buffer, frames,
+                     base_freq);
+    RetireIfInaudible(program);
+    return;
+  }
 
-  OscParam A(frames_per_buffer);
+  OscParams params(frames);
+
+  OscParam A(frames);
 
   params.note_freq = base_freq;
-  Produce(sample_rate, patch, A, TARGET_A);
-  Produce(sample_rate, patch, params.K, TARGET_K);
-  Produce(sample_rate, patch, params.C, TARGET_C);
-  Produce(sample_rate, patch, params.R, TARGET_R);
-  Produce(sample_rate, patch, params.S, TARGET_S);
-  Produce(sample_rate, patch, params.M, TARGET_M);
+  Produce(sample_rate, program, A, TARGET_A);
+  Produce(sample_rate, program, params.K, TARGET_K);
+  Produce(sample_rate, program, params.C, TARGET_C);
+  Produce(sample_rate, program, params.R, TARGET_R);
+  Produce(sample_rate, program, params.S, TARGET_S);
+  Produce(sample_rate, program, params.M, TARGET_M);
 
+  if (!Audible(Vpeak(A))) {
+    o_->Advance(frames);
+    RetireIfInaudible(program);
+    return;
+  }
+
+  OscBuffer out_buffer(frames);
   o_->Perform(sample_rate, out_buffer, params);
 
-  // Apply envelope.
-  VmulInplace(out_buffer, A);
+  // Apply envelope and mix in.
+  VmulAddInplace(mix_buffer, std::begin(out_buffer), std::begin(A), frames);
+  RetireIfInaudible(program);
 }
 
-void Generator::NoteOn(
-    SampleRate sample_rate, const GeneratorPatch &patch,
-    std::chrono::high_resolution_clock::time_point start_time,
-    ParamValue velocity, uint8_t note) {
-  ConfigureModulators(patch);
-  if (!o_ || o_->osc_type() != patch.osc_type()) {
-    o_ = MakeOscillator(patch.osc_type());
+void Generator::PlayWavetable(SampleRate sample_rate,
+                              const GeneratorProgram &program,
+                              GeneratorScratch &scratch, double *mix_buffer,
+                              size_t frames,
+                              Steinberg::Vst::ParamValue base_freq) {
+  const double *A = Produce(sample_rate, program, scratch, frames, TARGET_A);
+  if (Audible(Vpeak(A, frames))) {
+    // The table holds one period of the note, so the oscillator's phase in
+    // samples gives how far into it to start.
+    const double phase =
+        static_cast<ModFMOscillator *>(o_.get())->phase() / sample_rate;
+    double *const out = std::begin(scratch.out);
+    program.wavetable->Play(base_freq, sample_rate, base_freq * phase, out,
+                            frames);
+    VmulAddInplace(mix_buffer, out, A, frames);
+  }
+  o_->Advance(frames);
+}
+
+void Generator::NoteOn(SampleRate sample_rate, const GeneratorProgram &program,
+                       SamplePosition start_time, ParamValue velocity,
+                       uint8_t note) {
+  ConfigureModulators(program);
+  if (!o_ || o_->osc_type() != program.osc_type) {
+    o_ = MakeOscillator(program.osc_type);
   }
 
   velocity_ = velocity;
+  released_ = false;
   for (auto target : kModulationTargets) {
-    auto mod_types = patch.ModTypesFor(target);
+    const auto &mod_types = program.mod_types[target];
     for (int i = 0; i < Modulation::NumModulators; i++) {
       Modulation::Type mod_type = Modulation::Type(i);
       if (mod_types.test(mod_type)) {
         auto &modulator = modulators_[target][mod_type];
         if (modulator)
-          modulator->On(sample_rate, patch.ModulationParams(target));
+          modulator->On(sample_rate, program.mod_params[target]);
       }
     }
   }
   events.GeneratorOn(this);
 }
 
-void Generator::NoteRelease(SampleRate sample_rate, const GeneratorPatch &patch,
-                            uint8_t note) {
+void Generator::NoteRelease(SampleRate sample_rate,
+                            const GeneratorProgram &program, uint8_t note) {
   for (auto target : kModulationTargets) {
-    auto mod_types = patch.ModTypesFor(target);
+    const auto &mod_types = program.mod_types[target];
     for (int i = 0; i < Modulation::NumModulators; i++) {
       Modulation::Type mod_type = Modulation::Type(i);
       if (mod_types.test(mod_type)) {
         auto &modulator = modulators_[target][mod_type];
         if (modulator)
-          modulator->Release(sample_rate, patch.ModulationParams(target));
+          modulator->Release(sample_rate, program.mod_params[target]);
       }
     }
   }
+  released_ = true;
   events.GeneratorRelease(this);
 }
 
 void Generator::Reset() {
+  released_ = false;
   for (const auto &target : kModulationTargets) {
     for (int i = 0; i < Modulation::NumModulators; i++) {
       auto &mod = modulators_[target][i];
@@ -121,10 +209,32 @@ void Generator::Reset() {
   }
 }
 
-void Generator::ConfigureModulators(const GeneratorPatch &patch) {
+ParamValue Generator::Level() const {
+  const auto &envelope = modulators_[TARGET_A][Modulation::Envelope];
+  if (!envelope || !envelope->Playing()) return 1.0;
+  return envelope->Level();
+}
+
+void Generator::RetireIfInaudible(const GeneratorProgram &program) {
+  if (!released_) return;
+  // Nothing here locks: the envelope's level is as it last published it, and
+  // the amplitude the value this slice was rendered to. While either is on its
+  // way back up the generator stays on, however quiet.
+  const auto &envelope = modulators_[TARGET_A][Modulation::Envelope];
+  if (envelope && static_cast<EnvelopeGenerator *>(envelope.get())->Rising())
+    return;
+  if (program.patch->ParameterRampFor(TARGET_A) > 0.0) return;
+  if (!Audible(Level() * std::abs(program.patch->a())))
+    events.GeneratorOff(this);
+}
+
+void Generator::ConfigureModulators(const GeneratorProgram &program) {
+  // Modulators are kept from note to note, and only made the first time a
+  // program routes them, so that notes starting don't allocate.
   for (const auto &target : kModulationTargets) {
-    auto mod_types = patch.ModTypesFor(target);
-    if (mod_types.test(Modulation::Envelope)) {
+    const auto &mod_types = program.mod_types[target];
+    auto &envelope = modulators_[target][Modulation::Envelope];
+    if (mod_types.test(Modulation::Envelope) && !envelope) {
       auto envgen = std::make_unique<EnvelopeGenerator>();
       // When the amplitude envelope is done, this generator is done.
       envgen->events.Done.connect([target, this] {
@@ -132,13 +242,17 @@ void Generator::ConfigureModulators(const GeneratorPatch &patch) {
           events.GeneratorOff(this);
         }
       });
-      envgen->events.StageChange.connect([target, this, &patch](off_t stage) {
-        events.EnvelopeStageChange(patch.gennum(), target, stage);
-      });
-      modulators_[target][Modulation::Envelope] = std::move(envgen);
+      envgen->events.StageChange.connect(
+          [target, this, gennum = program.gennum](off_t stage) {
+            events.EnvelopeStageChange(gennum, target, stage);
+          });
+      envelope = std::move(envgen);
+      configured_mods_ |= ModMaskBit(target, Modulation::Envelope);
     }
-    if (mod_types.test(Modulation::LFO)) {
-      modulators_[target][Modulation::LFO] = std::make_unique<LFO>();
+    auto &lfo = modulators_[target][Modulation::LFO];
+    if (mod_types.test(Modulation::LFO) && !lfo) {
+      lfo = std::make_unique<LFO>();
+      configured_mods_ |= ModMaskBit(target, Modulation::LFO);
     }
   }
 }
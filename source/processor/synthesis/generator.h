@@ -3,7 +3,6 @@
 #include <pluginterfaces/vst/vsttypes.h>
 
 #include <bitset>
-#include <chrono>
 #include <mutex>
 #include <vector>
 
@@ -11,11 +10,26 @@
 #include "processor/events.h"
 #include "processor/synthesis/envgen.h"
 #include "processor/synthesis/oscillator.h"
+#include "processor/synthesis/render_program.h"
 
 namespace sidebands {
 
 using Steinberg::Vst::SampleRate;
 
+// Working buffers for rendering one generator's slice, each kMaxSliceSamples
+// long. Generators render one at a time on each of the player's workers, so a
+// set per worker is all they need, and none of it is allocated per slice.
+struct GeneratorScratch {
+  GeneratorScratch();
+
+  // Each target's patch value, and its modulators' amplitudes.
+  OscBuffer value[NUM_TARGETS];
+  OscBuffer envelope[NUM_TARGETS];
+  OscBuffer lfo[NUM_TARGETS];
+  // Oscillator output still to be shaped.
+  OscBuffer out;
+};
+
 // Each "generator" represents a single oscillator + associated envelope
 // generators or other modulation sources.
 class Generator {
@@ -27,30 +41,63 @@ class Generator {
   void Synthesize(SampleRate sample_rate, GeneratorPatch &patch,
                   OscBuffer &out_buffer, Steinberg::Vst::ParamValue base_freq);
 
-  // Synthesize and apply modulation and envelope.
-  void Perform(SampleRate sample_rate, GeneratorPatch &patch,
-               OscBuffer &out_buffer, Steinberg::Vst::ParamValue base_freq);
+  // Synthesize `frames` samples, at most kMaxSliceSamples, and apply
+  // modulation and envelope, adding the result into `mix_buffer`.
+  void Perform(SampleRate sample_rate, const GeneratorProgram &program,
+               GeneratorScratch &scratch, double *mix_buffer, size_t frames,
+               Steinberg::Vst::ParamValue base_freq);
 
-  void NoteOn(SampleRate sample_rate, const GeneratorPatch &patch,
-              std::chrono::high_resolution_clock::time_point start_time,
-              ParamValue velocity, uint8_t note);
+  void NoteOn(SampleRate sample_rate, const GeneratorProgram &program,
+              SamplePosition start_time, ParamValue velocity, uint8_t note);
 
-  void NoteRelease(SampleRate sample_rate, const GeneratorPatch &patch,
+  void NoteRelease(SampleRate sample_rate, const GeneratorProgram &program,
                    uint8_t note);
 
   void Reset();
 
+  // Current level of the amplitude envelope, or unity if amplitude is not
+  // envelope modulated.
+  ParamValue Level() const;
+
+  // Whether a slice whose amplitude peaks at `peak` would be heard at all.
+  static bool Audible(ParamValue peak);
+  // Switch off if released and too quiet to be heard again. Called after each
+  // slice is rendered.
+  void RetireIfInaudible(const GeneratorProgram &program);
+
+  // The configured modulator for a target, or null if there is none.
+  IModulationSource *modulator(TargetTag target, Modulation::Type type) const {
+    return modulators_[target][type].get();
+  }
+  IOscillator *oscillator() const { return o_.get(); }
+  ParamValue velocity() const { return velocity_; }
+
   GeneratorEvents events;
 
  private:
-  void Produce(SampleRate sample_rate, GeneratorPatch &patch, OscParam &buffer,
-               TargetTag target);
-  void ConfigureModulators(const GeneratorPatch &patch);
+  void Produce(SampleRate sample_rate, const GeneratorProgram &program,
+               OscParam &buffer, TargetTag target);
+  // As above, into the first `frames` of the scratch value for `target`,
+  // with the modulators' amplitudes taken in their scratch buffers.
+  const double *Produce(SampleRate sample_rate,
+                        const GeneratorProgram &program,
+                        GeneratorScratch &scratch, size_t frames,
+                        TargetTag target);
+  // Plays the program's baked wavetable in place of the oscillator, keeping
+  // the oscillator's phase moving so it can take over again.
+  void PlayWavetable(SampleRate sample_rate, const GeneratorProgram &program,
+                     GeneratorScratch &scratch, double *mix_buffer,
+                     size_t frames,
+                     Steinberg::Vst::ParamValue base_freq);
+  void ConfigureModulators(const GeneratorProgram &program);
 
   std::unique_ptr<IModulationSource> modulators_[NUM_TARGETS]
                                                 [Modulation::NumModulators];
   ParamValue velocity_ = 0;
+  bool released_ = false;
   std::unique_ptr<IOscillator> o_;
+  // Modulators configured so far, as a mask.
+  ModMask configured_mods_ = 0;
 };
 
 }  // namespace sidebands
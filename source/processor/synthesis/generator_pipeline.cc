@@ -0,0 +1,196 @@
+#include "processor/synthesis/generator_pipeline.h"
+
+#include <vectorclass.h>
+#include <vectormath_exp.h>
+#include <vectormath_trig.h>
+
+#include <algorithm>
+#include <array>
+#include <numbers>
+
+#include "processor/synthesis/envgen.h"
+#include "processor/synthesis/generator.h"
+#include "processor/synthesis/lfo.h"
+#include "processor/synthesis/oscillator.h"
+
+namespace sidebands {
+
+namespace {
+
+using OscType = GeneratorPatch::OscType;
+
+constexpr double kPi2 = std::numbers::pi * 2.0;
+
+// One oscillator parameter for the slice. The patch value and each enabled
+// modulator's amplitudes are rendered into their own scratch buffers up front;
+// the kernel multiplies them together as it reads them.
+template <TargetTag TARGET, ModMask MODS>
+class TargetInput {
+ public:
+  static constexpr bool kEnvelope =
+      MODS & ModMaskBit(TARGET, Modulation::Envelope);
+  static constexpr bool kLFO = MODS & ModMaskBit(TARGET, Modulation::LFO);
+
+  TargetInput(SampleRate sample_rate, const GeneratorProgram &program,
+              Generator &generator, GeneratorScratch &scratch, size_t frames)
+      : value_(std::begin(scratch.value[TARGET])),
+        envelope_(std::begin(scratch.envelope[TARGET])),
+        lfo_(std::begin(scratch.lfo[TARGET])) {
+    program.patch->FillParameter(TARGET, value_, frames);
+    const auto *mod_params = program.mod_params[TARGET];
+    if constexpr (kEnvelope) {
+      static_cast<EnvelopeGenerator *>(
+          generator.modulator(TARGET, Modulation::Envelope))
+          ->Amplitudes(sample_rate, envelope_, frames, generator.velocity(),
+                       mod_params);
+    }
+    if constexpr (kLFO) {
+      static_cast<LFO *>(generator.modulator(TARGET, Modulation::LFO))
+          ->Amplitudes(sample_rate, lfo_, frames, generator.velocity(),
+                       mod_params);
+    }
+  }
+
+  Vec8d Load(size_t i, int n) const {
+    Vec8d value;
+    value.load_partial(n, value_ + i);
+    if constexpr (kEnvelope) {
+      Vec8d envelope;
+      envelope.load_partial(n, envelope_ + i);
+      value *= envelope;
+    }
+    if constexpr (kLFO) {
+      Vec8d lfo;
+      lfo.load_partial(n, lfo_ + i);
+      value *= lfo;
+    }
+    return value;
+  }
+
+  // Largest absolute value over the first `frames` samples.
+  double Peak(size_t frames) const {
+    Vec8d peak(0.0);
+    for (size_t i = 0; i < frames; i += 8)
+      peak = max(peak, abs(Load(i, std::min<size_t>(8, frames - i))));
+    return horizontal_max(peak);
+  }
+
+ private:
+  double *const value_;
+  double *const envelope_;
+  double *const lfo_;
+};
+
+template <OscType OSC, ModMask MODS>
+void RenderPipeline(SampleRate sample_rate, const GeneratorProgram &program,
+                    Generator &generator, GeneratorScratch &scratch,
+                    double *mix_buffer, size_t frames, ParamValue base_freq) {
+  const TargetInput<TARGET_A, MODS> A(sample_rate, program, generator, scratch,
+                                      frames);
+  const TargetInput<TARGET_K, MODS> K(sample_rate, program, generator, scratch,
+                                      frames);
+  const TargetInput<TARGET_C, MODS> C(sample_rate, program, generator, scratch,
+                                      frames);
+  const TargetInput<TARGET_R, MODS> R(sample_rate, program, generator, scratch,
+                                      frames);
+  const TargetInput<TARGET_S, MODS> S(sample_rate, program, generator, scratch,
+                                      frames);
+  const TargetInput<TARGET_M, MODS> M(sample_rate, program, generator, scratch,
+                                      frames);
+
+  // The modulators have all moved on above; if none of it would be heard, the
+  // oscillator just needs to keep its phase.
+  if (!Generator::Audible(A.Peak(frames))) {
+    generator.oscillator()->Advance(frames);
+    return;
+  }
+
+  const double sample_period = 1.0 / sample_rate;
+  const Vec8d index(0, 1, 2, 3, 4, 5, 6, 7);
+  const Vec8d note_freq(base_freq);
+
+  if constexpr (OSC == OscType::MOD_FM) {
+    auto *oscillator = static_cast<ModFMOscillator *>(generator.oscillator());
+    const double phase = oscillator->phase();
+    Vec8d mix;
+    for (size_t i = 0; i < frames; i += 8) {
+      const int n = std::min<size_t>(8, frames - i);
+      const Vec8d k = K.Load(i, n);
+      // Same formula as ModFMOscillator::Perform.
+      Vec8d T = (index + (phase + double(i))) * sample_period;
+      Vec8d omega_c = note_freq * C.Load(i, n) * kPi2 * T;
+      Vec8d omega_m = omega_c * M.Load(i, n);
+      Vec8d cos_omega_m;
+      Vec8d sin_omega_m = sincos(&cos_omega_m, omega_m);
+      Vec8d out = exp(R.Load(i, n) * k * cos_omega_m) *
+                  cos(omega_c + S.Load(i, n) * k * sin_omega_m) / exp(k);
+      mix.load_partial(n, &mix_buffer[i]);
+      mul_add(out, A.Load(i, n), mix).store_partial(n, &mix_buffer[i]);
+    }
+    oscillator->Advance(frames);
+  } else {
+    auto *oscillator = static_cast<AnalogOscillator *>(generator.oscillator());
+    const double phase = oscillator->phase();
+    double *const out_buffer = std::begin(scratch.out);
+    for (size_t i = 0; i < frames; i += 8) {
+      const int n = std::min<size_t>(8, frames - i);
+      const Vec8d k = K.Load(i, n) * 10;
+      // Same formula as AnalogOscillator::Perform.
+      Vec8d T = (index + (phase + double(i))) * sample_period;
+      Vec8d omega_c = note_freq * C.Load(i, n) * kPi2 * T;
+      Vec8d omega_m = omega_c * M.Load(i, n);
+      Vec8d out = exp(k * cos(omega_m) - k) * cos(omega_c);
+      out.store_partial(n, out_buffer + i);
+    }
+    oscillator->Advance(frames);
+    // The integrator and DC blocker run serially, so amplitude goes on after.
+    oscillator->Shape(out_buffer, frames);
+    Vec8d out, mix;
+    for (size_t i = 0; i < frames; i += 8) {
+      const int n = std::min<size_t>(8, frames - i);
+      out.load_partial(n, out_buffer + i);
+      mix.load_partial(n, &mix_buffer[i]);
+      mul_add(out, A.Load(i, n), mix).store_partial(n, &mix_buffer[i]);
+    }
+  }
+}
+
+struct PipelineEntry {
+  OscType osc_type;
+  ModMask mods;
+  GeneratorPipeline pipeline;
+};
+
+template <ModMask... MODS>
+constexpr auto MakePipelines() {
+  return std::array{
+      PipelineEntry{OscType::MOD_FM, MODS,
+                    &RenderPipeline<OscType::MOD_FM, MODS>}...,
+      PipelineEntry{OscType::ANALOG, MODS,
+                    &RenderPipeline<OscType::ANALOG, MODS>}...,
+  };
+}
+
+constexpr ModMask kEnvelopeA = ModMaskBit(TARGET_A, Modulation::Envelope);
+constexpr ModMask kEnvelopeK = ModMaskBit(TARGET_K, Modulation::Envelope);
+constexpr ModMask kLFOK = ModMaskBit(TARGET_K, Modulation::LFO);
+constexpr ModMask kLFOC = ModMaskBit(TARGET_C, Modulation::LFO);
+
+// The routings worth specialising: unmodulated, amplitude envelope only, the
+// default patch's amplitude and index envelopes, that plus an index LFO, and
+// vibrato.
+constexpr auto kPipelines =
+    MakePipelines<0, kEnvelopeA, kEnvelopeA | kEnvelopeK,
+                  kEnvelopeA | kEnvelopeK | kLFOK, kEnvelopeA | kLFOC>();
+
+}  // namespace
+
+GeneratorPipeline SelectGeneratorPipeline(GeneratorPatch::OscType osc_type,
+                                          ModMask mods) {
+  for (const auto &entry : kPipelines) {
+    if (entry.osc_type == osc_type && entry.mods == mods) return entry.pipeline;
+  }
+  return nullptr;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "processor/patch_processor.h"
+#include "processor/synthesis/render_program.h"
+
+namespace sidebands {
+
+// The specialised pipeline for this oscillator type and modulation routing, or
+// nullptr if it isn't one of the instantiated ones, in which case generators
+// take the generic path.
+GeneratorPipeline SelectGeneratorPipeline(GeneratorPatch::OscType osc_type,
+                                          ModMask mods);
+
+}  // namespace sidebands
@@ -1,5 +1,9 @@
 #include "processor/synthesis/lfo.h"
 
+#include <vectorclass.h>
+#include <vectormath_trig.h>
+
+#include <algorithm>
 #include <numbers>
 
 namespace sidebands {
@@ -27,35 +31,45 @@ void LFO::Reset() {
 void LFO::Amplitudes(SampleRate sample_rate, OscBuffer &buffer,
                      ParamValue velocity,
                      const GeneratorPatch::ModParams *parameters) {
-  const auto buffer_size = buffer.size();
+  Amplitudes(sample_rate, std::begin(buffer), buffer.size(), velocity,
+             parameters);
+}
+
+void LFO::Amplitudes(SampleRate sample_rate, double *buffer, size_t frames,
+                     ParamValue velocity,
+                     const GeneratorPatch::ModParams *parameters) {
   const auto &lfo_values = parameters->lfo_parameters;
   const auto freq = lfo_values.frequency.getValue();
   double phase_increment = kTwoPi * freq / sample_rate;
 
-  OscBuffer phases(buffer_size);
-
   // TODO: A way to do this non-incrementally, bulky bulk with SIMD?
-  for (int i = 0; i < buffer_size; i++) {
+  for (size_t i = 0; i < frames; i++) {
     phase_ += phase_increment;
-    phases[i] = phase_;
+    buffer[i] = phase_;
     if (phase_ >= kTwoPi) phase_ -= kTwoPi;
   }
 
-  buffer = kLFOTypes[off_t(lfo_values.type.getValue())] == LFOType::SIN
-               ? Vsin(phases)
-               : Vcos(phases);
-
-  last_level_ = buffer[0];
-
   auto velocity_scale = (lfo_values.velocity_sensivity.getValue() * velocity) +
                         (1 - lfo_values.velocity_sensivity.getValue());
   auto amplitude = lfo_values.amplitude.getValue() * velocity_scale;
 
-  VmulInplace(buffer, amplitude);
+  // The phases are turned into levels in place.
+  const bool sine =
+      kLFOTypes[off_t(lfo_values.type.getValue())] == LFOType::SIN;
+  for (size_t i = 0; i < frames; i += 8) {
+    const int n = std::min<size_t>(8, frames - i);
+    Vec8d phases;
+    phases.load_partial(n, buffer + i);
+    const Vec8d levels = sine ? sin(phases) : cos(phases);
+    if (i == 0) last_level_ = levels[0];
+    (levels * amplitude).store_partial(n, buffer + i);
+  }
 }
 
 bool LFO::Playing() const { return playing_; }
 
+ParamValue LFO::Level() const { return last_level_; }
+
 Modulation::Type LFO::mod_type() const { return Modulation::LFO; }
 
 }  // namespace sidebands
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 namespace sidebands {
 
-class LFO : public IModulationSource {
+class LFO final : public IModulationSource {
  public:
   // IModulationSource overrides
   void On(SampleRate sample_rate,
@@ -17,8 +17,22 @@ class LFO : public IModulationSource {
                   const GeneratorPatch::ModParams *parameters) override;
 
   bool Playing() const override;
+  ParamValue Level() const override;
   Modulation::Type mod_type() const override;
 
+  // As above, into the first `frames` of `buffer`.
+  void Amplitudes(SampleRate sample_rate, double *buffer, size_t frames,
+                  ParamValue velocity,
+                  const GeneratorPatch::ModParams *parameters);
+
+  // Direct access to the oscillator state, for renderers that advance many
+  // LFOs at once.
+  double phase() const { return phase_; }
+  void Commit(double phase, double level) {
+    phase_ = phase;
+    last_level_ = level;
+  }
+
  private:
   double phase_ = 0.0;
   double last_level_ = 0.0;
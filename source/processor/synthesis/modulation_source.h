@@ -24,6 +24,8 @@ class IModulationSource {
                           ParamValue velocity,
                           const GeneratorPatch::ModParams *parameters) = 0;
   virtual bool Playing() const = 0;
+  // The most recently produced modulation amplitude.
+  virtual ParamValue Level() const = 0;
   virtual Modulation::Type mod_type() const = 0;
 };
 
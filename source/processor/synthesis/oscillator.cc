@@ -22,10 +22,10 @@ void ModFMOscillator::Perform(Steinberg::Vst::SampleRate sample_rate,
                               OscBuffer &buffer, OscParams &params) {
   auto buffer_size = buffer.size();
 
-  // Accumulate the time multiplier based on current phase.
+  // Accumulate the time multiplier based on current phase, one sample period
+  // apart so consecutive blocks join up.
   OscParam T(buffer_size);
-  linspace(T, phase_ / sample_rate, (phase_ + buffer_size) / sample_rate,
-           buffer_size);
+  Vramp(T, phase_ / sample_rate, 1.0 / sample_rate);
   phase_ += buffer_size;
 
   auto freq = Vmul(params.note_freq, params.C);
@@ -55,10 +55,10 @@ void AnalogOscillator::Perform(Steinberg::Vst::SampleRate sample_rate,
                                OscBuffer &buffer, OscParams &params) {
   auto buffer_size = buffer.size();
 
-  // Accumulate the time multiplier based on current phase.
+  // Accumulate the time multiplier based on current phase, one sample period
+  // apart so consecutive blocks join up.
   OscParam T(buffer_size);
-  linspace(T, phase_ / sample_rate, (phase_ + buffer_size) / sample_rate,
-           buffer_size);
+  Vramp(T, phase_ / sample_rate, 1.0 / sample_rate);
   phase_ += buffer_size;
 
   auto freq = Vmul(params.note_freq, params.C);
@@ -74,10 +74,14 @@ void AnalogOscillator::Perform(Steinberg::Vst::SampleRate sample_rate,
   // Modulation index controls width of pulse.
   buffer = exp(params.K * cos(omega_m) - params.K) * cos(omega_c);
 
+  Shape(std::begin(buffer), buffer.size());
+}
+
+void AnalogOscillator::Shape(double *buffer, size_t frames) {
   // To go to saw from pulse, we need to integrate and then dc block as per the
   // paper.
-  int_.Filter(buffer);
-  dc_.Filter(buffer);
+  int_.Filter(buffer, frames);
+  dc_.Filter(buffer, frames);
 }
 
 std::unique_ptr<IOscillator> MakeOscillator(GeneratorPatch::OscType type) {
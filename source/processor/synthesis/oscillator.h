@@ -32,11 +32,14 @@ class IOscillator {
                        OscBuffer &buffer, OscParams &params) = 0;
   virtual GeneratorPatch::OscType osc_type() const = 0;
   virtual void Reset() = 0;
+  // Move on `frames` samples without rendering them, for when the output
+  // wouldn't be heard.
+  virtual void Advance(size_t frames) = 0;
 };
 
 std::unique_ptr<IOscillator> MakeOscillator(GeneratorPatch::OscType type);
 
-class ModFMOscillator : public IOscillator {
+class ModFMOscillator final : public IOscillator {
  public:
   ~ModFMOscillator() override = default;
   void Perform(Steinberg::Vst::SampleRate sample_rate, OscBuffer &buffer,
@@ -46,13 +49,17 @@ class ModFMOscillator : public IOscillator {
     return GeneratorPatch::OscType::MOD_FM;
   };
 
+  // Position in samples; for renderers that evaluate many oscillators at once.
+  double phase() const { return phase_; }
+  void Advance(size_t frames) override { phase_ += frames; }
+
  private:
   double phase_ = 0.0f;
 };
 
 // A virtual "analog" oscillator based on the same ModFM algorithm.
 // Mod ratio of "2" == square.  "1" == saw.
-class AnalogOscillator : public IOscillator {
+class AnalogOscillator final : public IOscillator {
  public:
   AnalogOscillator();
   ~AnalogOscillator() override = default;
@@ -63,6 +70,12 @@ class AnalogOscillator : public IOscillator {
     return GeneratorPatch::OscType::ANALOG;
   };
 
+  // Position in samples, and the integrator and DC blocker that turn the raw
+  // pulse train into the final waveform; for renderers with their own kernel.
+  double phase() const { return phase_; }
+  void Advance(size_t frames) override { phase_ += frames; }
+  void Shape(double *buffer, size_t frames);
+
  private:
   DCBlock2 dc_;
   Integrator int_;
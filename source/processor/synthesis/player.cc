@@ -2,70 +2,179 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <execution>
 #include <mutex>
+#include <numeric>
+#include <optional>
+#include <thread>
 
 #include "constants.h"
 #include "processor/synthesis/oscillator.h"
 
 namespace sidebands {
 
-Player::Player(PatchProcessor *patch, SampleRate sample_rate)
-    : patch_(patch), sample_rate_(sample_rate) {}
+namespace {
 
-bool Player::Perform(OscBuffer &mixdown_buffer) {
-  auto &g_patches = patch_->generators_;
-  std::vector<MixBuffers> mix_buffers(voices_.size());
+// Levels below this are all treated as silent when ranking voices.
+constexpr ParamValue kMinimumStealLevel = 1e-6;
 
-  auto frames_per_buffer = mixdown_buffer.size();
-  {
-    std::lock_guard<std::mutex> player_lock(voices_mutex_);
+// Upper bound on the number of workers voices are spread across, each of
+// which accumulates into its own mix buffer.
+constexpr size_t kMaxMixWorkers = 16;
 
-    // Fill buffers for each voice, in parallel, hopefully.
-    auto voice_player = [frames_per_buffer,
-                         this](std::pair<const int32_t, Voice> &voice) {
-      return voice.second.Perform(sample_rate_, frames_per_buffer, patch_);
-    };
+}  // namespace
 
-    std::transform(std::execution::par_unseq, voices_.begin(), voices_.end(),
-                   mix_buffers.begin(), voice_player);
+Player::Player(PatchProcessor *patch, SampleRate sample_rate, int num_voices,
+               VoiceLayout layout, OutputTap *tap, DspLoadMeter *load_meter)
+    : sample_rate_(sample_rate),
+      patch_(patch),
+      program_compiler_(patch),
+      num_voices_(std::clamp(num_voices, 1, kMaxVoices)),
+      layout_(layout),
+      tap_(tap),
+      load_meter_(load_meter) {
+  const int kVoicePoolSize = num_voices_ * 2;
+  voices_.reserve(kVoicePoolSize);
+  free_voices_.reserve(kVoicePoolSize);
+  active_voices_.reserve(kVoicePoolSize);
+  note_voices_.reserve(kVoicePoolSize);
+  for (int i = 0; i < kVoicePoolSize; i++) {
+    auto voice = std::make_unique<Voice>(load_meter);
+    voice->events.EnvelopeStageChange.connect(
+        [this](Voice *v, int gennum, TargetTag target, off_t stage) {
+          events.EnvelopeStageChange(v->note_id(), gennum, target, stage);
+        });
+    free_voices_.push_back(voice.get());
+    voices_.push_back(std::move(voice));
   }
+  if (layout_ == VoiceLayout::VOICE_LANES) {
+    const int num_groups = (kVoicePoolSize + kVoiceLanes - 1) / kVoiceLanes;
+    for (int i = 0; i < num_groups; i++)
+      voice_lanes_.push_back(std::make_unique<VoiceLanes>(load_meter));
+  }
+  const size_t num_workers = std::clamp<size_t>(
+      std::thread::hardware_concurrency(), 1, kMaxMixWorkers);
+  worker_mix_buffers_.assign(num_workers, OscBuffer(kMaxSliceSamples));
+  for (size_t w = 0; w < num_workers; w++)
+    worker_scratch_.push_back(std::make_unique<GeneratorScratch>());
+  workers_.resize(num_workers);
+  std::iota(workers_.begin(), workers_.end(), 0);
+  LOG(INFO) << "Player with " << num_voices_ << " voices, layout "
+            << int(layout_);
+}
+
+const double *Player::Perform(size_t frames_per_buffer) {
+  const Ticks start = ReadTicks();
+  std::lock_guard<std::mutex> player_lock(voices_mutex_);
+
+  // Work is either single voices or groups of kVoiceLanes voices, split into
+  // contiguous runs, one per worker.
+  const bool voice_lanes = layout_ == VoiceLayout::VOICE_LANES;
+  const size_t num_voices = active_voices_.size();
+  const size_t num_items =
+      voice_lanes ? (num_voices + kVoiceLanes - 1) / kVoiceLanes : num_voices;
+  const size_t num_workers = std::min(num_items, workers_.size());
+  const RenderProgram *program = &program_compiler_.Acquire();
+  const bool time_voices = load_meter_ && load_meter_->detailed();
+
+  // Each worker renders its voices straight into its own mix buffer, in
+  // parallel, hopefully.
+  std::for_each(
+      std::execution::par, workers_.begin(), workers_.begin() + num_workers,
+      [=, this](size_t worker) {
+        double *const worker_mix = std::begin(worker_mix_buffers_[worker]);
+        std::fill_n(worker_mix, frames_per_buffer, 0.0);
+        GeneratorScratch &scratch = *worker_scratch_[worker];
+        const size_t begin = worker * num_items / num_workers;
+        const size_t end = (worker + 1) * num_items / num_workers;
+        for (size_t item = begin; item < end; item++) {
+          const Ticks item_start = time_voices ? ReadTicks() : 0;
+          if (voice_lanes) {
+            const size_t first = item * kVoiceLanes;
+            const size_t lanes =
+                std::min<size_t>(kVoiceLanes, num_voices - first);
+            voice_lanes_[item]->Perform(sample_rate_, *program,
+                                        &active_voices_[first], lanes,
+                                        scratch, worker_mix,
+                                        frames_per_buffer);
+            // Voices in lanes are rendered together, so share the time.
+            if (time_voices) {
+              const Ticks elapsed = (ReadTicks() - item_start) / lanes;
+              for (size_t lane = 0; lane < lanes; lane++)
+                load_meter_->AddVoice(elapsed, frames_per_buffer);
+            }
+          } else {
+            active_voices_[item]->Perform(
+                sample_rate_, *program, layout_ == VoiceLayout::GENERATOR_LANES,
+                scratch, worker_mix, frames_per_buffer);
+            if (time_voices)
+              load_meter_->AddVoice(ReadTicks() - item_start,
+                                    frames_per_buffer);
+          }
+        }
+      });
+
+  sample_clock_ += frames_per_buffer;
+  UpdateVoices();
 
-  // Mix down.
-  if (!mix_buffers.empty()) {
-    for (auto &voice_mix_buffers : mix_buffers) {
-      for (auto &voice_mix_buffer : voice_mix_buffers)
-        VaddInplace(mixdown_buffer, *voice_mix_buffer);
+  if (!num_workers) {
+    if (tap_) tap_->WriteSilence(frames_per_buffer);
+    if (load_meter_) load_meter_->AddPlayer(ReadTicks() - start);
+    return nullptr;
+  }
+
+  // Pairwise tree reduction of the worker buffers, so the serial part of the
+  // mix depends on the number of workers rather than voices.
+  for (size_t stride = 1; stride < num_workers; stride *= 2) {
+    for (size_t w = 0; w + stride < num_workers; w += stride * 2) {
+      VaddInplace(std::begin(worker_mix_buffers_[w]),
+                  std::begin(worker_mix_buffers_[w + stride]),
+                  frames_per_buffer);
     }
-    return true;
   }
 
-  return false;
+  const double *mix = std::begin(worker_mix_buffers_[0]);
+  if (tap_) tap_->Write(mix, frames_per_buffer);
+  if (load_meter_) load_meter_->AddPlayer(ReadTicks() - start);
+  return mix;
 }
 
 bool Player::Perform32(Sample32 *in_buffer, Sample32 *out_buffer,
                        size_t frames_per_buffer) {
-  memset(out_buffer, 0, frames_per_buffer * sizeof(Sample32));
-  MixBuffer mixdown_buffer(0.0f, frames_per_buffer);
-  if (Perform(mixdown_buffer)) {
-    ToFloat(mixdown_buffer, out_buffer);
+  for (size_t offset = 0; offset < frames_per_buffer;) {
+    const size_t frames =
+        std::min<size_t>(kMaxSliceSamples, frames_per_buffer - offset);
+    const double *mix = Perform(frames);
+    if (mix) {
+      ToFloat(mix, frames, out_buffer + offset);
+    } else {
+      std::memset(out_buffer + offset, 0, frames * sizeof(Sample32));
+    }
+    offset += frames;
   }
   return true;
 }
 
 bool Player::Perform64(Sample64 *in_buffer, Sample64 *out_buffer,
                        size_t frames_per_buffer) {
-  memset(out_buffer, 0, frames_per_buffer * sizeof(Sample32));
-  MixBuffer mixdown_buffer(0.0f, frames_per_buffer);
-  if (Perform(mixdown_buffer)) {
-    std::memcpy(out_buffer, &mixdown_buffer[0], frames_per_buffer);
+  for (size_t offset = 0; offset < frames_per_buffer;) {
+    const size_t frames =
+        std::min<size_t>(kMaxSliceSamples, frames_per_buffer - offset);
+    const double *mix = Perform(frames);
+    if (mix) {
+      std::memcpy(out_buffer + offset, mix, frames * sizeof(Sample64));
+    } else {
+      std::memset(out_buffer + offset, 0, frames * sizeof(Sample64));
+    }
+    offset += frames;
   }
   return true;
 }
 
-void Player::NoteOn(std::chrono::high_resolution_clock::time_point start_time,
-                    int32_t note_id, ParamValue velocity, int16_t pitch) {
+void Player::NoteOn(int32_t note_id, ParamValue velocity, int16_t pitch) {
   std::lock_guard<std::mutex> player_lock(voices_mutex_);
 
   // If we were sent a note ID of -1, it means the host is not capable of
@@ -75,13 +184,10 @@ void Player::NoteOn(std::chrono::high_resolution_clock::time_point start_time,
   }
   Voice *v = NewVoice(note_id);
   assert(v != nullptr);
-  v->events.EnvelopeStageChange.connect(
-      [this, note_id](Voice *v, int gennum, TargetTag target, off_t stage) {
-        events.EnvelopeStageChange(note_id, gennum, target, stage);
-      });
 
   // TODO legato, portamento, etc.
-  v->NoteOn(sample_rate_, patch_, start_time, velocity, pitch);
+  v->NoteOn(sample_rate_, program_compiler_.Acquire(), note_id, sample_clock_,
+            velocity, pitch);
 }
 
 void Player::NoteOff(int32_t note_id, int16_t pitch) {
@@ -93,39 +199,93 @@ void Player::NoteOff(int32_t note_id, int16_t pitch) {
   }
 
   // Find the voice playing this note id and send it a note-off event.
-  auto voice_it = voices_.find(note_id);
-  if (voice_it == voices_.end()) {
+  auto voice_it = note_voices_.find(note_id);
+  if (voice_it == note_voices_.end()) {
     LOG(ERROR) << "Unable to find voice for: " << std::hex << note_id;
     return;
   }
-  voice_it->second.NoteRelease(sample_rate_, patch_, pitch);
+  voice_it->second->NoteRelease(sample_rate_, program_compiler_.Acquire(),
+                                pitch);
 }
 
 Voice *Player::NewVoice(int32_t note_id) {
-  if (voices_.size() < kNumVoices) {
-    return &voices_[note_id];
+  // Retrigger the voice already playing this note, if there is one.
+  auto voice_it = note_voices_.find(note_id);
+  if (voice_it != note_voices_.end()) {
+    return voice_it->second;
   }
 
-  // No free voice? Find the one with the lowest timestamp, shut it off, and
-  // allocate a new one.
-  std::chrono::high_resolution_clock::time_point least_ts =
-      std::chrono::high_resolution_clock::now();
-
-  auto stolen_voice_it = voices_.end();
-  for (auto voice_it = voices_.begin(); voice_it != voices_.end(); voice_it++) {
-    if (voice_it->second.on_time() < least_ts) {
-      stolen_voice_it = voice_it;
-      least_ts = voice_it->second.on_time();
-    }
+  Voice *stolen_voice = nullptr;
+  if (note_voices_.size() >= size_t(num_voices_) || free_voices_.empty()) {
+    stolen_voice = StealVoice();
   }
-  if (stolen_voice_it == voices_.end()) {
+
+  Voice *voice;
+  if (!free_voices_.empty()) {
+    voice = free_voices_.back();
+    free_voices_.pop_back();
+    active_voices_.push_back(voice);
+  } else if (stolen_voice) {
+    // Every spare voice is still fading out from earlier steals, so this one
+    // has to be cut off instead.
+    stolen_voice->Reset();
+    voice = stolen_voice;
+  } else {
     return nullptr;
   }
 
-  stolen_voice_it->second.Reset();
-  voices_.erase(stolen_voice_it);
+  note_voices_[note_id] = voice;
+  return voice;
+}
+
+Voice *Player::StealVoice() {
+  // Only voices still playing a note can be stolen; ones already stolen are
+  // fading out, and unmapped.
+  std::optional<StealCandidate> best;
+  for (Voice *voice : active_voices_) {
+    auto voice_it = note_voices_.find(voice->note_id());
+    if (voice_it == note_voices_.end() || voice_it->second != voice) continue;
+    const StealCandidate candidate = RankForSteal(voice);
+    if (!best || *best < candidate) best = candidate;
+  }
+  if (!best) return nullptr;
+
+  Voice *voice = best->voice;
+  note_voices_.erase(voice->note_id());
+  voice->Steal(sample_rate_);
+  return voice;
+}
+
+Player::StealCandidate Player::RankForSteal(Voice *voice) const {
+  const ParamValue level = std::max(voice->Level(), kMinimumStealLevel);
+  const int level_bucket =
+      int(std::floor(20.0 * std::log10(level) / kVoiceStealLevelBucketDb));
+  return {voice->Released(), level_bucket, voice->on_time(), voice};
+}
+
+void Player::UpdateVoices() {
+  for (size_t i = 0; i < active_voices_.size();) {
+    Voice *voice = active_voices_[i];
+    if (voice->Playing()) {
+      i++;
+      continue;
+    }
+
+    // Done playing (or done fading out); return it to the pool.
+    auto voice_it = note_voices_.find(voice->note_id());
+    if (voice_it != note_voices_.end() && voice_it->second == voice) {
+      note_voices_.erase(voice_it);
+    }
+    free_voices_.push_back(voice);
+    active_voices_[i] = active_voices_.back();
+    active_voices_.pop_back();
+  }
+}
 
-  return &voices_[note_id];
+bool Player::StealCandidate::operator<(const StealCandidate &o) const {
+  if (released != o.released) return o.released;
+  if (level_bucket != o.level_bucket) return level_bucket > o.level_bucket;
+  return on_time > o.on_time;
 }
 
-}  // namespace sidebands
\ No newline at end of file
+}  // namespace sidebands
@@ -1,9 +1,10 @@
 #pragma once
 
+#include <absl/container/flat_hash_map.h>
 #include <pluginterfaces/vst/vsttypes.h>
 
 #include <array>
-#include <chrono>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -12,7 +13,11 @@
 #include "processor/synthesis/envgen.h"
 #include "processor/synthesis/generator.h"
 #include "processor/synthesis/oscillator.h"
+#include "processor/synthesis/render_program.h"
 #include "processor/synthesis/voice.h"
+#include "processor/synthesis/voice_lanes.h"
+#include "processor/util/dsp_load.h"
+#include "processor/util/output_tap.h"
 
 namespace sidebands {
 
@@ -24,35 +29,109 @@ using Steinberg::Vst::Sample64;
 // fills and mixes audio buffers from playing voices.
 class Player {
  public:
-  Player(PatchProcessor *patch, SampleRate sample_rate);
+  // `num_voices` is the polyphony; `layout` selects whether voices render one
+  // at a time or packed kVoiceLanes to a SIMD vector. The mix is copied into
+  // `tap`, if there is one, for analysis, and rendering is timed into
+  // `load_meter`, if there is one.
+  Player(PatchProcessor *patch, SampleRate sample_rate, int num_voices,
+         VoiceLayout layout, OutputTap *tap = nullptr,
+         DspLoadMeter *load_meter = nullptr);
 
-  // Fill the audio buffer.
+  // Fill the audio buffer. The mix is rendered in double precision, in slices
+  // of at most kMaxSliceSamples, and written to `out_buffer` once, converting
+  // for 32-bit output.
   bool Perform32(Sample32 *in_buffer, Sample32 *out_buffer,
                  size_t frames_per_buffer);
   bool Perform64(Sample64 *in_buffer, Sample64 *out_buffer,
                  size_t frames_per_buffer);
-  // Signal note-on to all voices and generators.
-  void NoteOn(std::chrono::high_resolution_clock::time_point start_time,
-              int32_t note_id, ParamValue velocity, int16_t pitch);
+  // Signal note-on to all voices and generators. The note starts at the
+  // current position of the sample clock.
+  void NoteOn(int32_t note_id, ParamValue velocity, int16_t pitch);
 
   // Signal note-off.
   void NoteOff(int32_t, int16_t pitch);
 
+  // Number of samples rendered since the player was created.
+  SamplePosition sample_clock() const { return sample_clock_; }
+  // Whether any voice is sounding.
+  bool sounding() const { return !active_voices_.empty(); }
+
+  // Patch swaps: the program for a patch about to be loaded is compiled ahead
+  // of time, and installed by the audio thread once its values are. See
+  // RenderProgramCompiler.
+  std::unique_ptr<RenderProgram> PrepareProgram(const PatchProcessor &standby) {
+    return program_compiler_.Prepare(standby);
+  }
+  bool ReadyToInstallProgram() const {
+    return program_compiler_.ReadyToInstall();
+  }
+  void InstallProgram(std::unique_ptr<RenderProgram> program) {
+    program_compiler_.Install(std::move(program));
+  }
+
   PlayerEvents events;
 
  private:
+  // A voice which could be stolen, ranked by how little it would be missed.
+  struct StealCandidate {
+    bool released;
+    int level_bucket;
+    SamplePosition on_time;
+    Voice *voice;
+
+    // The candidate that compares greatest is stolen first. Released voices
+    // go first, then the quietest, then the oldest.
+    bool operator<(const StealCandidate &o) const;
+  };
+
   // Allocate a new voice or steal one if necessary.
   Voice *NewVoice(int32_t note_id);
-  bool Perform(OscBuffer &buffer);
+  // Fade out the best candidate for stealing and unmap it from its note.
+  // Voices are only ranked here, when one is needed, rather than kept ranked
+  // as they play: their levels come from their envelopes, and steals are rare.
+  Voice *StealVoice();
+  StealCandidate RankForSteal(Voice *voice) const;
+  // Retire finished voices.
+  void UpdateVoices();
+  // Render the next `frames_per_buffer` samples, at most kMaxSliceSamples,
+  // returning the mix, or nullptr if nothing is playing. The mix is owned by
+  // the player and valid until the next call.
+  const double *Perform(size_t frames_per_buffer);
 
   const SampleRate sample_rate_;
   PatchProcessor *patch_;  // Current patch.
+  // The patch's structure, compiled for the voices to run.
+  RenderProgramCompiler program_compiler_;
+  const int num_voices_;
+  const VoiceLayout layout_;
+  OutputTap *const tap_;
+  DspLoadMeter *const load_meter_;
 
   // Mutex for locking the voices and their states.
   mutable std::mutex voices_mutex_;
 
-  // The set of voices.
-  std::unordered_map<int32_t /* note_id */, Voice> voices_;
+  // Running count of samples rendered, used to timestamp notes.
+  SamplePosition sample_clock_ = 0;
+
+  // Fixed pool of voices. Twice the polyphony, so that stolen voices can fade
+  // out while the notes that stole them start.
+  std::vector<std::unique_ptr<Voice>> voices_;
+  std::vector<Voice *> free_voices_;
+  // Voices that are sounding, including ones fading out after being stolen.
+  std::vector<Voice *> active_voices_;
+  // Sounding voices which have not been stolen, by note id.
+  absl::flat_hash_map<int32_t /* note_id */, Voice *> note_voices_;
+  // One renderer per group of kVoiceLanes voices, for VoiceLayout::VOICE_LANES.
+  std::vector<std::unique_ptr<VoiceLanes>> voice_lanes_;
+
+  // Partial mix of each render worker, summed together at the end of Perform.
+  // Each is kMaxSliceSamples long, and only the slice's length of it is used,
+  // so varying slice lengths don't reallocate.
+  std::vector<OscBuffer> worker_mix_buffers_;
+  // Each render worker's buffers for generator pipelines.
+  std::vector<std::unique_ptr<GeneratorScratch>> worker_scratch_;
+  // Worker indices, 0..N-1, to iterate over in parallel.
+  std::vector<size_t> workers_;
 };
 
-}  // namespace sidebands
\ No newline at end of file
+}  // namespace sidebands
@@ -0,0 +1,206 @@
+#include "processor/synthesis/render_program.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "processor/synthesis/generator_pipeline.h"
+#include "processor/synthesis/oscillator.h"
+
+namespace sidebands {
+
+namespace {
+
+// Ratios this close to a whole number are treated as one.
+constexpr double kHarmonicTolerance = 1e-6;
+
+bool Harmonic(ParamValue ratio) {
+  return std::abs(ratio - std::round(ratio)) < kHarmonicTolerance;
+}
+
+// Modulating any of these changes the waveform, not just its level.
+constexpr ModMask kWaveformMods =
+    ModMaskBit(TARGET_C, Modulation::Envelope) |
+    ModMaskBit(TARGET_C, Modulation::LFO) |
+    ModMaskBit(TARGET_M, Modulation::Envelope) |
+    ModMaskBit(TARGET_M, Modulation::LFO) |
+    ModMaskBit(TARGET_K, Modulation::Envelope) |
+    ModMaskBit(TARGET_K, Modulation::LFO) |
+    ModMaskBit(TARGET_R, Modulation::Envelope) |
+    ModMaskBit(TARGET_R, Modulation::LFO) |
+    ModMaskBit(TARGET_S, Modulation::Envelope) |
+    ModMaskBit(TARGET_S, Modulation::LFO);
+
+}  // namespace
+
+WavetableKey WavetableKeyFor(const GeneratorPatch &patch) {
+  return {patch.c(), patch.m(), patch.k(), patch.r(), patch.s()};
+}
+
+RenderProgramCompiler::RenderProgramCompiler(PatchProcessor *patch)
+    : patch_(patch) {
+  Compile(patch_->structure_version());
+  thread_ = std::thread(&RenderProgramCompiler::Run, this);
+}
+
+RenderProgramCompiler::~RenderProgramCompiler() {
+  stop_.store(true, std::memory_order_release);
+  patch_->WakeStructureWaiters();
+  thread_.join();
+  delete installed_.load();
+}
+
+const RenderProgram &RenderProgramCompiler::Acquire() {
+  const RenderProgram *program = current_.load(std::memory_order_acquire);
+  acquired_version_.store(program->version, std::memory_order_release);
+  return *program;
+}
+
+std::unique_ptr<RenderProgram> RenderProgramCompiler::Prepare(
+    const PatchProcessor &source) {
+  return Build(0, source);
+}
+
+void RenderProgramCompiler::Install(std::unique_ptr<RenderProgram> program) {
+  CHECK(ReadyToInstall());
+  // The program is for the structure version about to be counted. It's handed
+  // over before the count moves, so the compiler thread can't see the new
+  // version without also finding the program, and compile it again, or
+  // worse, miss it.
+  program->version = patch_->structure_version() + 1;
+  // Its wavetables were baked from the values just loaded.
+  for (size_t i = 0; i < program->num_generators; i++) {
+    auto &generator = program->generators[i];
+    generator.wavetable_version = generator.patch->wavetable_version();
+  }
+  RenderProgram *installed = program.release();
+  installed_.store(installed, std::memory_order_release);
+  current_.store(installed, std::memory_order_release);
+  patch_->StructureChanged();
+}
+
+void RenderProgramCompiler::Run() {
+  uint64_t version = current_.load()->version;
+  while (!stop_.load(std::memory_order_acquire)) {
+    // Read before updating, so that a change made meanwhile doesn't wait for
+    // the next one.
+    const uint32_t wakes = patch_->structure_wakes();
+    version = Update(version);
+    patch_->WaitForStructureChange(wakes);
+  }
+}
+
+uint64_t RenderProgramCompiler::Update(uint64_t version) {
+  // An installed program is already current, and needn't be compiled again.
+  if (auto *installed = installed_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(compile_mutex_);
+    programs_.emplace_back(installed);
+    published_ = installed;
+    version = installed->version;
+    installed_.store(nullptr, std::memory_order_release);
+  }
+  const uint64_t latest = patch_->structure_version();
+  if (latest <= version || !Compile(latest)) return version;
+  return latest;
+}
+
+bool RenderProgramCompiler::Compile(uint64_t version) {
+  // Wavetable versions are taken before the copy, so if the values change
+  // while they're copied, the wavetables look stale rather than current.
+  uint32_t wavetable_versions[kNumGenerators];
+  for (int g_num = 0; g_num < kNumGenerators; g_num++)
+    wavetable_versions[g_num] = patch_->generators_[g_num]->wavetable_version();
+  snapshot_.CopyFrom(*patch_);
+  auto program = Build(version, snapshot_);
+  for (size_t i = 0; i < program->num_generators; i++) {
+    auto &generator = program->generators[i];
+    generator.wavetable_version = wavetable_versions[generator.gennum];
+  }
+  std::lock_guard<std::mutex> lock(compile_mutex_);
+  // If a program was installed while this one was compiled, it's from
+  // values at least as new; this one is dropped.
+  const RenderProgram *expected = published_;
+  if (!current_.compare_exchange_strong(expected, program.get(),
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+    return false;
+  published_ = program.get();
+  programs_.push_back(std::move(program));
+
+  // Free whatever the audio thread has moved past.
+  const uint64_t acquired = acquired_version_.load(std::memory_order_acquire);
+  const RenderProgram *current = published_;
+  std::erase_if(programs_, [acquired, current](const auto &p) {
+    return p.get() != current && p->version < acquired;
+  });
+  VLOG(1) << "Compiled render program " << version << ", "
+          << programs_.size() << " retained";
+  return true;
+}
+
+std::unique_ptr<RenderProgram> RenderProgramCompiler::Build(
+    uint64_t version, const PatchProcessor &source) {
+  std::lock_guard<std::mutex> lock(compile_mutex_);
+  auto program = std::make_unique<RenderProgram>();
+  program->version = version;
+  for (int g_num = 0; g_num < kNumGenerators; g_num++) {
+    const GeneratorPatch *source_patch = source.generators_[g_num].get();
+    if (!source_patch->on()) continue;
+    GeneratorPatch *patch = patch_->generators_[g_num].get();
+    auto &generator = program->generators[program->num_generators++];
+    generator.gennum = g_num;
+    generator.patch = patch;
+    generator.osc_type = source_patch->osc_type();
+    for (auto target : kModulationTargets) {
+      generator.mod_types[target] = source_patch->ModTypesFor(target);
+      generator.mod_params[target] = patch->ModulationParams(target);
+      for (int i = 0; i < Modulation::NumModulators; i++) {
+        auto mod_type = Modulation::Type(i);
+        if (generator.mod_types[target].test(mod_type))
+          generator.mods |= ModMaskBit(target, mod_type);
+      }
+    }
+    generator.pipeline =
+        SelectGeneratorPipeline(generator.osc_type, generator.mods);
+    if (source.baked_wavetables()) {
+      generator.wavetable_key = WavetableKeyFor(*source_patch);
+      generator.wavetable = BakeWavetable(generator, generator.wavetable_key);
+    }
+  }
+  return program;
+}
+
+std::shared_ptr<const Wavetable> RenderProgramCompiler::BakeWavetable(
+    const GeneratorProgram &program, const WavetableKey &key) {
+  // Only a ModFM oscillator with fixed, whole-number carrier and modulator
+  // ratios repeats once per note period. The analog oscillator's filters
+  // carry state from cycle to cycle, so it is always synthesised.
+  if (program.osc_type != GeneratorPatch::OscType::MOD_FM ||
+      (program.mods & kWaveformMods) || key.c <= 0 || !Harmonic(key.c) ||
+      !Harmonic(key.c * key.m))
+    return nullptr;
+
+  const int g_num = program.gennum;
+  if (wavetables_[g_num] && wavetable_keys_[g_num] == key)
+    return wavetables_[g_num];
+
+  // One cycle of a 1Hz note, sampled kCycleSamples times a second.
+  OscBuffer cycle(Wavetable::kCycleSamples);
+  OscParams params(cycle.size());
+  params.note_freq = 1.0;
+  params.C = key.c;
+  params.M = key.m;
+  params.K = key.k;
+  params.R = key.r;
+  params.S = key.s;
+  MakeOscillator(program.osc_type)
+      ->Perform(SampleRate(Wavetable::kCycleSamples), cycle, params);
+
+  wavetables_[g_num] = std::make_shared<const Wavetable>(cycle);
+  wavetable_keys_[g_num] = key;
+  VLOG(1) << "Baked wavetable for generator " << g_num;
+  return wavetables_[g_num];
+}
+
+}  // namespace sidebands
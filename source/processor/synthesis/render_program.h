@@ -0,0 +1,162 @@
+#pragma once
+
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "constants.h"
+#include "dsp/oscbuffer.h"
+#include "dsp/wavetable.h"
+#include "processor/patch_processor.h"
+
+namespace sidebands {
+
+using Steinberg::Vst::ParamValue;
+using Steinberg::Vst::SampleRate;
+
+class Generator;
+struct GeneratorProgram;
+struct GeneratorScratch;
+
+// Which modulators apply to which targets, one bit per (target, modulator)
+// pair as laid out by ModMaskBit.
+using ModMask = uint32_t;
+
+constexpr ModMask ModMaskBit(TargetTag target, Modulation::Type type) {
+  return ModMask(1)
+         << (int(target) * int(Modulation::NumModulators) + int(type));
+}
+
+// Renders one generator for a slice of `frames` samples, at most
+// kMaxSliceSamples, and adds it into `mix_buffer`, with the oscillator type and
+// modulation routing fixed at compile time, working in `scratch`. See
+// generator_pipeline.h.
+using GeneratorPipeline = void (*)(SampleRate sample_rate,
+                                   const GeneratorProgram &program,
+                                   Generator &generator,
+                                   GeneratorScratch &scratch,
+                                   double *mix_buffer, size_t frames,
+                                   ParamValue base_freq);
+
+// The oscillator settings a wavetable was baked from.
+struct WavetableKey {
+  ParamValue c = 0, m = 0, k = 0, r = 0, s = 0;
+
+  bool operator==(const WavetableKey &) const = default;
+};
+
+WavetableKey WavetableKeyFor(const GeneratorPatch &patch);
+
+// The structural facts about one generator's patch: which modulators apply to
+// each target, and the oscillator. These only change when the generator
+// toggle, oscillator type or a modulation bitset does.
+struct GeneratorProgram {
+  int gennum = 0;
+  GeneratorPatch *patch = nullptr;
+  GeneratorPatch::OscType osc_type = GeneratorPatch::OscType::MOD_FM;
+  std::bitset<Modulation::NumModulators> mod_types[NUM_TARGETS];
+  const GeneratorPatch::ModParams *mod_params[NUM_TARGETS]{};
+  // The routing above as a mask, and the specialised kernel for it if there
+  // is one.
+  ModMask mods = 0;
+  GeneratorPipeline pipeline = nullptr;
+  // With baked wavetables on, a static harmonic ModFM generator's waveform,
+  // the settings it was baked from, and the patch's wavetable_version() when
+  // they were its settings.
+  std::shared_ptr<const Wavetable> wavetable;
+  WavetableKey wavetable_key;
+  uint32_t wavetable_version = 0;
+};
+
+// Whether the program's wavetable is still what the patch would synthesise;
+// it goes stale while automation moves a baked parameter, until it's rebaked.
+// One atomic load, so cheap enough to ask every slice.
+inline bool WavetableCurrent(const GeneratorProgram &program) {
+  return program.wavetable &&
+         program.patch->wavetable_version() == program.wavetable_version;
+}
+
+// What voices run to render the patch: a program for each switched-on
+// generator, in generator order. Immutable once published.
+struct RenderProgram {
+  uint64_t version = 0;
+  GeneratorProgram generators[kNumGenerators];
+  size_t num_generators = 0;
+};
+
+// Keeps a RenderProgram compiled from the patch. A background thread sleeps
+// until the patch's structure version moves, rebuilds the program, and
+// publishes it with an atomic pointer swap; the audio thread only ever loads
+// that pointer, and wakes the compiler without locking.
+class RenderProgramCompiler {
+ public:
+  // Compiles the initial program on the calling thread.
+  explicit RenderProgramCompiler(PatchProcessor *patch);
+  ~RenderProgramCompiler();
+
+  // The current program, for the audio thread. It stays valid until the next
+  // call.
+  const RenderProgram &Acquire();
+
+  // Compile, off the audio thread, the program the patch will have once
+  // `source`'s values are loaded into it, to Install along with them.
+  std::unique_ptr<RenderProgram> Prepare(const PatchProcessor &source);
+  // Whether a prepared program can be installed; only one at a time is handed
+  // over to the compiler thread.
+  bool ReadyToInstall() const {
+    return !installed_.load(std::memory_order_acquire);
+  }
+  // Publish a prepared program in place of compiling one, and count it as a
+  // structure change. For the audio thread, once the values the program was
+  // prepared from are loaded; the compiler thread takes ownership, so nothing
+  // is freed here.
+  void Install(std::unique_ptr<RenderProgram> program);
+
+ private:
+  void Run();
+  // Take over any installed program, and compile one if the patch's
+  // structure has moved past `version`. Returns the version now current.
+  uint64_t Update(uint64_t version);
+  // Compile and publish the patch's program as of `version`, unless a program
+  // is installed meanwhile. Returns whether it was published.
+  bool Compile(uint64_t version);
+  // Compile the structure of `source`, for running against patch_.
+  std::unique_ptr<RenderProgram> Build(uint64_t version,
+                                       const PatchProcessor &source);
+  // The wavetable for the generator, if it can be baked, reusing the last one
+  // baked for it when the settings match.
+  std::shared_ptr<const Wavetable> BakeWavetable(const GeneratorProgram &program,
+                                                 const WavetableKey &key);
+
+  PatchProcessor *patch_;
+  // What's compiled: a copy of the patch, so the audio thread can go on
+  // changing the live one meanwhile.
+  PatchProcessor snapshot_;
+  std::atomic<const RenderProgram *> current_{nullptr};
+  // The program the compiler thread last published or took over. Unless
+  // current_ still points to it, a program has been installed since.
+  const RenderProgram *published_ = nullptr;
+  // Version of the program the audio thread last acquired. Anything older can
+  // no longer be in use, and is freed.
+  std::atomic<uint64_t> acquired_version_{0};
+  // Installed program not yet taken over by the compiler thread.
+  std::atomic<RenderProgram *> installed_{nullptr};
+  // Held while compiling, which happens both on the compiler thread and in
+  // Prepare.
+  std::mutex compile_mutex_;
+  // Published programs not yet freed; only touched by the compiler thread.
+  std::vector<std::unique_ptr<RenderProgram>> programs_;
+  // Last wavetable baked for each generator.
+  std::shared_ptr<const Wavetable> wavetables_[kNumGenerators];
+  WavetableKey wavetable_keys_[kNumGenerators];
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+}  // namespace sidebands
@@ -1,8 +1,10 @@
 #include "processor/synthesis/voice.h"
 
-#include <execution>
+#include <algorithm>
 
 #include "processor/synthesis/generator.h"
+#include "processor/synthesis/voice_lanes.h"
+#include "processor/util/dsp_load.h"
 
 namespace sidebands {
 
@@ -16,10 +18,17 @@ ParamValue NoteToFreq(ParamValue note) {
 
 }  // namespace
 
-Voice::Voice() : note_frequency_(0), note_(0), velocity_(0) {
+Voice::Voice(DspLoadMeter *load_meter)
+    : load_meter_(load_meter),
+      note_frequency_(0),
+      note_(0),
+      velocity_(0),
+      steal_mix_(kMaxSliceSamples),
+      steal_gains_(kMaxSliceSamples) {
   for (int x = 0; x < kNumGenerators; x++) {
     generators_[x] = std::make_unique<Generator>();
     generators_[x]->events.GeneratorOff.connect([this, x](Generator *g) {
+      std::lock_guard<std::mutex> generators_lock(generators_mutex_);
       active_generators_[x] = false;
       if (active_generators_.none()) {
         events.VoiceOff(this);
@@ -38,82 +47,170 @@ bool Voice::Playing() const {
   return active_generators_.any();
 }
 
-void Voice::NoteOn(SampleRate sample_rate, PatchProcessor *patch,
-                   std::chrono::high_resolution_clock::time_point start_time,
+void Voice::NoteOn(SampleRate sample_rate, const RenderProgram &program,
+                   int32_t note_id, SamplePosition start_time,
                    ParamValue velocity, int16_t note) {
   ParamValue base_freq = NoteToFreq(note);
 
+  note_id_ = note_id;
   note_ = note;
   on_time_ = start_time;
   note_frequency_ = base_freq;
   velocity_ = velocity;
+  released_ = false;
+  fade_remaining_samples_ = 0;
 
   std::lock_guard<std::mutex> generators_lock(generators_mutex_);
-  auto &g_patches = patch->generators_;
-  for (int g_num = 0; g_num < kNumGenerators; g_num++) {
-    auto &g = this->generators_[g_num];
-    auto &gp = g_patches[g_num];
-    if (gp->on()) {
-      g->NoteOn(sample_rate, *gp, start_time, velocity_, note);
-      active_generators_[g_num] = true;
-    }
+  for (size_t i = 0; i < program.num_generators; i++) {
+    const auto &gp = program.generators[i];
+    generators_[gp.gennum]->NoteOn(sample_rate, gp, start_time, velocity_,
+                                   note);
+    active_generators_[gp.gennum] = true;
   }
   events.VoiceOn(this);
 }
 
-void Voice::NoteRelease(SampleRate sample_rate, PatchProcessor *patch,
+void Voice::NoteRelease(SampleRate sample_rate, const RenderProgram &program,
                         int16_t note) {
-  auto &g_patches = patch->generators_;
+  std::lock_guard<std::mutex> generators_lock(generators_mutex_);
+  for (size_t i = 0; i < program.num_generators; i++) {
+    const auto &gp = program.generators[i];
+    if (!active_generators_[gp.gennum]) continue;
+    generators_[gp.gennum]->NoteRelease(sample_rate, gp, note);
+  }
+  released_ = true;
+  events.VoiceRelease(this);
+}
 
+void Voice::Steal(SampleRate sample_rate) {
+  fade_length_samples_ =
+      std::max<int64_t>(1, int64_t(kVoiceStealFadeSeconds * sample_rate));
+  fade_remaining_samples_ = fade_length_samples_;
+}
+
+ParamValue Voice::Level() const {
   std::lock_guard<std::mutex> generators_lock(generators_mutex_);
+  ParamValue level = 0;
   for (int g_num = 0; g_num < kNumGenerators; g_num++) {
-    auto &g = generators_[g_num];
     if (!active_generators_[g_num]) continue;
-    auto &gp = g_patches[g_num];
-    g->NoteRelease(sample_rate, *gp, note);
+    level = std::max(level, generators_[g_num]->Level());
   }
-  events.VoiceRelease(this);
+  return level;
 }
 
-MixBuffers Voice::Perform(SampleRate sample_rate, size_t frames_per_buffer,
-                          PatchProcessor *patch) {
-  if (!Playing()) return {};
-  auto g_patches = patch->generators_;
+void Voice::Perform(SampleRate sample_rate, const RenderProgram &program,
+                    bool generator_lanes, GeneratorScratch &scratch,
+                    double *mix_buffer, size_t frames) {
+  if (!Stealing()) {
+    PerformGenerators(sample_rate, program, {}, generator_lanes, scratch,
+                      mix_buffer, frames);
+    return;
+  }
+
+  // A voice being stolen is rendered over the mix, and what it added is then
+  // scaled by its fade.
+  std::copy_n(mix_buffer, frames, std::begin(steal_mix_));
+  PerformGenerators(sample_rate, program, {}, generator_lanes, scratch,
+                    mix_buffer, frames);
+  AdvanceFade(frames, steal_gains_);
+  for (size_t i = 0; i < frames; i++) {
+    mix_buffer[i] =
+        steal_mix_[i] + (mix_buffer[i] - steal_mix_[i]) * steal_gains_[i];
+  }
+}
 
-  // Copy references to the generators that we need to use, and create a mix
-  // buffer for each.
-  std::vector<std::pair<GeneratorPatch *, Generator *>> generators;
+void Voice::PerformGenerators(SampleRate sample_rate,
+                              const RenderProgram &program,
+                              std::bitset<kNumGenerators> skip_generators,
+                              bool generator_lanes,
+                              GeneratorScratch &scratch,
+                              double *mix_buffer, size_t frames) {
+  if (!Playing()) return;
+
+  // Copy references to the generators that we need to use. Generators which
+  // can share SIMD lanes are collected separately.
+  const GeneratorProgram *lane_programs[kNumGenerators];
+  Generator *lane_generators[kNumGenerators];
+  size_t num_lane_generators = 0;
+  const GeneratorProgram *programs[kNumGenerators];
+  Generator *generators[kNumGenerators];
+  size_t num_generators = 0;
   {
     std::lock_guard<std::mutex> generators_lock(generators_mutex_);
-    for (int g_num = 0; g_num < kNumGenerators; g_num++) {
-      auto &g = generators_[g_num];
-      if (!active_generators_[g_num] || !g_patches[g_num]->on()) continue;
-      generators.emplace_back(std::make_pair(g_patches[g_num].get(), g.get()));
+    for (size_t i = 0; i < program.num_generators; i++) {
+      const auto &gp = program.generators[i];
+      if (!active_generators_[gp.gennum] || skip_generators[gp.gennum])
+        continue;
+      Generator *g = generators_[gp.gennum].get();
+      // Baked wavetables are played back generator by generator.
+      if (generator_lanes && CanPerformGeneratorLanes(g) &&
+          !WavetableCurrent(gp)) {
+        lane_programs[num_lane_generators] = &gp;
+        lane_generators[num_lane_generators++] = g;
+      } else {
+        programs[num_generators] = &gp;
+        generators[num_generators++] = g;
+      }
     }
   }
 
-  // Perform into the mix buffers and return them all.
-  MixBuffers mix_buffers(generators.size());
-  std::transform(std::execution::par_unseq, generators.begin(),
-                 generators.end(), mix_buffers.begin(),
-                 [frames_per_buffer, sample_rate,
-                  this](const std::pair<GeneratorPatch *, Generator *> &gpair) {
-                   auto mix_buffer =
-                       std::make_unique<MixBuffer>(frames_per_buffer);
-                   gpair.second->Perform(sample_rate, *gpair.first,
-                                         *mix_buffer.get(), note_frequency_);
-                   return mix_buffer;
-                 });
-
-  return mix_buffers;
+  // Everything accumulates straight into the mix buffer; parallelism comes
+  // from the player spreading voices across workers.
+  DspLoadMeter *const meter =
+      load_meter_ && load_meter_->detailed() ? load_meter_ : nullptr;
+  for (size_t first = 0; first < num_lane_generators; first += kVoiceLanes) {
+    const Ticks start = meter ? ReadTicks() : 0;
+    const size_t lanes =
+        std::min<size_t>(kVoiceLanes, num_lane_generators - first);
+    PerformGeneratorLanes(sample_rate, note_frequency_, &lane_programs[first],
+                          &lane_generators[first], lanes, mix_buffer, frames);
+    // Generators in lanes are rendered together, so share the time.
+    if (meter) {
+      const Ticks elapsed = (ReadTicks() - start) / lanes;
+      for (size_t lane = 0; lane < lanes; lane++)
+        meter->AddGenerator(lane_programs[first + lane]->gennum, elapsed);
+    }
+  }
+  for (size_t i = 0; i < num_generators; i++) {
+    const Ticks start = meter ? ReadTicks() : 0;
+    generators[i]->Perform(sample_rate, *programs[i], scratch, mix_buffer,
+                           frames, note_frequency_);
+    if (meter) meter->AddGenerator(programs[i]->gennum, ReadTicks() - start);
+  }
 }
 
-void Voice::Reset() {
+bool Voice::AdvanceFade(size_t frames_per_buffer, OscBuffer &gains) {
+  if (!Stealing()) return false;
+
+  // A stolen voice ramps linearly down to silence and then shuts itself off.
+  const double fade_start =
+      double(fade_remaining_samples_) / fade_length_samples_;
+  const double fade_step = 1.0 / fade_length_samples_;
+  for (size_t i = 0; i < frames_per_buffer; i++) {
+    gains[i] = int64_t(i) < fade_remaining_samples_
+                   ? fade_start - fade_step * double(i)
+                   : 0.0;
+  }
+
+  fade_remaining_samples_ -= frames_per_buffer;
+  if (fade_remaining_samples_ <= 0) Reset();
+  return true;
+}
+
+bool Voice::GeneratorActive(int gennum) const {
   std::lock_guard<std::mutex> generators_lock(generators_mutex_);
+  return active_generators_[gennum];
+}
+
+void Voice::Reset() {
+  // Generators signal GeneratorOff as they reset, which takes the lock itself.
   for (auto &g : generators_) {
     g->Reset();
   }
+  std::lock_guard<std::mutex> generators_lock(generators_mutex_);
   active_generators_.reset();
+  released_ = false;
+  fade_remaining_samples_ = 0;
 }
 
 }  // namespace sidebands
\ No newline at end of file
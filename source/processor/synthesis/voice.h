@@ -3,13 +3,13 @@
 #include <pluginterfaces/vst/vsttypes.h>
 
 #include <bitset>
-#include <chrono>
 #include <complex>
 #include <mutex>
 #include <valarray>
 #include <vector>
 
 #include "constants.h"
+#include "dsp/oscbuffer.h"
 #include "globals.h"
 #include "processor/events.h"
 
@@ -19,49 +19,94 @@ using Steinberg::Vst::ParamValue;
 using Steinberg::Vst::SampleRate;
 
 using MixBuffer = std::valarray<double>;
-using MixBuffers = std::vector<std::unique_ptr<MixBuffer>>;
 
-struct PatchProcessor;
+class DspLoadMeter;
 class Generator;
+struct GeneratorScratch;
+struct RenderProgram;
 
 class Voice {
  public:
-  Voice();
-
-  // Produce a series of buffers, one per playing generator.
-  MixBuffers Perform(SampleRate sample_rate, size_t frames_per_buffer,
-                     PatchProcessor *patch);
+  // Generators are timed into `load_meter`, if there is one, while it asks for
+  // detail.
+  explicit Voice(DspLoadMeter *load_meter = nullptr);
+
+  // Render `frames` samples of the voice, at most kMaxSliceSamples, adding
+  // its output into `mix_buffer`. With `generator_lanes`, generators are
+  // rendered in groups, one per SIMD lane. `scratch` belongs to the worker
+  // doing the rendering.
+  void Perform(SampleRate sample_rate, const RenderProgram &program,
+               bool generator_lanes, GeneratorScratch &scratch,
+               double *mix_buffer, size_t frames);
+
+  // As Perform, but leaving out the generators in `skip_generators` and
+  // without applying the steal fade-out.
+  void PerformGenerators(SampleRate sample_rate, const RenderProgram &program,
+                         std::bitset<kNumGenerators> skip_generators,
+                         bool generator_lanes, GeneratorScratch &scratch,
+                         double *mix_buffer, size_t frames);
+
+  // If the voice is being stolen, fill the first `frames_per_buffer` of
+  // `gains` with the fade-out ramp for the next that many samples, advance the
+  // fade, and return true. The voice resets itself once the fade completes.
+  bool AdvanceFade(size_t frames_per_buffer, OscBuffer &gains);
 
   // Trigger a note-on even for each generator in the voice.
-  void NoteOn(SampleRate sample_rate, PatchProcessor *patch,
-              std::chrono::high_resolution_clock::time_point start_time,
-              ParamValue velocity, int16_t note);
+  void NoteOn(SampleRate sample_rate, const RenderProgram &program,
+              int32_t note_id, SamplePosition start_time, ParamValue velocity,
+              int16_t note);
 
   // Trigger a note-release for each generator in the voice.
-  void NoteRelease(SampleRate sample_rate, PatchProcessor *patch, int16_t note);
+  void NoteRelease(SampleRate sample_rate, const RenderProgram &program,
+                   int16_t note);
+
+  // Fade the voice out over kVoiceStealFadeSeconds, after which it resets
+  // itself. Used when stealing, so the old note doesn't click off.
+  void Steal(SampleRate sample_rate);
 
-  // Force all off (i.e. for stealing)
+  // Force all off immediately.
   void Reset();
 
   // Returns true if the voice is generating sound (envelopes for any of its
   // generators are active).
   bool Playing() const;
 
+  // Returns true if the voice is fading out after being stolen.
+  bool Stealing() const { return fade_remaining_samples_ > 0; }
+
+  // Returns true if the voice has been sent a note-release.
+  bool Released() const { return released_; }
+
+  // The level of the loudest amplitude envelope among playing generators.
+  ParamValue Level() const;
+
+  bool GeneratorActive(int gennum) const;
+  Generator *generator(int gennum) const { return generators_[gennum].get(); }
+  ParamValue note_frequency() const { return note_frequency_; }
+
+  int32_t note_id() const { return note_id_; }
   int16_t note() const { return note_; }
-  std::chrono::high_resolution_clock::time_point on_time() const {
-    return on_time_;
-  }
+  SamplePosition on_time() const { return on_time_; }
 
   VoiceEvents events;
 
  private:
+  DspLoadMeter *const load_meter_;
   mutable std::mutex generators_mutex_;
   std::unique_ptr<Generator> generators_[kNumGenerators];
   std::bitset<kNumGenerators> active_generators_;
-  std::chrono::high_resolution_clock::time_point on_time_;
+  SamplePosition on_time_ = 0;
+  int32_t note_id_ = -1;
+  bool released_ = false;
+  int64_t fade_length_samples_ = 0;
+  int64_t fade_remaining_samples_ = 0;
   int16_t note_;
   ParamValue velocity_;
   ParamValue note_frequency_;
+  // Steal fade scratch, kMaxSliceSamples long so no slice needs more: the mix
+  // as it was before the voice rendered into it, and the fade's gains.
+  OscBuffer steal_mix_;
+  OscBuffer steal_gains_;
 };
 
 }  // namespace sidebands
\ No newline at end of file
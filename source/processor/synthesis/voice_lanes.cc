@@ -0,0 +1,430 @@
+#include "processor/synthesis/voice_lanes.h"
+
+#include <glog/logging.h>
+#include <vectorclass.h>
+#include <vectormath_exp.h>
+#include <vectormath_trig.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numbers>
+
+#include "processor/synthesis/envgen.h"
+#include "processor/synthesis/generator.h"
+#include "processor/synthesis/lfo.h"
+#include "processor/synthesis/oscillator.h"
+#include "processor/util/dsp_load.h"
+
+namespace sidebands {
+
+static_assert(kVoiceLanes == Vec8d::size());
+
+namespace {
+
+constexpr double kPi2 = std::numbers::pi * 2.0;
+
+// One envelope generator per lane. Within a stage every lane's level just
+// scales by its stage coefficient, so that runs as a vector multiply; lanes
+// reaching a stage transition are stepped individually by their envelope
+// generator.
+class EnvelopeLanes {
+ public:
+  EnvelopeLanes() {
+    std::fill(std::begin(levels_), std::end(levels_), 1.0);
+    std::fill(std::begin(coefficients_), std::end(coefficients_), 1.0);
+    std::fill(std::begin(scales_), std::end(scales_), 1.0);
+    std::fill(std::begin(boundaries_), std::end(boundaries_), kNever);
+  }
+
+  // Lanes which are never loaded produce a constant 1.
+  void Load(int lane, EnvelopeGenerator *envelope, double velocity_scale) {
+    envelopes_[lane] = envelope;
+    scales_[lane] = velocity_scale;
+    LoadSegment(lane, 0);
+  }
+
+  void Start() {
+    level_.load(levels_);
+    coefficient_.load(coefficients_);
+    scale_.load(scales_);
+  }
+
+  Vec8d Next() {
+    if (t_ != next_boundary_) {
+      level_ *= coefficient_;
+    } else {
+      StepLanesAtBoundary();
+    }
+    t_++;
+    return level_ * scale_;
+  }
+
+  void Commit() {
+    level_.store(levels_);
+    for (int lane = 0; lane < kVoiceLanes; lane++) {
+      if (envelopes_[lane])
+        envelopes_[lane]->CommitSegment(levels_[lane], t_ - synced_[lane]);
+    }
+  }
+
+ private:
+  static constexpr int64_t kNever = INT64_MAX;
+
+  void LoadSegment(int lane, int64_t t) {
+    auto segment = envelopes_[lane]->CurrentSegment();
+    levels_[lane] = segment.level;
+    coefficients_[lane] = segment.coefficient;
+    boundaries_[lane] = segment.samples_left == kNever
+                            ? kNever
+                            : t + segment.samples_left;
+    synced_[lane] = t;
+    next_boundary_ = (std::min)(next_boundary_, boundaries_[lane]);
+  }
+
+  void StepLanesAtBoundary() {
+    level_.store(levels_);
+    next_boundary_ = kNever;
+    for (int lane = 0; lane < kVoiceLanes; lane++) {
+      if (boundaries_[lane] != t_) {
+        levels_[lane] *= coefficients_[lane];
+        next_boundary_ = (std::min)(next_boundary_, boundaries_[lane]);
+        continue;
+      }
+      // Catch the envelope up on the samples rendered here, then let it
+      // produce the transition sample itself.
+      auto *envelope = envelopes_[lane];
+      envelope->CommitSegment(levels_[lane], t_ - synced_[lane]);
+      envelope->Step();
+      LoadSegment(lane, t_ + 1);
+    }
+    level_.load(levels_);
+    coefficient_.load(coefficients_);
+  }
+
+  EnvelopeGenerator *envelopes_[kVoiceLanes]{};
+  double levels_[kVoiceLanes];
+  double coefficients_[kVoiceLanes];
+  double scales_[kVoiceLanes];
+  int64_t boundaries_[kVoiceLanes];
+  int64_t synced_[kVoiceLanes]{};
+  int64_t next_boundary_ = kNever;
+  int64_t t_ = 0;
+  Vec8d level_, coefficient_, scale_;
+};
+
+// One LFO per lane, each with its own frequency and wave shape.
+class LFOLanes {
+ public:
+  LFOLanes() {
+    // Lanes which are never loaded produce a constant 1.
+    std::fill(std::begin(phases_), std::end(phases_), 0.0);
+    std::fill(std::begin(increments_), std::end(increments_), 0.0);
+    std::fill(std::begin(sines_), std::end(sines_), 1.0);
+    std::fill(std::begin(amplitudes_), std::end(amplitudes_), 0.0);
+    std::fill(std::begin(offsets_), std::end(offsets_), 1.0);
+  }
+
+  void Load(int lane, SampleRate sample_rate, LFO *lfo,
+            const GeneratorPatch::LFOValues &lfo_values, double amplitude) {
+    lfos_[lane] = lfo;
+    phases_[lane] = lfo->phase();
+    increments_[lane] = kPi2 * lfo_values.frequency.getValue() / sample_rate;
+    sines_[lane] =
+        kLFOTypes[off_t(lfo_values.type.getValue())] == LFOType::SIN;
+    amplitudes_[lane] = amplitude;
+    offsets_[lane] = 0.0;
+  }
+
+  void Start() {
+    phase_.load(phases_);
+    increment_.load(increments_);
+    sine_ = Vec8d().load(sines_) != 0.0;
+    amplitude_.load(amplitudes_);
+    offset_.load(offsets_);
+  }
+
+  Vec8d Next() {
+    phase_ += increment_;
+    Vec8d cos_phase;
+    Vec8d sin_phase = sincos(&cos_phase, phase_);
+    Vec8d wave = select(sine_, sin_phase, cos_phase);
+    phase_ = select(phase_ >= kPi2, phase_ - kPi2, phase_);
+    if (first_) {
+      wave.store(first_levels_);
+      first_ = false;
+    }
+    return mul_add(wave, amplitude_, offset_);
+  }
+
+  void Commit() {
+    phase_.store(phases_);
+    for (int lane = 0; lane < kVoiceLanes; lane++) {
+      if (lfos_[lane]) lfos_[lane]->Commit(phases_[lane], first_levels_[lane]);
+    }
+  }
+
+ private:
+  LFO *lfos_[kVoiceLanes]{};
+  double phases_[kVoiceLanes];
+  double increments_[kVoiceLanes];
+  double sines_[kVoiceLanes];
+  double amplitudes_[kVoiceLanes];
+  double offsets_[kVoiceLanes];
+  double first_levels_[kVoiceLanes]{};
+  bool first_ = true;
+  Vec8d phase_, increment_, amplitude_, offset_;
+  Vec8db sine_;
+};
+
+// The value of one oscillator parameter across the lanes: each lane's patch
+// value, scaled by whichever modulators that lane's patch enables for it.
+class TargetLanes {
+ public:
+  TargetLanes() {
+    std::fill(std::begin(bases_), std::end(bases_), 0.0);
+    std::fill(std::begin(ramps_), std::end(ramps_), 0.0);
+  }
+
+  void Load(int lane, SampleRate sample_rate, const GeneratorProgram &program,
+            TargetTag target, Generator *generator) {
+    bases_[lane] = program.patch->ParameterValueFor(target);
+    ramps_[lane] = program.patch->ParameterRampFor(target);
+    const auto *mod_params = program.mod_params[target];
+    if (!mod_params) return;
+
+    const auto &mod_types = program.mod_types[target];
+    const double velocity = generator->velocity();
+    if (mod_types.test(Modulation::Envelope)) {
+      if (auto *envelope = static_cast<EnvelopeGenerator *>(
+              generator->modulator(target, Modulation::Envelope))) {
+        const auto &vs = mod_params->envelope_parameters.VS;
+        envelope_.Load(lane, envelope,
+                       vs.getValue() * velocity + (1 - vs.getValue()));
+        envelope_on_ = true;
+      }
+    }
+    if (mod_types.test(Modulation::LFO)) {
+      if (auto *lfo = static_cast<LFO *>(
+              generator->modulator(target, Modulation::LFO))) {
+        const auto &lv = mod_params->lfo_parameters;
+        auto velocity_scale = lv.velocity_sensivity.getValue() * velocity +
+                              (1 - lv.velocity_sensivity.getValue());
+        lfo_.Load(lane, sample_rate, lfo, lv,
+                  lv.amplitude.getValue() * velocity_scale);
+        lfo_on_ = true;
+      }
+    }
+  }
+
+  void Start(size_t frames_per_buffer) {
+    // Parameters have already advanced to the end of the slice; automated
+    // ones ramp there from where they were at its start.
+    ramp_.load(ramps_);
+    base_.load(bases_);
+    base_ -= ramp_ * double(frames_per_buffer);
+    envelope_.Start();
+    lfo_.Start();
+  }
+
+  Vec8d Next() {
+    Vec8d value = base_;
+    base_ += ramp_;
+    if (envelope_on_) value *= envelope_.Next();
+    if (lfo_on_) value *= lfo_.Next();
+    return value;
+  }
+
+  void Commit() {
+    if (envelope_on_) envelope_.Commit();
+    if (lfo_on_) lfo_.Commit();
+  }
+
+ private:
+  double bases_[kVoiceLanes];
+  double ramps_[kVoiceLanes];
+  Vec8d base_, ramp_;
+  bool envelope_on_ = false;
+  bool lfo_on_ = false;
+  EnvelopeLanes envelope_;
+  LFOLanes lfo_;
+};
+
+// A set of ModFM oscillators, one per lane, gathered from whichever voices and
+// generators are being rendered together.
+class ModFMLanes {
+ public:
+  ModFMLanes() {
+    std::fill(std::begin(note_freqs_), std::end(note_freqs_), 0.0);
+    std::fill(std::begin(phases_), std::end(phases_), 0.0);
+    std::fill(std::begin(enabled_), std::end(enabled_), 0.0);
+  }
+
+  void Load(int lane, SampleRate sample_rate, const GeneratorProgram &program,
+            Generator *generator, double note_frequency) {
+    programs_[lane] = &program;
+    generators_[lane] = generator;
+    oscillators_[lane] =
+        static_cast<ModFMOscillator *>(generator->oscillator());
+    note_freqs_[lane] = note_frequency;
+    phases_[lane] = oscillators_[lane]->phase();
+    enabled_[lane] = 1.0;
+    for (auto target : kModulationTargets) {
+      targets_[target].Load(lane, sample_rate, program, target, generator);
+    }
+  }
+
+  // Render the lanes, handing each sample's lane outputs to `sink` along with
+  // the sample index, then commit the modulator and oscillator state back.
+  template <typename Sink>
+  void Perform(SampleRate sample_rate, size_t frames_per_buffer, Sink sink) {
+    for (auto target : kModulationTargets) targets_[target].Start(frames_per_buffer);
+
+    Vec8d note_freq, phase, enable;
+    note_freq.load(note_freqs_);
+    phase.load(phases_);
+    enable.load(enabled_);
+    const double sample_period = 1.0 / sample_rate;
+    for (size_t i = 0; i < frames_per_buffer; i++) {
+      Vec8d A = targets_[TARGET_A].Next();
+      Vec8d K = targets_[TARGET_K].Next();
+      Vec8d C = targets_[TARGET_C].Next();
+      Vec8d R = targets_[TARGET_R].Next();
+      Vec8d S = targets_[TARGET_S].Next();
+      Vec8d M = targets_[TARGET_M].Next();
+
+      // Same formula as ModFMOscillator::Perform.
+      Vec8d T = (phase + double(i)) * sample_period;
+      Vec8d omega_c = note_freq * C * kPi2 * T;
+      Vec8d omega_m = omega_c * M;
+      Vec8d cos_omega_m;
+      Vec8d sin_omega_m = sincos(&cos_omega_m, omega_m);
+      Vec8d out = exp(R * K * cos_omega_m) *
+                  cos(omega_c + S * K * sin_omega_m) / exp(K);
+      sink(i, out * A * enable);
+    }
+
+    for (auto target : kModulationTargets) targets_[target].Commit();
+    for (auto *oscillator : oscillators_) {
+      if (oscillator) oscillator->Advance(frames_per_buffer);
+    }
+    for (int lane = 0; lane < kVoiceLanes; lane++) {
+      if (generators_[lane])
+        generators_[lane]->RetireIfInaudible(*programs_[lane]);
+    }
+  }
+
+ private:
+  const GeneratorProgram *programs_[kVoiceLanes]{};
+  Generator *generators_[kVoiceLanes]{};
+  ModFMOscillator *oscillators_[kVoiceLanes]{};
+  double note_freqs_[kVoiceLanes];
+  double phases_[kVoiceLanes];
+  double enabled_[kVoiceLanes];
+  TargetLanes targets_[NUM_TARGETS];
+};
+
+bool IsModFM(Generator *generator) {
+  IOscillator *oscillator = generator->oscillator();
+  return oscillator &&
+         oscillator->osc_type() == GeneratorPatch::OscType::MOD_FM;
+}
+
+}  // namespace
+
+void VoiceLanes::Perform(SampleRate sample_rate, const RenderProgram &program,
+                         Voice *const *voices, size_t num_voices,
+                         GeneratorScratch &scratch, double *mix_buffer,
+                         size_t frames_per_buffer) {
+  lane_mix_.assign(frames_per_buffer * kVoiceLanes, 0.0);
+  lane_gains_.assign(frames_per_buffer * kVoiceLanes, 1.0);
+
+  std::bitset<kNumGenerators> lane_rendered[kVoiceLanes];
+  DspLoadMeter *const meter =
+      load_meter_ && load_meter_->detailed() ? load_meter_ : nullptr;
+  for (size_t i = 0; i < program.num_generators; i++) {
+    const Ticks start = meter ? ReadTicks() : 0;
+    PerformGenerator(sample_rate, frames_per_buffer, program.generators[i],
+                     voices, num_voices, lane_rendered);
+    if (meter)
+      meter->AddGenerator(program.generators[i].gennum, ReadTicks() - start);
+  }
+
+  // Render whatever couldn't go into lanes the regular way, applying the
+  // fade-out of any voices being stolen.
+  for (size_t lane = 0; lane < num_voices; lane++) {
+    Voice *voice = voices[lane];
+    if (!voice->Stealing()) {
+      voice->PerformGenerators(sample_rate, program, lane_rendered[lane],
+                               false, scratch, mix_buffer, frames_per_buffer);
+      continue;
+    }
+    // Rendered over the mix, and what it added scaled by the fade.
+    std::copy_n(mix_buffer, frames_per_buffer, std::begin(steal_mix_));
+    voice->PerformGenerators(sample_rate, program, lane_rendered[lane], false,
+                             scratch, mix_buffer, frames_per_buffer);
+    voice->AdvanceFade(frames_per_buffer, steal_gains_);
+    for (size_t i = 0; i < frames_per_buffer; i++) {
+      mix_buffer[i] =
+          steal_mix_[i] + (mix_buffer[i] - steal_mix_[i]) * steal_gains_[i];
+      lane_gains_[i * kVoiceLanes + lane] = steal_gains_[i];
+    }
+  }
+
+  // Fold the lanes down into the mix.
+  Vec8d mix, gains;
+  for (size_t i = 0; i < frames_per_buffer; i++) {
+    mix.load(&lane_mix_[i * kVoiceLanes]);
+    gains.load(&lane_gains_[i * kVoiceLanes]);
+    mix_buffer[i] += horizontal_add(mix * gains);
+  }
+}
+
+void VoiceLanes::PerformGenerator(SampleRate sample_rate,
+                                  size_t frames_per_buffer,
+                                  const GeneratorProgram &program,
+                                  Voice *const *voices, size_t num_voices,
+                                  std::bitset<kNumGenerators> *lane_rendered) {
+  // Left to each voice, which plays the baked wavetable instead.
+  if (WavetableCurrent(program)) return;
+  const int gennum = program.gennum;
+  ModFMLanes lanes;
+  bool any_lanes = false;
+  for (size_t lane = 0; lane < num_voices; lane++) {
+    Voice *voice = voices[lane];
+    if (!voice->GeneratorActive(gennum)) continue;
+    Generator *generator = voice->generator(gennum);
+    if (!IsModFM(generator)) continue;
+    lanes.Load(lane, sample_rate, program, generator, voice->note_frequency());
+    lane_rendered[lane].set(gennum);
+    any_lanes = true;
+  }
+  if (!any_lanes) return;
+
+  lanes.Perform(sample_rate, frames_per_buffer, [this](size_t i, Vec8d out) {
+    Vec8d mix;
+    mix.load(&lane_mix_[i * kVoiceLanes]);
+    mix += out;
+    mix.store(&lane_mix_[i * kVoiceLanes]);
+  });
+}
+
+bool CanPerformGeneratorLanes(Generator *generator) {
+  return IsModFM(generator);
+}
+
+void PerformGeneratorLanes(SampleRate sample_rate, double note_frequency,
+                           const GeneratorProgram *const *programs,
+                           Generator *const *generators, size_t num_generators,
+                           double *buffer, size_t frames) {
+  CHECK_LE(num_generators, size_t(kVoiceLanes));
+  ModFMLanes lanes;
+  for (size_t lane = 0; lane < num_generators; lane++) {
+    lanes.Load(lane, sample_rate, *programs[lane], generators[lane],
+               note_frequency);
+  }
+  lanes.Perform(sample_rate, frames, [buffer](size_t i, Vec8d out) {
+    buffer[i] += horizontal_add(out);
+  });
+}
+
+}  // namespace sidebands
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <vector>
+
+#include "processor/patch_processor.h"
+#include "processor/synthesis/render_program.h"
+#include "processor/synthesis/voice.h"
+
+namespace sidebands {
+
+class DspLoadMeter;
+
+// Number of SIMD lanes used by the lane renderers below.
+constexpr int kVoiceLanes = 8;
+
+// Renders a group of up to kVoiceLanes voices together, with each voice in its
+// own SIMD lane. All voices play the same patch, so for a given generator the
+// lanes share one configuration and differ only in note, velocity and
+// modulator state. Oscillator phases, envelopes and LFOs for the whole group
+// advance together one sample at a time, so vector throughput doesn't depend on
+// the size of the block being rendered.
+//
+// Only ModFM generators are packed into lanes. Anything else is rendered
+// through the voice's regular per-generator path.
+class VoiceLanes {
+ public:
+  // Generators are timed into `load_meter`, if there is one, while it asks for
+  // detail.
+  explicit VoiceLanes(DspLoadMeter *load_meter = nullptr)
+      : load_meter_(load_meter),
+        steal_mix_(kMaxSliceSamples),
+        steal_gains_(kMaxSliceSamples) {
+    lane_mix_.reserve(kMaxSliceSamples * kVoiceLanes);
+    lane_gains_.reserve(kMaxSliceSamples * kVoiceLanes);
+  }
+
+  // Render `frames_per_buffer` samples, at most kMaxSliceSamples, of
+  // `num_voices` (at most kVoiceLanes) voices, adding their output into
+  // `mix_buffer`. `scratch` belongs to the worker doing the rendering.
+  void Perform(SampleRate sample_rate, const RenderProgram &program,
+               Voice *const *voices, size_t num_voices,
+               GeneratorScratch &scratch, double *mix_buffer,
+               size_t frames_per_buffer);
+
+ private:
+  // Render one generator across the lanes into lane_mix_, marking the voices
+  // it handled in `lane_rendered`.
+  void PerformGenerator(SampleRate sample_rate, size_t frames_per_buffer,
+                        const GeneratorProgram &program,
+                        Voice *const *voices, size_t num_voices,
+                        std::bitset<kNumGenerators> *lane_rendered);
+
+  DspLoadMeter *const load_meter_;
+  // Output of each lane, interleaved by sample: [sample][lane].
+  std::vector<double> lane_mix_;
+  // Steal fade-out gain of each lane, interleaved the same way.
+  std::vector<double> lane_gains_;
+  // Scratch for voices being stolen, as in Voice.
+  OscBuffer steal_mix_;
+  OscBuffer steal_gains_;
+};
+
+// Whether `generator` can be rendered by PerformGeneratorLanes. Only ModFM
+// oscillators can.
+bool CanPerformGeneratorLanes(Generator *generator);
+
+// Renders up to kVoiceLanes generators of a single voice together, one
+// generator per SIMD lane, for `frames` samples, and adds the sum of the lanes
+// into `buffer`. Each lane takes its parameters and modulators from its own
+// generator program, so this is the layout for patches with many generators
+// rather than many voices.
+void PerformGeneratorLanes(SampleRate sample_rate, double note_frequency,
+                           const GeneratorProgram *const *programs,
+                           Generator *const *generators, size_t num_generators,
+                           double *buffer, size_t frames);
+
+}  // namespace sidebands
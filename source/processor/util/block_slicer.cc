@@ -0,0 +1,82 @@
+#include "processor/util/block_slicer.h"
+
+#include <pluginterfaces/vst/ivstevents.h>
+#include <pluginterfaces/vst/ivstparameterchanges.h>
+
+#include <algorithm>
+
+namespace sidebands {
+
+namespace {
+
+template <typename SampleType>
+void OffsetChannels(SampleType **channels, int32 num_channels, int32 samples) {
+  if (!channels) return;
+  for (int32 channel = 0; channel < num_channels; channel++) {
+    if (channels[channel]) channels[channel] += samples;
+  }
+}
+
+void OffsetBus(Steinberg::Vst::AudioBusBuffers &bus, bool sample64,
+               int32 samples) {
+  if (sample64)
+    OffsetChannels(bus.channelBuffers64, bus.numChannels, samples);
+  else
+    OffsetChannels(bus.channelBuffers32, bus.numChannels, samples);
+}
+
+}  // namespace
+
+BlockSlicer::BlockSlicer(int32 max_slice_samples)
+    : max_slice_samples_(max_slice_samples) {
+  // One more for the end of the block.
+  split_offsets_.reserve(kMaxSplits + 1);
+}
+
+void BlockSlicer::AddSplit(int32 offset) {
+  if (split_offsets_.size() < kMaxSplits) split_offsets_.push_back(offset);
+}
+
+void BlockSlicer::ComputeSplits(const Steinberg::Vst::ProcessData &data) {
+  const int32 num_samples = data.numSamples;
+  split_offsets_.clear();
+
+  if (auto *changes = data.inputParameterChanges) {
+    for (int32 i = 0; i < changes->getParameterCount(); i++) {
+      auto *queue = changes->getParameterData(i);
+      if (!queue) continue;
+      for (int32 p = 0; p < queue->getPointCount(); p++) {
+        int32 offset;
+        Steinberg::Vst::ParamValue value;
+        if (queue->getPoint(p, offset, value) != Steinberg::kResultTrue)
+          continue;
+        if (offset <= 0 || offset >= num_samples) continue;
+        AddSplit(offset);
+      }
+    }
+  }
+  if (auto *events = data.inputEvents) {
+    for (int32 i = 0; i < events->getEventCount(); i++) {
+      Steinberg::Vst::Event event;
+      if (events->getEvent(i, event) != Steinberg::kResultOk) continue;
+      if (event.sampleOffset <= 0 || event.sampleOffset >= num_samples)
+        continue;
+      AddSplit(event.sampleOffset);
+    }
+  }
+  split_offsets_.push_back(num_samples);
+  std::sort(split_offsets_.begin(), split_offsets_.end());
+}
+
+// static
+void BlockSlicer::OffsetBuffers(Steinberg::Vst::ProcessData &data,
+                                int32 samples) {
+  const bool sample64 =
+      data.symbolicSampleSize == Steinberg::Vst::SymbolicSampleSizes::kSample64;
+  for (int32 i = 0; i < data.numInputs; i++)
+    OffsetBus(data.inputs[i], sample64, samples);
+  for (int32 i = 0; i < data.numOutputs; i++)
+    OffsetBus(data.outputs[i], sample64, samples);
+}
+
+}  // namespace sidebands
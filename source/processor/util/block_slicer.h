@@ -0,0 +1,65 @@
+#pragma once
+
+#include <pluginterfaces/vst/ivstaudioprocessor.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace sidebands {
+
+using Steinberg::int32;
+
+// Splits a host process block into slices at the sample offsets where
+// something happens: parameter automation points and note events. A block
+// with neither renders in as few passes as `max_slice_samples` allows.
+// Automation ramps are followed sample by sample within a slice, so they don't
+// need any further cuts. A block is cut at no more than kMaxSplits places;
+// anything past those happens at the start of the slice it falls in.
+//
+// Like Steinberg::Vst::ProcessDataSlicer, the callback is handed the block's
+// ProcessData with numSamples and the channel buffers narrowed to the slice,
+// along with the offset of the slice within the block.
+class BlockSlicer {
+ public:
+  static constexpr size_t kMaxSplits = 256;
+
+  explicit BlockSlicer(int32 max_slice_samples);
+
+  template <typename ProcessFn>
+  void Process(Steinberg::Vst::ProcessData &data, ProcessFn process_fn);
+
+ private:
+  // Fill split_offsets_ for the block in `data`.
+  void ComputeSplits(const Steinberg::Vst::ProcessData &data);
+  // Add a split point, unless there are kMaxSplits already.
+  void AddSplit(int32 offset);
+  // Move the audio buffer pointers in `data` forward by `samples`.
+  static void OffsetBuffers(Steinberg::Vst::ProcessData &data, int32 samples);
+
+  const int32 max_slice_samples_;
+  // Sorted offsets the block is cut at, ending with its length. Reserved up
+  // front, and never grown, to avoid allocating on the audio thread.
+  std::vector<int32> split_offsets_;
+};
+
+template <typename ProcessFn>
+void BlockSlicer::Process(Steinberg::Vst::ProcessData &data,
+                          ProcessFn process_fn) {
+  ComputeSplits(data);
+
+  const int32 num_samples = data.numSamples;
+  int32 slice_start = 0;
+  for (int32 split : split_offsets_) {
+    while (slice_start < split) {
+      data.numSamples = std::min(split - slice_start, max_slice_samples_);
+      process_fn(data, slice_start);
+      OffsetBuffers(data, data.numSamples);
+      slice_start += data.numSamples;
+    }
+  }
+  OffsetBuffers(data, -slice_start);
+  data.numSamples = num_samples;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,151 @@
+#include "processor/util/dsp_load.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <thread>
+
+namespace sidebands {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How long the tick rate is measured over.
+constexpr auto kCalibrationTime = std::chrono::milliseconds(2);
+// How long the per-voice and per-generator breakdown runs after a request.
+constexpr double kDetailSeconds = 2.0;
+// Time constant of the smoothed load reported to the host.
+constexpr double kSmoothingSeconds = 0.3;
+
+constexpr double kPpm = 1e6;
+
+double MeasureTicksPerSecond() {
+  const auto start = Clock::now();
+  const Ticks start_ticks = ReadTicks();
+  Clock::time_point now;
+  do {
+    std::this_thread::yield();
+    now = Clock::now();
+  } while (now - start < kCalibrationTime);
+  const Ticks end_ticks = ReadTicks();
+  return (end_ticks - start_ticks) /
+         std::chrono::duration<double>(now - start).count();
+}
+
+}  // namespace
+
+double TicksPerSecond() {
+  static const double ticks_per_second = MeasureTicksPerSecond();
+  return ticks_per_second;
+}
+
+// Loads below 8 ppm get a bucket each; above that, each power of two is split
+// into 8 buckets by the 3 bits after the leading one.
+int LoadStats::BucketFor(uint32_t ppm) {
+  if (ppm < 8) return ppm;
+  const int exponent = std::bit_width(ppm) - 1;
+  return (exponent - 2) * 8 + ((ppm >> (exponent - 3)) & 7);
+}
+
+uint32_t LoadStats::BucketFloor(int bucket) {
+  if (bucket < 8) return bucket;
+  const int exponent = bucket / 8 + 2;
+  return uint32_t(8 + bucket % 8) << (exponent - 3);
+}
+
+void LoadStats::Add(double load) {
+  const auto ppm = uint32_t(std::clamp(load * kPpm, 0.0, double(kMaxPpm)));
+  histogram_[BucketFor(ppm)].fetch_add(1, std::memory_order_relaxed);
+  sum_ppm_.fetch_add(ppm, std::memory_order_relaxed);
+  uint32_t max = max_ppm_.load(std::memory_order_relaxed);
+  while (ppm > max &&
+         !max_ppm_.compare_exchange_weak(max, ppm, std::memory_order_relaxed)) {
+  }
+  // Last, so a reader that sees the count sees the rest of the load too.
+  count_.fetch_add(1, std::memory_order_release);
+}
+
+LoadStats::Summary LoadStats::TakeSummary() {
+  const uint64_t count = count_.load(std::memory_order_acquire);
+  const uint64_t sum_ppm = sum_ppm_.load(std::memory_order_relaxed);
+  const uint32_t max_ppm = max_ppm_.exchange(0, std::memory_order_relaxed);
+  std::array<uint32_t, kNumBuckets> histogram;
+  for (int b = 0; b < kNumBuckets; b++)
+    histogram[b] = histogram_[b].load(std::memory_order_relaxed);
+
+  Summary summary;
+  summary.count = count - last_count_;
+  if (summary.count) {
+    summary.mean = (sum_ppm - last_sum_ppm_) / kPpm / summary.count;
+    summary.max = max_ppm / kPpm;
+    // The 99th percentile is reported as the top of the bucket it falls in,
+    // but no higher than the maximum. Loads added while the histogram was
+    // being copied may be counted in it but not in `count`, or the other way
+    // round, which only moves the percentile within a bucket or so.
+    const uint64_t rank = (summary.count * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (int b = 0; b < kNumBuckets; b++) {
+      seen += uint32_t(histogram[b] - last_histogram_[b]);
+      if (seen < rank) continue;
+      const uint32_t top =
+          b + 1 < kNumBuckets ? BucketFloor(b + 1) - 1 : kMaxPpm;
+      summary.p99 = std::min(top, max_ppm) / kPpm;
+      break;
+    }
+  }
+  last_count_ = count;
+  last_sum_ppm_ = sum_ppm;
+  last_histogram_ = histogram;
+  return summary;
+}
+
+void DspLoadMeter::Prepare(double sample_rate) {
+  sample_rate_ = sample_rate;
+  ticks_per_sample_ = TicksPerSecond() / sample_rate;
+  smoothed_load_ = 0.0;
+}
+
+void DspLoadMeter::BeginBlock(int64_t frames) {
+  block_frames_ = frames;
+  player_ticks_ = 0;
+  if (requested_.exchange(false, std::memory_order_relaxed))
+    detail_samples_ = std::llround(kDetailSeconds * sample_rate_);
+  detailed_ = detail_samples_ > 0;
+  detail_samples_ -= frames;
+}
+
+void DspLoadMeter::AddVoice(Ticks elapsed, size_t frames) {
+  if (frames) voice_.Add(elapsed / (ticks_per_sample_ * frames));
+}
+
+void DspLoadMeter::EndBlock(Ticks process_elapsed) {
+  // Parameter flushes render nothing, so have no load to speak of.
+  if (!block_frames_ || ticks_per_sample_ <= 0.0) return;
+  const double block_ticks = ticks_per_sample_ * block_frames_;
+  const double load = process_elapsed / block_ticks;
+  process_.Add(load);
+  player_.Add(player_ticks_ / block_ticks);
+  if (detailed_) {
+    for (int g = 0; g < kNumGenerators; g++) {
+      const Ticks ticks =
+          generator_ticks_[g].exchange(0, std::memory_order_relaxed);
+      if (ticks) generators_[g].Add(ticks / block_ticks);
+    }
+  }
+  smoothed_load_ +=
+      (load - smoothed_load_) *
+      (1.0 - std::exp(-block_frames_ / (kSmoothingSeconds * sample_rate_)));
+}
+
+DspLoadMeter::Snapshot DspLoadMeter::TakeSnapshot() {
+  Snapshot snapshot;
+  snapshot.process = process_.TakeSummary();
+  snapshot.player = player_.TakeSummary();
+  snapshot.voice = voice_.TakeSummary();
+  for (int g = 0; g < kNumGenerators; g++)
+    snapshot.generators[g] = generators_[g].TakeSummary();
+  return snapshot;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "constants.h"
+
+namespace sidebands {
+
+// Timestamps for profiling the audio thread: the CPU's own counter where there
+// is one, which takes a few nanoseconds to read, and the steady clock
+// elsewhere. Only differences mean anything; TicksPerSecond converts them.
+using Ticks = uint64_t;
+
+inline Ticks ReadTicks() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  Ticks ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Rate of ReadTicks, measured against the steady clock by the first call,
+// which takes a couple of milliseconds.
+double TicksPerSecond();
+
+// Running distribution of loads, each a fraction of the time a block had to
+// be rendered in. Any number of threads add to it without locking or
+// allocating; one other thread at a time reads a summary of what was added
+// since it last looked. Loads are kept in a histogram with buckets 1/8 of an
+// octave wide, so percentiles are good to about 12%.
+class LoadStats {
+ public:
+  struct Summary {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+  };
+
+  void Add(double load);
+  // Summary of the loads added since the last call.
+  Summary TakeSummary();
+
+ private:
+  // Loads are counted in parts per million, up to kMaxPpm.
+  static constexpr uint32_t kMaxPpm = (1u << 24) - 1;
+  static constexpr int kNumBuckets = 176;
+  static int BucketFor(uint32_t ppm);
+  // Smallest load, in ppm, that lands in `bucket`.
+  static uint32_t BucketFloor(int bucket);
+
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_ppm_{0};
+  // Since the last summary.
+  std::atomic<uint32_t> max_ppm_{0};
+  std::array<std::atomic<uint32_t>, kNumBuckets> histogram_{};
+
+  // The reader's copy of the counts at the last summary, which the next one
+  // is the difference from. The counts only ever grow, so wrapping is fine.
+  uint64_t last_count_ = 0;
+  uint64_t last_sum_ppm_ = 0;
+  std::array<uint32_t, kNumBuckets> last_histogram_{};
+};
+
+// Where the audio thread's time goes, for the load meter: each process()
+// call, the player's share of it, each voice, and each generator summed over
+// the voices playing it, all relative to the length of the audio rendered.
+//
+// The process and player figures cost two timestamps a block and are always
+// kept. The per-voice and per-generator breakdown costs a timestamp per
+// generator per voice, so it's only taken for a few seconds after each
+// Request(); the views asking for it poll.
+class DspLoadMeter {
+ public:
+  // Load of each part, as summarised by LoadStats.
+  struct Snapshot {
+    LoadStats::Summary process;
+    LoadStats::Summary player;
+    LoadStats::Summary voice;
+    std::array<LoadStats::Summary, kNumGenerators> generators;
+  };
+
+  // Before the first block after activation. Not from the audio thread; the
+  // first call calibrates the tick rate.
+  void Prepare(double sample_rate);
+
+  // Audio thread. Blocks are bracketed by BeginBlock and EndBlock; the player
+  // adds its time in between, and voices and generators theirs from its
+  // workers.
+  void BeginBlock(int64_t frames);
+  void AddPlayer(Ticks elapsed) { player_ticks_ += elapsed; }
+  void AddVoice(Ticks elapsed, size_t frames);
+  void AddGenerator(int gennum, Ticks elapsed) {
+    generator_ticks_[gennum].fetch_add(elapsed, std::memory_order_relaxed);
+  }
+  void EndBlock(Ticks process_elapsed);
+  // Whether voices and generators should time themselves this block.
+  bool detailed() const { return detailed_; }
+  // Load of process() smoothed over the last few hundred milliseconds.
+  double smoothed_load() const { return smoothed_load_; }
+
+  // Any thread. Keeps the breakdown going for another few seconds.
+  void Request() { requested_.store(true, std::memory_order_relaxed); }
+  // One thread at a time: loads since the last snapshot.
+  Snapshot TakeSnapshot();
+
+ private:
+  double sample_rate_ = 0.0;
+  double ticks_per_sample_ = 0.0;
+  std::atomic<bool> requested_{false};
+  // Samples left before the breakdown stops.
+  int64_t detail_samples_ = 0;
+  bool detailed_ = false;
+  int64_t block_frames_ = 0;
+  Ticks player_ticks_ = 0;
+  double smoothed_load_ = 0.0;
+
+  LoadStats process_;
+  LoadStats player_;
+  LoadStats voice_;
+  // Time spent in each generator during the current block, across voices.
+  std::array<std::atomic<Ticks>, kNumGenerators> generator_ticks_{};
+  std::array<LoadStats, kNumGenerators> generators_;
+};
+
+}  // namespace sidebands
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sidebands {
+
+// A gain moving in a straight line to a target over a given number of
+// samples, applied to buffers in place.
+class GainRamp {
+ public:
+  explicit GainRamp(double gain = 1.0) : gain_(gain), target_(gain) {}
+
+  // Head for `target`, reaching it in `samples`; straight away for none.
+  void Set(double target, int64_t samples) {
+    target_ = target;
+    remaining_ = samples > 0 ? samples : 0;
+    step_ = remaining_ ? (target_ - gain_) / remaining_ : 0.0;
+    if (!remaining_) gain_ = target_;
+  }
+
+  double gain() const { return gain_; }
+  double target() const { return target_; }
+  // Whether the gain has reached its target.
+  bool done() const { return remaining_ == 0; }
+
+  template <typename T>
+  void Apply(T *buffer, size_t num_samples) {
+    size_t i = 0;
+    for (; i < num_samples && remaining_; i++, remaining_--) {
+      gain_ += step_;
+      buffer[i] *= gain_;
+    }
+    if (remaining_ == 0) gain_ = target_;
+    if (gain_ == 1.0) return;
+    for (; i < num_samples; i++) buffer[i] *= gain_;
+  }
+
+ private:
+  double gain_;
+  double target_;
+  double step_ = 0.0;
+  int64_t remaining_ = 0;
+};
+
+}  // namespace sidebands
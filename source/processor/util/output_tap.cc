@@ -0,0 +1,52 @@
+#include "processor/util/output_tap.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace sidebands {
+
+OutputTap::OutputTap(size_t capacity)
+    : capacity_(std::bit_ceil(capacity)), mask_(capacity_ - 1) {}
+
+void OutputTap::set_active(bool active) {
+  if (active && ring_.empty()) ring_.resize(capacity_);
+  active_.store(active, std::memory_order_release);
+}
+
+size_t OutputTap::Free(uint64_t write) const {
+  return capacity_ - (write - read_.load(std::memory_order_acquire));
+}
+
+void OutputTap::Write(const double *buffer, size_t frames) {
+  if (!active()) return;
+  const uint64_t write = write_.load(std::memory_order_relaxed);
+  const size_t n = std::min(frames, Free(write));
+  for (size_t i = 0; i < n; i++) ring_[(write + i) & mask_] = float(buffer[i]);
+  write_.store(write + n, std::memory_order_release);
+  if (n < frames) dropped_.fetch_add(frames - n, std::memory_order_relaxed);
+}
+
+void OutputTap::WriteSilence(size_t frames) {
+  if (!active()) return;
+  const uint64_t write = write_.load(std::memory_order_relaxed);
+  const size_t n = std::min(frames, Free(write));
+  for (size_t i = 0; i < n; i++) ring_[(write + i) & mask_] = 0.0f;
+  write_.store(write + n, std::memory_order_release);
+  if (n < frames) dropped_.fetch_add(frames - n, std::memory_order_relaxed);
+}
+
+size_t OutputTap::Read(float *out, size_t max_samples) {
+  const uint64_t read = read_.load(std::memory_order_relaxed);
+  const uint64_t write = write_.load(std::memory_order_acquire);
+  const size_t n = std::min<uint64_t>(max_samples, write - read);
+  for (size_t i = 0; i < n; i++) out[i] = ring_[(read + i) & mask_];
+  read_.store(read + n, std::memory_order_release);
+  return n;
+}
+
+void OutputTap::Skip() {
+  read_.store(write_.load(std::memory_order_acquire),
+              std::memory_order_release);
+}
+
+}  // namespace sidebands
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sidebands {
+
+// A single-producer, single-consumer ring of float samples for watching what
+// the audio thread renders. Writing is wait-free and never allocates; when the
+// consumer falls behind, the samples that don't fit are dropped rather than
+// waited for. Until something switches it on, a write is a single relaxed
+// load.
+class OutputTap {
+ public:
+  // `capacity` is rounded up to a power of two. The ring is only allocated
+  // when the tap is first switched on, so instances no one watches don't pay
+  // for it.
+  explicit OutputTap(size_t capacity);
+
+  bool active() const { return active_.load(std::memory_order_acquire); }
+  // Not from the audio thread; the first switch on allocates.
+  void set_active(bool active);
+
+  // Producer (audio thread).
+  void Write(const double *buffer, size_t frames);
+  void WriteSilence(size_t frames);
+
+  // Consumer. Reads up to `max_samples` samples, returning how many.
+  size_t Read(float *out, size_t max_samples);
+  // Drops everything written so far, e.g. samples left over from before the
+  // tap was last switched off.
+  void Skip();
+  // Samples dropped because the ring was full.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  // Room for the producer to write, given where the consumer has read to.
+  size_t Free(uint64_t write) const;
+
+  std::vector<float> ring_;
+  const size_t capacity_;
+  const uint64_t mask_;
+  std::atomic<bool> active_{false};
+  // Running counts of samples written and read; positions in the ring are
+  // these masked.
+  alignas(64) std::atomic<uint64_t> write_{0};
+  alignas(64) std::atomic<uint64_t> read_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+}  // namespace sidebands
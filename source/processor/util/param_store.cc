@@ -0,0 +1,180 @@
+#include "processor/util/param_store.h"
+
+#include <glog/logging.h>
+#include <vectorclass.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace sidebands {
+
+namespace {
+
+constexpr double kNoPoint = std::numeric_limits<double>::infinity();
+
+}  // namespace
+
+ParamStore::ParamStore() {
+  std::fill(std::begin(normalized_), std::end(normalized_), 0.0);
+  std::fill(std::begin(plain_), std::end(plain_), 0.0);
+  std::fill(std::begin(min_), std::end(min_), 0.0);
+  std::fill(std::begin(range_), std::end(range_), 0.0);
+  std::fill(std::begin(ramp_), std::end(ramp_), 0.0);
+  std::fill(std::begin(remaining_), std::end(remaining_), kNoPoint);
+  std::fill(std::begin(target_), std::end(target_), 0.0);
+  std::fill(std::begin(kinds_), std::end(kinds_), Kind::UNUSED);
+  std::fill(std::begin(param_ids_), std::end(param_ids_), 0);
+  std::fill(std::begin(queues_), std::end(queues_), nullptr);
+  std::fill(std::begin(next_points_), std::end(next_points_), 0);
+}
+
+void ParamStore::Declare(int slot, ParamID param_id, Kind kind, ParamValue min,
+                         ParamValue max, ParamValue default_value) {
+  CHECK_GE(slot, 0);
+  CHECK_LT(slot, kNumUsedParamSlots);
+  CHECK(kind != Kind::UNUSED);
+  kinds_[slot] = kind;
+  param_ids_[slot] = param_id;
+  min_[slot] = min;
+  range_[slot] = max - min;
+  SetValue(slot, default_value);
+}
+
+void ParamStore::SetValue(int slot, ParamValue value) {
+  SetNormalizedValue(slot, (value - min_[slot]) / range_[slot]);
+}
+
+void ParamStore::SetNormalizedValue(int slot, ParamValue value) {
+  normalized_[slot] = value;
+  ramp_[slot] = 0.0;
+  remaining_[slot] = kNoPoint;
+  UpdatePlain(slot);
+}
+
+void ParamStore::LoadNormalized(const double *values) {
+  for (int slot = 0; slot < kNumUsedParamSlots; slot++)
+    normalized_[slot] = Declared(slot) ? values[slot] : 0.0;
+  std::fill(std::begin(ramp_), std::end(ramp_), 0.0);
+  std::fill(std::begin(remaining_), std::end(remaining_), kNoPoint);
+  Vec8d normalized, min, range;
+  for (int slot = 0; slot < kNumParamSlots; slot += 8) {
+    normalized.load_a(&normalized_[slot]);
+    min.load_a(&min_[slot]);
+    range.load_a(&range_[slot]);
+    mul_add(normalized, range, min).store_a(&plain_[slot]);
+  }
+}
+
+void ParamStore::SaveNormalized(double *values) const {
+  std::copy(normalized_, normalized_ + kNumUsedParamSlots, values);
+}
+
+void ParamStore::BeginChanges(int slot, IParamValueQueue *queue) {
+  const int32 num_points = queue->getPointCount();
+  if (!num_points) return;
+
+  if (kinds_[slot] != Kind::SAMPLE_ACCURATE) {
+    int32 offset;
+    ParamValue value;
+    if (queue->getPoint(num_points - 1, offset, value) == Steinberg::kResultTrue)
+      SetNormalizedValue(slot, value);
+    return;
+  }
+
+  if (queues_[slot]) return;
+  queues_[slot] = queue;
+  next_points_[slot] = 0;
+  changed_slots_[num_changed_slots_++] = slot;
+  LoadNextPoint(slot, block_position_);
+}
+
+void ParamStore::Advance(int32 num_samples) {
+  if (!num_changed_slots_) return;
+
+  // Slots reaching an automation point in this stretch are stepped through
+  // their points one by one. They're then wound back by one stretch of their
+  // new ramp, so that the vector pass below brings them to the right place.
+  for (int i = 0; i < num_changed_slots_; i++) {
+    const int slot = changed_slots_[i];
+    if (remaining_[slot] < num_samples) AdvanceThroughPoints(slot, num_samples);
+  }
+
+  const Vec8d samples(num_samples);
+  Vec8d normalized, ramp, remaining, min, range;
+  for (int slot = 0; slot < kNumParamSlots; slot += 8) {
+    normalized.load_a(&normalized_[slot]);
+    ramp.load_a(&ramp_[slot]);
+    remaining.load_a(&remaining_[slot]);
+    min.load_a(&min_[slot]);
+    range.load_a(&range_[slot]);
+    normalized = mul_add(ramp, samples, normalized);
+    remaining -= samples;
+    normalized.store_a(&normalized_[slot]);
+    remaining.store_a(&remaining_[slot]);
+    mul_add(normalized, range, min).store_a(&plain_[slot]);
+  }
+  block_position_ += num_samples;
+}
+
+void ParamStore::EndChanges() {
+  // Jump to the final point of each queue.
+  for (int i = 0; i < num_changed_slots_; i++) {
+    const int slot = changed_slots_[i];
+    IParamValueQueue *queue = queues_[slot];
+    const int32 num_points = queue->getPointCount();
+    int32 offset;
+    ParamValue value;
+    if (num_points &&
+        queue->getPoint(num_points - 1, offset, value) ==
+            Steinberg::kResultTrue) {
+      SetNormalizedValue(slot, value);
+    } else {
+      SetNormalizedValue(slot, normalized_[slot]);
+    }
+    queues_[slot] = nullptr;
+  }
+  num_changed_slots_ = 0;
+  block_position_ = 0;
+}
+
+void ParamStore::AdvanceThroughPoints(int slot, int32 num_samples) {
+  int32 position = block_position_;
+  int32 samples_left = num_samples;
+  while (remaining_[slot] < samples_left) {
+    const auto step = std::max(int32(remaining_[slot]), 0);
+    position += step;
+    samples_left -= step;
+    normalized_[slot] = target_[slot];
+    LoadNextPoint(slot, position);
+  }
+  const double value = normalized_[slot] + ramp_[slot] * samples_left;
+  const double remaining = remaining_[slot] - samples_left;
+  normalized_[slot] = value - ramp_[slot] * num_samples;
+  remaining_[slot] = remaining + num_samples;
+}
+
+void ParamStore::LoadNextPoint(int slot, int32 position) {
+  IParamValueQueue *queue = queues_[slot];
+  int32 offset;
+  ParamValue value;
+  if (next_points_[slot] >= queue->getPointCount() ||
+      queue->getPoint(next_points_[slot], offset, value) !=
+          Steinberg::kResultTrue) {
+    ramp_[slot] = 0.0;
+    remaining_[slot] = kNoPoint;
+    target_[slot] = normalized_[slot];
+    return;
+  }
+  next_points_[slot]++;
+  offset -= position;
+  target_[slot] = value;
+  remaining_[slot] = offset;
+  // A point right here is reached immediately, rather than ramped to.
+  ramp_[slot] = offset > 0 ? (value - normalized_[slot]) / offset : 0.0;
+}
+
+void ParamStore::UpdatePlain(int slot) {
+  plain_[slot] = min_[slot] + normalized_[slot] * range_[slot];
+}
+
+}  // namespace sidebands
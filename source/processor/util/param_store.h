@@ -0,0 +1,161 @@
+#pragma once
+
+#include <pluginterfaces/vst/ivstparameterchanges.h>
+#include <pluginterfaces/vst/vsttypes.h>
+
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+
+#include "param_descriptors.h"
+#include "tags.h"
+
+namespace sidebands {
+
+using Steinberg::int32;
+using Steinberg::Vst::IParamValueQueue;
+using Steinberg::Vst::ParamID;
+using Steinberg::Vst::ParamValue;
+
+// Every generator parameter has a fixed slot in its generator's ParamStore.
+// The generator-wide parameters come first, followed by a block of
+// kSlotsPerModulationTarget for each of kModulationTargets.
+constexpr TargetTag kOscillatorTargets[]{
+    TARGET_C, TARGET_A, TARGET_M,          TARGET_K,
+    TARGET_R, TARGET_S, TARGET_PORTAMENTO, TARGET_OSC_TYPE};
+constexpr ParamTag kModulationParamTags[]{
+    TAG_MODULATIONS, TAG_ENV_HT,   TAG_ENV_AR,   TAG_ENV_AL,   TAG_ENV_DR1,
+    TAG_ENV_DL1,     TAG_ENV_DR2,  TAG_ENV_SL,   TAG_ENV_RR1,  TAG_ENV_RL1,
+    TAG_ENV_RR2,     TAG_ENV_VS,   TAG_LFO_TYPE, TAG_LFO_FREQ, TAG_LFO_AMP,
+    TAG_LFO_VS};
+constexpr int kSlotsPerModulationTarget = std::size(kModulationParamTags);
+constexpr int kNumUsedParamSlots =
+    1 + std::size(kOscillatorTargets) +
+    std::size(kModulationTargets) * kSlotsPerModulationTarget;
+// Padded so the store can be swept 8 values at a time.
+constexpr int kNumParamSlots = (kNumUsedParamSlots + 7) / 8 * 8;
+
+constexpr int kNoParamSlot = -1;
+
+namespace internal {
+
+using ParamSlotTable =
+    std::array<std::array<int16_t, NUM_TARGETS>, TAG_NUM_TAGS>;
+
+constexpr ParamSlotTable MakeParamSlotTable() {
+  ParamSlotTable table{};
+  for (auto &row : table)
+    for (auto &slot : row) slot = kNoParamSlot;
+  int16_t slot = 0;
+  table[TAG_GENERATOR_TOGGLE][TARGET_NA] = slot++;
+  for (auto target : kOscillatorTargets) table[TAG_OSC][target] = slot++;
+  for (auto target : kModulationTargets)
+    for (auto tag : kModulationParamTags) table[tag][target] = slot++;
+  return table;
+}
+
+constexpr ParamSlotTable kParamSlotTable = MakeParamSlotTable();
+
+}  // namespace internal
+
+// Slot of the parameter with the given tags, or kNoParamSlot.
+constexpr int ParamSlotFor(ParamTag param, TargetTag target) {
+  if (param < 0 || param >= TAG_NUM_TAGS || target < 0 ||
+      target >= NUM_TARGETS)
+    return kNoParamSlot;
+  return internal::kParamSlotTable[param][target];
+}
+
+// Slot of the parameter with the given ID, ignoring its generator number, or
+// kNoParamSlot.
+inline int ParamSlotFor(ParamID param_id) {
+  return ParamSlotFor(ParamFor(param_id), TargetFor(param_id));
+}
+
+// Holds all of one generator's parameter values as flat arrays indexed by
+// slot: normalised value, plain value, and for automation in progress, ramp
+// per sample and samples until the next automation point. Plain values are
+// kept up to date as values change, so reads need no conversion, and all ramps
+// advance together in one vectorised pass.
+class ParamStore {
+ public:
+  using Kind = ParamKind;
+
+  ParamStore();
+
+  void Declare(int slot, ParamID param_id, Kind kind, ParamValue min,
+               ParamValue max, ParamValue default_value);
+  bool Declared(int slot) const { return kinds_[slot] != Kind::UNUSED; }
+  ParamID param_id(int slot) const { return param_ids_[slot]; }
+
+  ParamValue Value(int slot) const { return plain_[slot]; }
+  ParamValue NormalizedValue(int slot) const { return normalized_[slot]; }
+  // Change in plain value per sample over the last Advance; zero when the
+  // parameter holds steady.
+  ParamValue Ramp(int slot) const { return ramp_[slot] * range_[slot]; }
+  void SetValue(int slot, ParamValue value);
+  void SetNormalizedValue(int slot, ParamValue value);
+  // Normalised values of all kNumUsedParamSlots slots at once, as in a patch
+  // record. Values for undeclared slots are ignored. Loading cancels any
+  // automation ramps.
+  void LoadNormalized(const double *values);
+  void SaveNormalized(double *values) const;
+
+  // Automation for the current block. BeginChanges is called for each queue
+  // before the block's first Advance, and EndChanges once the block is done.
+  void BeginChanges(int slot, IParamValueQueue *queue);
+  void Advance(int32 num_samples);
+  void EndChanges();
+
+ private:
+  // Step `slot` through the automation points falling within the next
+  // `num_samples`.
+  void AdvanceThroughPoints(int slot, int32 num_samples);
+  // Load the next automation point for `slot`, as of `position` samples into
+  // the block.
+  void LoadNextPoint(int slot, int32 position);
+  void UpdatePlain(int slot);
+
+  alignas(64) double normalized_[kNumParamSlots];
+  alignas(64) double plain_[kNumParamSlots];
+  alignas(64) double min_[kNumParamSlots];
+  alignas(64) double range_[kNumParamSlots];
+  alignas(64) double ramp_[kNumParamSlots];
+  // Samples until the next automation point; infinite when there isn't one.
+  alignas(64) double remaining_[kNumParamSlots];
+  // Value at the next automation point.
+  double target_[kNumParamSlots];
+
+  Kind kinds_[kNumParamSlots];
+  ParamID param_ids_[kNumParamSlots];
+
+  // Automation state for the current block.
+  IParamValueQueue *queues_[kNumParamSlots];
+  int32 next_points_[kNumParamSlots];
+  int16_t changed_slots_[kNumParamSlots];
+  int num_changed_slots_ = 0;
+  int32 block_position_ = 0;
+};
+
+// A parameter's value in a ParamStore.
+class ParamRef {
+ public:
+  ParamRef(const ParamStore *store, int slot) : store_(store), slot_(slot) {}
+
+  ParamValue getValue() const { return store_->Value(slot_); }
+  ParamValue getValueNormalized() const {
+    return store_->NormalizedValue(slot_);
+  }
+  template <size_t SIZE>
+  std::bitset<SIZE> bitset() const {
+    return std::bitset<SIZE>(uint64_t(std::lround(store_->Value(slot_))));
+  }
+
+ private:
+  const ParamStore *store_;
+  int slot_;
+};
+
+}  // namespace sidebands
@@ -48,36 +48,4 @@ void Parameter::beginChanges(IParamValueQueue *p_queue) {
   }
 }
 
-void BitsetParameter::setValue(ParamValue v) {
-  value_ = std::bitset<kBitsetWidth>(v);
-}
-
-void BitsetParameter::setValueNormalized(ParamValue v) {
-  value_ = std::bitset<kBitsetWidth>(v * double(kBitsetWidth));
-}
-
-ParamValue BitsetParameter::getValue() const { return value_.to_ulong(); }
-
-ParamValue BitsetParameter::getValueNormalized() const {
-  return value_.to_ulong() / double(kBitsetWidth);
-}
-
-ParamValue BitsetParameter::Min() const { return 0; }
-ParamValue BitsetParameter::Max() const { return kBitsetWidth; }
-ParamID BitsetParameter::getParamID() const { return param_id_; }
-
-bool BitsetParameter::hasChanges() const { return false; }
-void BitsetParameter::beginChanges(IParamValueQueue *p_queue) {
-  const auto &last_v_opt = GetLastValue(p_queue);
-  if (last_v_opt) {
-    setValueNormalized(last_v_opt.value_or(0.0));
-  }
-}
-
-ParamValue BitsetParameter::advance(int32 numSamples) {
-  return getValueNormalized();
-}
-ParamValue BitsetParameter::flushChanges() { return getValueNormalized(); }
-ParamValue BitsetParameter::endChanges() { return getValueNormalized(); }
-
 }  // namespace sidebands
\ No newline at end of file
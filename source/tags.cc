@@ -6,6 +6,9 @@
 
 namespace sidebands {
 
+static_assert(kNumGenerators <= 127,
+              "Generator numbers must fit in the top byte of a ParamID.");
+
 std::pair<UnitTag, uint16_t> ParseUnitID(Steinberg::Vst::UnitID unit_id) {
   return {static_cast<UnitTag>(unit_id >> 16), unit_id & 0x0000ffff};
 }
@@ -25,6 +28,13 @@ std::string TagStr(Steinberg::Vst::ParamID tag) {
                          kTargetNames[sp]);
 }
 
+bool IsGlobalParam(Steinberg::Vst::ParamID tag) {
+  auto param = ParamFor(tag);
+  return param == TAG_POLYPHONY || param == TAG_VOICE_LAYOUT ||
+         param == TAG_BAKED_WAVETABLES || param == TAG_PATCH_FADE ||
+         param == TAG_DSP_LOAD;
+}
+
 uint8_t GeneratorFor(Steinberg::Vst::ParamID tag) {
   uint8_t gen = (tag >> 24);
   return gen;
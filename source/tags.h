@@ -36,13 +36,25 @@ enum ParamTag {
   TAG_LFO_VS,
   TAG_LFO_TYPE,
   TAG_MODULATIONS,
+  // Global (not per generator) engine settings. Their IDs use generator 0 and
+  // TARGET_NA.
+  TAG_POLYPHONY,
+  TAG_VOICE_LAYOUT,
+  TAG_BAKED_WAVETABLES,
+  TAG_PATCH_FADE,
+  // Read-only, written by the processor: its DSP load, as a percentage of
+  // the time it has to render each block in.
+  TAG_DSP_LOAD,
   TAG_NUM_TAGS
 };
 
 constexpr const char *kParamNames[]{
-    "SELECT",  "TOGGLE", "OSC",      "ENV_A",      "ENV_AL",
-    "ENV_D",   "ENV_S",  "ENV_R",    "ENV_VS",     "LFO_FREQ",
-    "LFO_AMP", "LFO_VS", "LFO_TYPE", "MODULATIONS"};
+    "SELECT",  "TOGGLE",  "OSC",      "ENV_HT",      "ENV_AR",
+    "ENV_AL",  "ENV_DR1", "ENV_DL1",  "ENV_DR2",     "ENV_SL",
+    "ENV_RR1", "ENV_RL1", "ENV_RR2",  "ENV_VS",      "LFO_FREQ",
+    "LFO_AMP", "LFO_VS",  "LFO_TYPE", "MODULATIONS", "POLYPHONY",
+    "VOICE_LAYOUT", "BAKED_WAVETABLES", "PATCH_FADE", "DSP_LOAD"};
+static_assert(sizeof(kParamNames) / sizeof(kParamNames[0]) == TAG_NUM_TAGS);
 
 enum TargetTag {
   TARGET_NA,
@@ -85,6 +97,10 @@ struct ParamKey {
   };
 };
 
+// True for parameters which belong to the whole instrument rather than to a
+// generator.
+bool IsGlobalParam(Steinberg::Vst::ParamID tag);
+
 uint8_t GeneratorFor(Steinberg::Vst::ParamID tag);
 TargetTag TargetFor(Steinberg::Vst::ParamID tag);
 ParamTag ParamFor(Steinberg::Vst::ParamID tag);
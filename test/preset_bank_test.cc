@@ -0,0 +1,261 @@
+// Round trips presets through a bank file, switches the live patch to them
+// the way the processor does while playing, and checks that malformed banks
+// and patch records are refused before anything is sized by them, while ones
+// from builds with more generators or parameters load.
+
+#include <gtest/gtest.h>
+
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "constants.h"
+#include "processor/patch_processor.h"
+#include "processor/preset_bank.h"
+#include "processor/standby_patch.h"
+#include "processor/synthesis/render_program.h"
+#include "processor/util/param_store.h"
+#include "tags.h"
+#include "public.sdk/source/common/memorystream.h"
+
+using namespace Steinberg;
+
+namespace sidebands {
+namespace {
+
+constexpr int kCSlot = ParamSlotFor(TAG_OSC, TARGET_C);
+constexpr int kOnSlot = ParamSlotFor(TAG_GENERATOR_TOGGLE, TARGET_NA);
+// Where the bank header keeps the size and offset of its index, whose entries
+// are a 64-bit name hash and a 32-bit preset, padded to 16 bytes.
+constexpr size_t kIndexSizeOffset = 16;
+constexpr size_t kIndexOffsetOffset = 24;
+constexpr size_t kIndexEntrySize = 16;
+constexpr size_t kIndexPresetOffset = 8;
+
+std::vector<double> Record(const PatchProcessor &patch) {
+  std::vector<double> values(
+      PatchLayout::Current().RecordSize(kNumGenerators));
+  patch.SaveRecord(values.data());
+  return values;
+}
+
+// A patch with `num_on` generators on, and generator 0's C at `c`,
+// normalised.
+std::unique_ptr<PatchProcessor> MakePatch(int num_on, double c) {
+  auto patch = std::make_unique<PatchProcessor>();
+  auto values = Record(*patch);
+  const size_t stride = PatchLayout::Current().generator_params.size();
+  for (int g = 0; g < kNumGenerators; g++)
+    values[g * stride + kOnSlot] = g < num_on;
+  values[kCSlot] = c;
+  patch->LoadRecord(PatchLayoutMap(PatchLayout::Current()), kNumGenerators,
+                    values.data());
+  return patch;
+}
+
+std::string BankPath(const char *name) {
+  return ::testing::TempDir() + name + ".sbbk";
+}
+
+std::string ReadFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void WriteFile(const std::string &path, const std::string &contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(contents.data(), contents.size());
+}
+
+TEST(PresetBankTest, FindsAndAppliesPresets) {
+  const auto bright = MakePatch(3, 0.75);
+  const auto dull = MakePatch(1, 0.25);
+  PresetBankWriter writer;
+  writer.Add("bright", *bright);
+  writer.Add("dull", *MakePatch(2, 0.5));
+  // Replaces the first "dull".
+  writer.Add("dull", *dull);
+  const std::string path = BankPath("find");
+  ASSERT_TRUE(writer.Write(path));
+
+  auto bank = PresetBank::Open(path);
+  ASSERT_TRUE(bank);
+  ASSERT_EQ(bank->size(), 2u);
+  const auto preset = bank->Find("dull");
+  ASSERT_TRUE(preset);
+  EXPECT_EQ(bank->name(*preset), "dull");
+  EXPECT_EQ(bank->FindHash(PresetBank::Hash("dull")), preset);
+  EXPECT_FALSE(bank->Find("missing"));
+
+  PatchProcessor patch;
+  bank->Apply(*preset, &patch);
+  EXPECT_EQ(Record(patch), Record(*dull));
+  bank->Apply(*bank->Find("bright"), &patch);
+  EXPECT_EQ(Record(patch), Record(*bright));
+}
+
+// As SidebandsProcessor::LoadPreset does while processing: the preset is
+// applied to a copy and compiled off the audio thread, which then takes it
+// over and installs its program.
+TEST(PresetBankTest, SwitchesLivePatchThroughStandby) {
+  PresetBankWriter writer;
+  writer.Add("one", *MakePatch(1, 0.25));
+  writer.Add("four", *MakePatch(4, 0.5));
+  const std::string path = BankPath("standby");
+  ASSERT_TRUE(writer.Write(path));
+  auto bank = PresetBank::Open(path);
+  ASSERT_TRUE(bank);
+
+  PatchProcessor live;
+  RenderProgramCompiler compiler(&live);
+  StandbyPatch standby;
+  for (const char *name : {"four", "one", "four"}) {
+    const auto preset = bank->Find(name);
+    ASSERT_TRUE(preset);
+    PatchProcessor copy;
+    copy.CopyFrom(live);
+    bank->Apply(*preset, &copy);
+    standby.Queue(copy, compiler.Prepare(copy));
+
+    // The compiler thread takes over the last program installed in its own
+    // time; until it has, the next has to wait.
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!compiler.ReadyToInstall()) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+          << "Installed program never taken over";
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto program = standby.TakeOver(&live);
+    ASSERT_TRUE(program);
+    const size_t num_generators = program->num_generators;
+    compiler.Install(std::move(program));
+    EXPECT_FALSE(standby.TakeOver(&live));
+
+    EXPECT_EQ(Record(live), Record(copy)) << name;
+    const RenderProgram &current = compiler.Acquire();
+    EXPECT_EQ(current.num_generators, num_generators) << name;
+    EXPECT_EQ(current.version, live.structure_version()) << name;
+  }
+}
+
+// Sets the preset of index entries for which `corrupt` returns true.
+template <typename Corrupt>
+void CorruptIndex(const std::string &path, uint32_t preset, Corrupt corrupt) {
+  std::string contents = ReadFile(path);
+  uint32_t index_size;
+  uint64_t index_offset;
+  std::memcpy(&index_size, contents.data() + kIndexSizeOffset,
+              sizeof(index_size));
+  std::memcpy(&index_offset, contents.data() + kIndexOffsetOffset,
+              sizeof(index_offset));
+  ASSERT_LE(index_offset + index_size * kIndexEntrySize, contents.size());
+  for (uint32_t i = 0; i < index_size; i++) {
+    if (!corrupt(i)) continue;
+    std::memcpy(contents.data() + index_offset + i * kIndexEntrySize +
+                    kIndexPresetOffset,
+                &preset, sizeof(preset));
+  }
+  WriteFile(path, contents);
+}
+
+TEST(PresetBankTest, RefusesCorruptIndex) {
+  PresetBankWriter writer;
+  writer.Add("only", *MakePatch(1, 0.5));
+  const std::string path = BankPath("corrupt");
+  ASSERT_TRUE(writer.Write(path));
+  ASSERT_TRUE(PresetBank::Open(path));
+
+  // Every entry full, so that a lookup would never find an empty one.
+  CorruptIndex(path, 0, [](uint32_t) { return true; });
+  EXPECT_FALSE(PresetBank::Open(path));
+
+  // An entry naming a preset past the end.
+  ASSERT_TRUE(writer.Write(path));
+  CorruptIndex(path, 1, [](uint32_t i) { return i == 0; });
+  EXPECT_FALSE(PresetBank::Open(path));
+}
+
+template <typename T>
+void AppendLittleEndian(std::string *stream, T value) {
+  for (size_t i = 0; i < sizeof(T); i++)
+    stream->push_back(static_cast<char>(value >> (8 * i)));
+}
+
+// The start of a patch record stream: its header, and layout if given.
+std::string RecordHeader(uint16_t num_generators,
+                         const std::vector<uint32_t> &generator_params,
+                         const std::vector<uint32_t> &global_params) {
+  std::string stream;
+  AppendLittleEndian(&stream, kPatchRecordMagic);
+  AppendLittleEndian(&stream, kPatchRecordVersion);
+  AppendLittleEndian(&stream, num_generators);
+  AppendLittleEndian(&stream, uint16_t(generator_params.size()));
+  AppendLittleEndian(&stream, uint16_t(global_params.size()));
+  for (uint32_t param_id : generator_params)
+    AppendLittleEndian(&stream, param_id);
+  for (uint32_t param_id : global_params) AppendLittleEndian(&stream, param_id);
+  return stream;
+}
+
+// As saved by a later build, with more generators, and a parameter this one
+// doesn't have: the first kNumGenerators load, and the parameter is skipped.
+TEST(PatchRecordTest, LoadsLargerRecords) {
+  const auto expected = MakePatch(kNumGenerators, 0.75);
+  const auto values = Record(*expected);
+  const auto &layout = PatchLayout::Current();
+  const size_t stride = layout.generator_params.size();
+  constexpr int kExtraGenerators = 2;
+
+  std::vector<uint32_t> generator_params = layout.generator_params;
+  generator_params.push_back(TagFor(0, TAG_NUM_TAGS, TARGET_NA));
+  ASSERT_EQ(ParamSlotFor(generator_params.back()), kNoParamSlot);
+  std::string stream = RecordHeader(kNumGenerators + kExtraGenerators,
+                                    generator_params, layout.global_params);
+  for (int g = 0; g < kNumGenerators + kExtraGenerators; g++) {
+    for (size_t i = 0; i <= stride; i++) {
+      const double value =
+          g < kNumGenerators && i < stride ? values[g * stride + i] : 0.5;
+      AppendLittleEndian(&stream, std::bit_cast<uint64_t>(value));
+    }
+  }
+  for (size_t i = 0; i < layout.global_params.size(); i++) {
+    AppendLittleEndian(&stream, std::bit_cast<uint64_t>(
+                                    values[kNumGenerators * stride + i]));
+  }
+
+  MemoryStream memory_stream(stream.data(), stream.size());
+  PatchProcessor patch;
+  ASSERT_EQ(patch.LoadPatch(&memory_stream), kResultOk);
+  EXPECT_EQ(Record(patch), values);
+}
+
+// Headers whose counts no build could have are refused, and ones claiming
+// more generators than the stream holds fail as truncated, before anything is
+// sized by them.
+TEST(PatchRecordTest, RefusesCorruptRecords) {
+  PatchProcessor patch;
+  const auto before = Record(patch);
+
+  std::string insane = RecordHeader(1, {}, {});
+  insane[8] = insane[9] = '\xff';
+  MemoryStream insane_stream(insane.data(), insane.size());
+  EXPECT_NE(patch.LoadPatch(&insane_stream), kResultOk);
+  EXPECT_EQ(Record(patch), before);
+
+  const auto &layout = PatchLayout::Current();
+  std::string truncated = RecordHeader(0xffff, layout.generator_params,
+                                       layout.global_params);
+  MemoryStream truncated_stream(truncated.data(), truncated.size());
+  EXPECT_NE(patch.LoadPatch(&truncated_stream), kResultOk);
+  EXPECT_EQ(Record(patch), before);
+}
+
+}  // namespace
+}  // namespace sidebands
@@ -0,0 +1,410 @@
+// The interposers below replace glibc's own functions, so glibc's inline
+// wrappers for them have to stay out of the way.
+#undef _FORTIFY_SOURCE
+
+#include "realtime_check.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace sidebands {
+
+namespace {
+
+constexpr int kMaxFrames = 48;
+// Distinct stacks kept; calls from any more are counted as dropped.
+constexpr size_t kMaxSites = 1024;
+
+// Where violations were made from, recorded on the audio thread, so in static
+// storage, with nothing allocated. A site is claimed by setting its key, a
+// hash of the call and stack, and then filled in; only once it's ready can
+// calls from the same stack count themselves in it.
+struct Site {
+  std::atomic<uint64_t> key;
+  std::atomic<bool> ready;
+  std::atomic<size_t> count;
+  RealtimeViolationKind kind;
+  const char *function;
+  int depth;
+  void *frames[kMaxFrames];
+};
+
+Site g_sites[kMaxSites];
+std::atomic<size_t> g_num_dropped{0};
+
+// Thread locals in an executable are allocated with the thread, not on first
+// use, so reading them here doesn't allocate.
+thread_local int t_section_depth = 0;
+// Set while recording, so the calls recording makes aren't recorded in turn.
+thread_local bool t_recording = false;
+
+// FNV-1a over the call and its stack, never 0, which marks a free site.
+uint64_t SiteKey(RealtimeViolationKind kind, const char *function,
+                 void *const *frames, int depth) {
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](uint64_t value) {
+    hash ^= value;
+    hash *= 1099511628211ull;
+  };
+  mix(uint64_t(kind));
+  mix(reinterpret_cast<uintptr_t>(function));
+  for (int f = 0; f < depth; f++) mix(reinterpret_cast<uintptr_t>(frames[f]));
+  return hash ? hash : 1;
+}
+
+bool SameSite(const Site &site, RealtimeViolationKind kind,
+              const char *function, void *const *frames, int depth) {
+  return site.kind == kind && site.function == function &&
+         site.depth == depth && std::equal(frames, frames + depth, site.frames);
+}
+
+// Not inlined, so that it's always the first frame of the stack traces it
+// takes, and can be left out of them.
+[[gnu::noinline]] void Check(RealtimeViolationKind kind,
+                             const char *function) {
+  if (!t_section_depth || t_recording) return;
+  t_recording = true;
+  void *frames[kMaxFrames];
+  const int depth = backtrace(frames, kMaxFrames);
+  const uint64_t key = SiteKey(kind, function, frames, depth);
+  bool kept = false;
+  for (size_t probe = 0; probe < kMaxSites && !kept; probe++) {
+    Site &site = g_sites[(key + probe) % kMaxSites];
+    uint64_t site_key = 0;
+    if (site.key.compare_exchange_strong(site_key, key,
+                                         std::memory_order_acq_rel)) {
+      site.kind = kind;
+      site.function = function;
+      site.depth = depth;
+      std::copy(frames, frames + depth, site.frames);
+      site.count.store(1, std::memory_order_relaxed);
+      site.ready.store(true, std::memory_order_release);
+      kept = true;
+    } else if (site_key == key) {
+      // Claimed by another thread for the same stack, most likely; it has
+      // only a handful of stores left to make.
+      while (!site.ready.load(std::memory_order_acquire)) {
+      }
+      if (SameSite(site, kind, function, frames, depth)) {
+        site.count.fetch_add(1, std::memory_order_relaxed);
+        kept = true;
+      }
+    }
+  }
+  if (!kept) g_num_dropped.fetch_add(1, std::memory_order_relaxed);
+  t_recording = false;
+}
+
+// The next definition of `name` along, resolved the first time through.
+template <typename Fn>
+Fn Next(Fn &cached, const char *name) {
+  if (!cached) cached = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+  return cached;
+}
+
+std::string Symbolize(void *frame) {
+  Dl_info info;
+  if (dladdr(frame, &info) && info.dli_sname) {
+    int status;
+    char *demangled =
+        abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = status == 0 ? demangled : info.dli_sname;
+    std::free(demangled);
+    return name;
+  }
+  char address[32];
+  std::snprintf(address, sizeof(address), "%p", frame);
+  return std::string(info.dli_fname ? info.dli_fname : "?") + " " + address;
+}
+
+}  // namespace
+
+const char *RealtimeViolationKindName(RealtimeViolationKind kind) {
+  switch (kind) {
+    case RealtimeViolationKind::ALLOCATION:
+      return "allocation";
+    case RealtimeViolationKind::LOCK:
+      return "lock";
+    case RealtimeViolationKind::BLOCKING:
+      return "blocking call";
+  }
+  return "?";
+}
+
+std::string RealtimeViolation::ToString() const {
+  std::string description = std::to_string(count) + "x " +
+                            RealtimeViolationKindName(kind) + ": " + function +
+                            " from " +
+                            (culprit.empty() ? "outside sidebands" : culprit);
+  for (size_t i = 0; i < stack.size(); i++)
+    description += "\n    #" + std::to_string(i) + " " + stack[i];
+  return description;
+}
+
+RealtimeSection::RealtimeSection() {
+  // The first backtrace loads the unwinder, allocating; get that out of the
+  // way first.
+  static const bool unwinder_loaded = [] {
+    void *frame;
+    return backtrace(&frame, 1) > 0;
+  }();
+  (void)unwinder_loaded;
+  t_section_depth++;
+}
+
+RealtimeSection::~RealtimeSection() { t_section_depth--; }
+
+RealtimeReport TakeRealtimeViolations() {
+  CHECK_EQ(t_section_depth, 0) << "Taking violations inside a section";
+  RealtimeReport report;
+  report.num_dropped = g_num_dropped.exchange(0, std::memory_order_relaxed);
+  for (Site &site : g_sites) {
+    if (!site.ready.load(std::memory_order_acquire)) continue;
+    RealtimeViolation violation{};
+    violation.kind = site.kind;
+    violation.function = site.function;
+    violation.count = site.count.load(std::memory_order_relaxed);
+    for (int f = 1; f < site.depth; f++) {
+      violation.stack.push_back(Symbolize(site.frames[f]));
+      if (violation.culprit.empty() &&
+          violation.stack.back().find("sidebands::") != std::string::npos)
+        violation.culprit = violation.stack.back();
+    }
+    report.violations.push_back(std::move(violation));
+    site.ready.store(false, std::memory_order_relaxed);
+    site.key.store(0, std::memory_order_release);
+  }
+  return report;
+}
+
+}  // namespace sidebands
+
+using sidebands::Check;
+using sidebands::Next;
+using sidebands::RealtimeViolationKind;
+
+// The next definitions along of the functions interposed, as next_<name>.
+#define NEXT_DECLARE(name) decltype(&::name) next_##name = nullptr
+#define NEXT(name) Next(next_##name, #name)
+
+namespace {
+
+NEXT_DECLARE(pthread_mutex_lock);
+NEXT_DECLARE(pthread_mutex_timedlock);
+NEXT_DECLARE(pthread_rwlock_rdlock);
+NEXT_DECLARE(pthread_rwlock_wrlock);
+NEXT_DECLARE(pthread_cond_wait);
+NEXT_DECLARE(pthread_cond_timedwait);
+NEXT_DECLARE(sem_wait);
+NEXT_DECLARE(nanosleep);
+NEXT_DECLARE(clock_nanosleep);
+NEXT_DECLARE(usleep);
+NEXT_DECLARE(read);
+NEXT_DECLARE(write);
+NEXT_DECLARE(fwrite);
+NEXT_DECLARE(fflush);
+NEXT_DECLARE(open);
+NEXT_DECLARE(openat);
+NEXT_DECLARE(syscall);
+
+// Resolved up front, since dlsym allocates, and would be caught doing it on
+// the audio thread the first time through. Anything called before this runs
+// resolves itself.
+[[gnu::constructor]] void ResolveInterposed() {
+  NEXT(pthread_mutex_lock);
+  NEXT(pthread_mutex_timedlock);
+  NEXT(pthread_rwlock_rdlock);
+  NEXT(pthread_rwlock_wrlock);
+  NEXT(pthread_cond_wait);
+  NEXT(pthread_cond_timedwait);
+  NEXT(sem_wait);
+  NEXT(nanosleep);
+  NEXT(clock_nanosleep);
+  NEXT(usleep);
+  NEXT(read);
+  NEXT(write);
+  NEXT(fwrite);
+  NEXT(fflush);
+  NEXT(open);
+  NEXT(openat);
+  NEXT(syscall);
+}
+
+}  // namespace
+
+// The interposers. glibc's allocator is reached through its __libc_ entry
+// points, since looking it up with dlsym can itself allocate.
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+  Check(RealtimeViolationKind::ALLOCATION, "malloc");
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  Check(RealtimeViolationKind::ALLOCATION, "calloc");
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  Check(RealtimeViolationKind::ALLOCATION, "realloc");
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+  if (ptr) Check(RealtimeViolationKind::ALLOCATION, "free");
+  __libc_free(ptr);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+  Check(RealtimeViolationKind::ALLOCATION, "posix_memalign");
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  Check(RealtimeViolationKind::ALLOCATION, "aligned_alloc");
+  return __libc_memalign(alignment, size);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+  Check(RealtimeViolationKind::LOCK, "pthread_mutex_lock");
+  return NEXT(pthread_mutex_lock)(mutex);
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t *mutex,
+                            const struct timespec *abstime) {
+  Check(RealtimeViolationKind::LOCK, "pthread_mutex_timedlock");
+  return NEXT(pthread_mutex_timedlock)(mutex, abstime);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock) {
+  Check(RealtimeViolationKind::LOCK, "pthread_rwlock_rdlock");
+  return NEXT(pthread_rwlock_rdlock)(rwlock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock) {
+  Check(RealtimeViolationKind::LOCK, "pthread_rwlock_wrlock");
+  return NEXT(pthread_rwlock_wrlock)(rwlock);
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+  Check(RealtimeViolationKind::BLOCKING, "pthread_cond_wait");
+  return NEXT(pthread_cond_wait)(cond, mutex);
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime) {
+  Check(RealtimeViolationKind::BLOCKING, "pthread_cond_timedwait");
+  return NEXT(pthread_cond_timedwait)(cond, mutex, abstime);
+}
+
+int sem_wait(sem_t *sem) {
+  Check(RealtimeViolationKind::BLOCKING, "sem_wait");
+  return NEXT(sem_wait)(sem);
+}
+
+int nanosleep(const struct timespec *duration, struct timespec *remaining) {
+  Check(RealtimeViolationKind::BLOCKING, "nanosleep");
+  return NEXT(nanosleep)(duration, remaining);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec *request,
+                    struct timespec *remaining) {
+  Check(RealtimeViolationKind::BLOCKING, "clock_nanosleep");
+  return NEXT(clock_nanosleep)(clock, flags, request, remaining);
+}
+
+int usleep(useconds_t usec) {
+  Check(RealtimeViolationKind::BLOCKING, "usleep");
+  return NEXT(usleep)(usec);
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+  Check(RealtimeViolationKind::BLOCKING, "read");
+  return NEXT(read)(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count) {
+  Check(RealtimeViolationKind::BLOCKING, "write");
+  return NEXT(write)(fd, buf, count);
+}
+
+int open(const char *path, int flags, ...) {
+  mode_t mode = 0;
+  if (flags & (O_CREAT | O_TMPFILE)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  Check(RealtimeViolationKind::BLOCKING, "open");
+  return NEXT(open)(path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...) {
+  mode_t mode = 0;
+  if (flags & (O_CREAT | O_TMPFILE)) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  Check(RealtimeViolationKind::BLOCKING, "openat");
+  return NEXT(openat)(dirfd, path, flags, mode);
+}
+
+// glibc's stdio writes reach the kernel without going through write(), so
+// they're checked here; this is what catches logging.
+size_t fwrite(const void *ptr, size_t size, size_t count, FILE *stream) {
+  Check(RealtimeViolationKind::BLOCKING, "fwrite");
+  return NEXT(fwrite)(ptr, size, count, stream);
+}
+
+int fflush(FILE *stream) {
+  Check(RealtimeViolationKind::BLOCKING, "fflush");
+  return NEXT(fflush)(stream);
+}
+
+// libstdc++ waits on futexes through syscall(), for std::atomic::wait among
+// others. Only waits are violations; wakes don't block.
+long syscall(long number, ...) {
+  va_list args;
+  va_start(args, number);
+  long a[6];
+  for (long &arg : a) arg = va_arg(args, long);
+  va_end(args);
+  if (number == SYS_futex) {
+    const long op = a[1] & FUTEX_CMD_MASK;
+    if (op == FUTEX_WAIT || op == FUTEX_WAIT_BITSET || op == FUTEX_LOCK_PI)
+      Check(RealtimeViolationKind::BLOCKING, "futex wait");
+  }
+  return NEXT(syscall)(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+}  // extern "C"
+
+#undef NEXT
+#undef NEXT_DECLARE
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sidebands {
+
+// Checks for calls that have no place on the audio thread: allocation,
+// locking and blocking calls. Linking realtime_check.cc into a binary
+// interposes them, for glibc on Linux:
+//   allocation: malloc, calloc, realloc, free, posix_memalign, aligned_alloc
+//     (and so operator new and delete)
+//   locking: pthread mutex and rwlock locks; trylocks don't block, so pass
+//   blocking: condition variable and semaphore waits, futex waits (and so
+//     std::atomic::wait), sleeps, file I/O and stdio writes (and so logging)
+// Calls made by a thread inside a RealtimeSection are recorded, with a stack
+// trace, as violations; calls from anywhere else go straight through. Each
+// distinct stack is kept once, with a count of the calls made from it, so
+// however many times a call repeats it takes no more room.
+enum class RealtimeViolationKind { ALLOCATION, LOCK, BLOCKING };
+
+const char *RealtimeViolationKindName(RealtimeViolationKind kind);
+
+struct RealtimeViolation {
+  RealtimeViolationKind kind;
+  // The interposed call, e.g. "malloc".
+  std::string function;
+  // Symbolized frames, innermost first. Only exported functions have names,
+  // so binaries checked should be linked with their symbols exported.
+  std::vector<std::string> stack;
+  // The innermost frame in sidebands code, or empty if there's none: where
+  // the fix goes.
+  std::string culprit;
+  // How many times the call was made from this stack.
+  size_t count = 0;
+
+  std::string ToString() const;
+};
+
+struct RealtimeReport {
+  std::vector<RealtimeViolation> violations;
+  // Calls made from more distinct stacks than are kept. They can't be told
+  // apart from new violations, so any at all should fail a check.
+  size_t num_dropped = 0;
+};
+
+// While one is alive, the calling thread is treated as the audio thread.
+// Sections nest.
+class RealtimeSection {
+ public:
+  RealtimeSection();
+  ~RealtimeSection();
+
+  RealtimeSection(const RealtimeSection &) = delete;
+  RealtimeSection &operator=(const RealtimeSection &) = delete;
+};
+
+// Violations recorded since the last call, which are then forgotten. Not to be
+// called from inside a RealtimeSection.
+RealtimeReport TakeRealtimeViolations();
+
+}  // namespace sidebands
@@ -0,0 +1,311 @@
+// Renders through SidebandsProcessor::process with the realtime checker
+// watching, in each voice layout with baked wavetables off and on, and fails on
+// any allocation, lock or blocking call it makes once notes are sounding,
+// beyond the ones already known about. Checked blocks vary in size, and carry
+// notes and automation.
+
+#include <gtest/gtest.h>
+#include <pluginterfaces/vst/ivstevents.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "constants.h"
+#include "host/processor_host.h"
+#include "processor/patch_processor.h"
+#include "processor/patch_record.h"
+#include "processor/synthesis/render_program.h"
+#include "processor/util/param_store.h"
+#include "public.sdk/source/common/memorystream.h"
+#include "realtime_check.h"
+#include "tags.h"
+
+using namespace Steinberg;
+
+namespace sidebands {
+
+// Called from inside sections by the checker's own tests; in the sidebands
+// namespace, and not inlined, so that they're what violations are pinned on.
+[[gnu::noinline]] void *CheckedAllocate() { return std::malloc(64); }
+[[gnu::noinline]] void CheckedLock(std::mutex &mutex) {
+  std::lock_guard<std::mutex> lock(mutex);
+}
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int32 kMaxBlockSize = 1024;
+// Notes held while checking: a chord, spread over the keyboard.
+constexpr int16 kChord[]{36, 48, 55, 60, 64, 67, 71, 76};
+// Rendered before checking, so that the notes are past their attacks and
+// anything allocated once, on first use, has been.
+constexpr double kWarmupSeconds = 1.0;
+constexpr int kCheckedBlocks = 200;
+// Sizes the checked blocks cycle through: a single sample, odd sizes, and
+// ones that take more than one of the player's slices.
+constexpr int32 kCheckedBlockSizes[]{kMaxBlockSize, 1, 37, 512, 513,
+                                     256,           900, 64};
+// Every this many checked blocks, one note of the chord is struck again.
+constexpr int kRestrikeInterval = 10;
+// Every this many, a waveform parameter moves, making any baked wavetables
+// stale until they're baked again.
+constexpr int kWaveformInterval = 50;
+
+// Violations already on the render path, each by the exact call made and the
+// innermost sidebands function making it, as reported. An entry should go once
+// it's fixed; from then on this test keeps it fixed.
+struct KnownViolation {
+  RealtimeViolationKind kind;
+  const char *function;
+  const char *culprit;
+};
+constexpr KnownViolation kKnownViolations[]{
+    // The player's lock on its voices, shared with note and patch changes.
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Player::Perform(unsigned long)"},
+    // Each voice's lock on its generators.
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Voice::Playing() const"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Voice::PerformGenerators(double, sidebands::RenderProgram "
+     "const&, std::bitset<32ul>, bool, sidebands::GeneratorScratch&, double*, "
+     "unsigned long)"},
+    // Voice lanes only.
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Voice::GeneratorActive(int) const"},
+    // Each envelope's lock on its stages, shared with note on and off. Per
+    // voice it renders whole slices; in lanes, a segment at a time.
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::EnvelopeGenerator::Amplitudes(double, double*, unsigned "
+     "long, double, sidebands::GeneratorPatch::ModParams const*)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::EnvelopeGenerator::CurrentSegment() const"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::EnvelopeGenerator::CommitSegment(double, long)"},
+    // Notes struck and released take the same locks: the player's, each
+    // voice's and each envelope's.
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Player::NoteOn(int, double, short)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Player::NoteOff(int, short)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Voice::NoteOn(double, sidebands::RenderProgram const&, int, "
+     "long, double, short)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Voice::NoteRelease(double, sidebands::RenderProgram const&, "
+     "short)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::EnvelopeGenerator::On(double, "
+     "sidebands::GeneratorPatch::ModParams const*)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::EnvelopeGenerator::Release(double, "
+     "sidebands::GeneratorPatch::ModParams const*)"},
+    // Generator and envelope events, whose signals lock their lists of slots
+    // to emit. Envelopes emit at each stage change: per voice from SetStage,
+    // in lanes from Step.
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Generator::NoteOn(double, sidebands::GeneratorProgram "
+     "const&, long, double, unsigned char)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::Generator::NoteRelease(double, sidebands::GeneratorProgram "
+     "const&, unsigned char)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::EnvelopeGenerator::SetStage(long)"},
+    {RealtimeViolationKind::LOCK, "pthread_mutex_lock",
+     "sidebands::EnvelopeGenerator::Step()"},
+};
+
+bool Known(const RealtimeViolation &violation) {
+  for (const auto &known : kKnownViolations) {
+    if (known.kind == violation.kind && violation.function == known.function &&
+        violation.culprit == known.culprit)
+      return true;
+  }
+  return false;
+}
+
+// A default patch, with the given voice layout and baked wavetables on or off.
+// With them on, the modulations that change the waveform are dropped, as they
+// keep a generator from being baked.
+std::unique_ptr<PatchProcessor> MakePatch(VoiceLayout layout,
+                                          bool baked_wavetables) {
+  auto patch = std::make_unique<PatchProcessor>();
+  const PatchLayout &record_layout = PatchLayout::Current();
+  std::vector<double> values(record_layout.RecordSize(kNumGenerators));
+  patch->SaveRecord(values.data());
+  if (baked_wavetables) {
+    const size_t stride = record_layout.generator_params.size();
+    for (int g = 0; g < kNumGenerators; g++) {
+      for (TargetTag target :
+           {TARGET_C, TARGET_M, TARGET_K, TARGET_R, TARGET_S})
+        values[g * stride + ParamSlotFor(TAG_MODULATIONS, target)] = 0;
+    }
+  }
+  double *globals = values.data() + record_layout.RecordSize(kNumGenerators) -
+                    record_layout.global_params.size();
+  for (size_t i = 0; i < record_layout.global_params.size(); i++) {
+    switch (ParamFor(record_layout.global_params[i])) {
+      case TAG_VOICE_LAYOUT:
+        globals[i] = double(layout) / (kNumVoiceLayouts - 1);
+        break;
+      case TAG_BAKED_WAVETABLES:
+        globals[i] = baked_wavetables;
+        break;
+      default:
+        break;
+    }
+  }
+  patch->LoadRecord(PatchLayoutMap(record_layout), kNumGenerators,
+                    values.data());
+  return patch;
+}
+
+// Whether every generator the patch has on plays a baked wavetable.
+bool AllBaked(PatchProcessor *patch) {
+  RenderProgramCompiler compiler(patch);
+  const RenderProgram &program = compiler.Acquire();
+  if (!program.num_generators) return false;
+  for (size_t g = 0; g < program.num_generators; g++) {
+    if (!WavetableCurrent(program.generators[g])) return false;
+  }
+  return true;
+}
+
+Vst::Event NoteEvent(bool on, int16 pitch, int32 sample_offset) {
+  Vst::Event event{};
+  event.sampleOffset = sample_offset;
+  if (on) {
+    event.type = Vst::Event::kNoteOnEvent;
+    event.noteOn.pitch = pitch;
+    event.noteOn.velocity = 0.8f;
+    event.noteOn.noteId = pitch;
+  } else {
+    event.type = Vst::Event::kNoteOffEvent;
+    event.noteOff.pitch = pitch;
+    event.noteOff.noteId = pitch;
+  }
+  return event;
+}
+
+// However many times a call is made, it's kept once for each stack it's made
+// from, so a call repeated past any fixed number of records is still seen.
+TEST(RealtimeCheckTest, CountsRepeatedCalls) {
+  constexpr size_t kCalls = 5000;
+  std::mutex mutex;
+  TakeRealtimeViolations();
+  {
+    RealtimeSection section;
+    for (size_t i = 0; i < kCalls; i++) std::free(CheckedAllocate());
+    CheckedLock(mutex);
+  }
+  const RealtimeReport report = TakeRealtimeViolations();
+
+  EXPECT_EQ(report.num_dropped, 0u);
+  size_t allocations = 0, locks = 0;
+  for (const auto &violation : report.violations) {
+    if (violation.culprit == "sidebands::CheckedAllocate()" &&
+        violation.function == "malloc")
+      allocations += violation.count;
+    if (violation.culprit == "sidebands::CheckedLock(std::mutex&)" &&
+        violation.function == "pthread_mutex_lock")
+      locks += violation.count;
+  }
+  EXPECT_EQ(allocations, kCalls);
+  EXPECT_EQ(locks, 1u);
+}
+
+// Each voice layout, with baked wavetables off and on.
+class RealtimeSafetyTest
+    : public ::testing::TestWithParam<std::tuple<VoiceLayout, bool>> {};
+
+TEST_P(RealtimeSafetyTest, Render) {
+  const auto [layout, baked_wavetables] = GetParam();
+  const auto patch = MakePatch(layout, baked_wavetables);
+  if (baked_wavetables)
+    ASSERT_TRUE(AllBaked(patch.get())) << "Patch doesn't bake wavetables";
+
+  ProcessorHost host(Vst::kRealtime, kSampleRate, kMaxBlockSize);
+  host.Instantiate();
+  ASSERT_EQ(host.Initialize(), kResultOk);
+  // Loaded before activation, which builds the player for the layout.
+  MemoryStream patch_stream;
+  patch->SavePatch(&patch_stream);
+  patch_stream.seek(0, IBStream::kIBSeekSet, nullptr);
+  ASSERT_EQ(host.processor()->setState(&patch_stream), kResultOk);
+  ASSERT_EQ(host.SetupProcessing(), kResultOk);
+  host.Activate();
+
+  for (int16 pitch : kChord) host.AddEvent(NoteEvent(true, pitch, 0));
+  for (int i = 0; i < kWarmupSeconds * kSampleRate / kMaxBlockSize; i++)
+    host.Process();
+
+  // Each checked block has generator 0's amplitude ramping through it, and
+  // now and then a note struck again or a waveform parameter moved, so that
+  // note and parameter handling are checked along with rendering.
+  const Vst::ParamID amplitude = TagFor(0, TAG_OSC, TARGET_A);
+  const Vst::ParamID waveform = TagFor(0, TAG_OSC, TARGET_K);
+  TakeRealtimeViolations();
+  for (int i = 0; i < kCheckedBlocks; i++) {
+    const int32 frames =
+        kCheckedBlockSizes[i % std::size(kCheckedBlockSizes)];
+    host.AddParameterChange(amplitude, 0, 0.5 + 0.25 * (i % 2));
+    host.AddParameterChange(amplitude, frames - 1, 0.5 + 0.25 * !(i % 2));
+    if (i % kRestrikeInterval == 0) {
+      const int16 pitch =
+          kChord[(i / kRestrikeInterval) % std::size(kChord)];
+      host.AddEvent(NoteEvent(false, pitch, 0));
+      host.AddEvent(NoteEvent(true, pitch, frames / 2));
+    }
+    if (i % kWaveformInterval == kWaveformInterval / 2)
+      host.AddParameterChange(waveform, frames / 2, 0.2);
+    RealtimeSection section;
+    host.Process(frames);
+  }
+  const RealtimeReport report = TakeRealtimeViolations();
+
+  EXPECT_EQ(report.num_dropped, 0u)
+      << "Violations from more call stacks than the checker keeps";
+  // The same call is made from many stacks, so each is reported once, with
+  // the calls from all of them counted.
+  std::map<std::tuple<RealtimeViolationKind, std::string, std::string>,
+           std::pair<const RealtimeViolation *, size_t>>
+      unknown;
+  for (const auto &violation : report.violations) {
+    if (Known(violation)) continue;
+    auto &entry = unknown[{violation.kind, violation.function,
+                           violation.culprit}];
+    if (!entry.first) entry.first = &violation;
+    entry.second += violation.count;
+  }
+  for (const auto &[key, entry] : unknown) {
+    ADD_FAILURE() << entry.second << " calls, first from: "
+                  << entry.first->ToString();
+  }
+}
+
+std::string ParamName(
+    const ::testing::TestParamInfo<RealtimeSafetyTest::ParamType> &info) {
+  static const char *const kLayoutNames[kNumVoiceLayouts]{
+      "PerVoice", "VoiceLanes", "GeneratorLanes"};
+  return std::string(kLayoutNames[int(std::get<0>(info.param))]) +
+         (std::get<1>(info.param) ? "Baked" : "Synthesised");
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Layouts, RealtimeSafetyTest,
+    ::testing::Combine(::testing::Values(VoiceLayout::PER_VOICE,
+                                         VoiceLayout::VOICE_LANES,
+                                         VoiceLayout::GENERATOR_LANES),
+                       ::testing::Bool()),
+    ParamName);
+
+}  // namespace
+}  // namespace sidebands
@@ -0,0 +1,158 @@
+#include "host/processor_host.h"
+
+#include <algorithm>
+
+using namespace Steinberg;
+
+namespace sidebands {
+
+int32 PLUGIN_API BlockEvents::getEventCount() { return events_.size(); }
+
+tresult PLUGIN_API BlockEvents::getEvent(int32 index, Vst::Event &e) {
+  if (index < 0 || index >= int32(events_.size())) return kInvalidArgument;
+  e = events_[index];
+  return kResultOk;
+}
+
+tresult PLUGIN_API BlockEvents::addEvent(Vst::Event &e) {
+  events_.push_back(e);
+  return kResultOk;
+}
+
+tresult PLUGIN_API BlockEvents::queryInterface(const TUID _iid, void **obj) {
+  QUERY_INTERFACE(_iid, obj, FUnknown::iid, Vst::IEventList)
+  QUERY_INTERFACE(_iid, obj, Vst::IEventList::iid, Vst::IEventList)
+  *obj = nullptr;
+  return kNoInterface;
+}
+
+int32 PLUGIN_API BlockParameterQueue::getPointCount() {
+  return points_.size();
+}
+
+tresult PLUGIN_API BlockParameterQueue::getPoint(int32 index,
+                                                 int32 &sample_offset,
+                                                 Vst::ParamValue &value) {
+  if (index < 0 || index >= int32(points_.size())) return kInvalidArgument;
+  sample_offset = points_[index].first;
+  value = points_[index].second;
+  return kResultOk;
+}
+
+tresult PLUGIN_API BlockParameterQueue::addPoint(int32 sample_offset,
+                                                 Vst::ParamValue value,
+                                                 int32 &index) {
+  index = points_.size();
+  points_.emplace_back(sample_offset, value);
+  return kResultOk;
+}
+
+tresult PLUGIN_API BlockParameterQueue::queryInterface(const TUID _iid,
+                                                       void **obj) {
+  QUERY_INTERFACE(_iid, obj, FUnknown::iid, Vst::IParamValueQueue)
+  QUERY_INTERFACE(_iid, obj, Vst::IParamValueQueue::iid, Vst::IParamValueQueue)
+  *obj = nullptr;
+  return kNoInterface;
+}
+
+Vst::IParamValueQueue *PLUGIN_API
+BlockParameterChanges::getParameterData(int32 index) {
+  if (index < 0 || index >= num_queues_) return nullptr;
+  return queues_[index].get();
+}
+
+Vst::IParamValueQueue *PLUGIN_API BlockParameterChanges::addParameterData(
+    const Vst::ParamID &id, int32 &index) {
+  for (index = 0; index < num_queues_; index++) {
+    if (queues_[index]->getParameterId() == id) return queues_[index].get();
+  }
+  if (num_queues_ == int32(queues_.size()))
+    queues_.push_back(std::make_unique<BlockParameterQueue>());
+  BlockParameterQueue *queue = queues_[num_queues_++].get();
+  queue->Reset(id);
+  return queue;
+}
+
+tresult PLUGIN_API BlockParameterChanges::queryInterface(const TUID _iid,
+                                                         void **obj) {
+  QUERY_INTERFACE(_iid, obj, FUnknown::iid, Vst::IParameterChanges)
+  QUERY_INTERFACE(_iid, obj, Vst::IParameterChanges::iid,
+                  Vst::IParameterChanges)
+  *obj = nullptr;
+  return kNoInterface;
+}
+
+ProcessorHost::ProcessorHost(Vst::ProcessModes mode, double sample_rate,
+                             int32 block_size)
+    : mode_(mode), sample_rate_(sample_rate), block_size_(block_size) {
+  for (int c = 0; c < kNumChannels; c++) {
+    buffers_[c].resize(block_size);
+    channels_[c] = buffers_[c].data();
+  }
+  output_.numChannels = kNumChannels;
+  output_.channelBuffers32 = channels_;
+  data_.processMode = mode;
+  data_.symbolicSampleSize = Vst::kSample32;
+  data_.numOutputs = 1;
+  data_.outputs = &output_;
+  data_.inputEvents = &events_;
+  data_.inputParameterChanges = &parameter_changes_;
+}
+
+ProcessorHost::~ProcessorHost() {
+  if (!processor_) return;
+  if (active_) {
+    processor_->setProcessing(false);
+    processor_->setActive(false);
+  }
+  if (initialized_) processor_->terminate();
+  processor_->release();
+}
+
+void ProcessorHost::Instantiate() {
+  processor_ = static_cast<SidebandsProcessor *>(
+      static_cast<Vst::IAudioProcessor *>(
+          SidebandsProcessor::Instantiate(nullptr)));
+}
+
+tresult ProcessorHost::Initialize() {
+  const tresult result = processor_->initialize(nullptr);
+  initialized_ = result == kResultOk;
+  return result;
+}
+
+tresult ProcessorHost::SetupProcessing() {
+  Vst::ProcessSetup setup{mode_, Vst::kSample32, block_size_, sample_rate_};
+  return processor_->setupProcessing(setup);
+}
+
+void ProcessorHost::Activate() {
+  processor_->setActive(true);
+  processor_->setProcessing(true);
+  active_ = true;
+}
+
+bool ProcessorHost::Start() {
+  Instantiate();
+  if (Initialize() != kResultOk || SetupProcessing() != kResultOk)
+    return false;
+  Activate();
+  return true;
+}
+
+void ProcessorHost::AddParameterChange(Vst::ParamID id, int32 sample_offset,
+                                       Vst::ParamValue value) {
+  int32 index;
+  parameter_changes_.addParameterData(id, index)
+      ->addPoint(sample_offset, value, index);
+}
+
+tresult ProcessorHost::Process(int32 frames) {
+  data_.numSamples = std::min(frames, block_size_);
+  const tresult result = processor_->process(data_);
+  events_.clear();
+  parameter_changes_.clear();
+  return result;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <pluginterfaces/vst/ivstaudioprocessor.h>
+#include <pluginterfaces/vst/ivstevents.h>
+#include <pluginterfaces/vst/ivstparameterchanges.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "processor/sidebands_processor.h"
+
+namespace sidebands {
+
+// The note events of one block, handed to process().
+class BlockEvents : public Steinberg::Vst::IEventList {
+ public:
+  void clear() { events_.clear(); }
+
+  Steinberg::int32 PLUGIN_API getEventCount() override;
+  Steinberg::tresult PLUGIN_API getEvent(Steinberg::int32 index,
+                                         Steinberg::Vst::Event &e) override;
+  Steinberg::tresult PLUGIN_API addEvent(Steinberg::Vst::Event &e) override;
+
+  // Owned by the ProcessorHost, so isn't reference counted.
+  Steinberg::tresult PLUGIN_API queryInterface(const Steinberg::TUID _iid,
+                                               void **obj) override;
+  Steinberg::uint32 PLUGIN_API addRef() override { return 1; }
+  Steinberg::uint32 PLUGIN_API release() override { return 1; }
+
+ private:
+  std::vector<Steinberg::Vst::Event> events_;
+};
+
+// One parameter's changes within a block, at sample offsets in order.
+class BlockParameterQueue : public Steinberg::Vst::IParamValueQueue {
+ public:
+  void Reset(Steinberg::Vst::ParamID id) {
+    id_ = id;
+    points_.clear();
+  }
+
+  Steinberg::Vst::ParamID PLUGIN_API getParameterId() override { return id_; }
+  Steinberg::int32 PLUGIN_API getPointCount() override;
+  Steinberg::tresult PLUGIN_API getPoint(Steinberg::int32 index,
+                                         Steinberg::int32 &sample_offset,
+                                         Steinberg::Vst::ParamValue &value)
+      override;
+  Steinberg::tresult PLUGIN_API addPoint(Steinberg::int32 sample_offset,
+                                         Steinberg::Vst::ParamValue value,
+                                         Steinberg::int32 &index) override;
+
+  // Owned by the BlockParameterChanges, so isn't reference counted.
+  Steinberg::tresult PLUGIN_API queryInterface(const Steinberg::TUID _iid,
+                                               void **obj) override;
+  Steinberg::uint32 PLUGIN_API addRef() override { return 1; }
+  Steinberg::uint32 PLUGIN_API release() override { return 1; }
+
+ private:
+  Steinberg::Vst::ParamID id_ = 0;
+  std::vector<std::pair<Steinberg::int32, Steinberg::Vst::ParamValue>> points_;
+};
+
+// The parameter changes of one block, handed to process(). Queues are kept
+// for reuse when cleared, so that clearing between blocks frees nothing.
+class BlockParameterChanges : public Steinberg::Vst::IParameterChanges {
+ public:
+  void clear() { num_queues_ = 0; }
+
+  Steinberg::int32 PLUGIN_API getParameterCount() override {
+    return num_queues_;
+  }
+  Steinberg::Vst::IParamValueQueue *PLUGIN_API getParameterData(
+      Steinberg::int32 index) override;
+  Steinberg::Vst::IParamValueQueue *PLUGIN_API addParameterData(
+      const Steinberg::Vst::ParamID &id, Steinberg::int32 &index) override;
+
+  // Owned by the ProcessorHost, so isn't reference counted.
+  Steinberg::tresult PLUGIN_API queryInterface(const Steinberg::TUID _iid,
+                                               void **obj) override;
+  Steinberg::uint32 PLUGIN_API addRef() override { return 1; }
+  Steinberg::uint32 PLUGIN_API release() override { return 1; }
+
+ private:
+  // Held by pointer, so the queues handed out stay put as more are added.
+  std::vector<std::unique_ptr<BlockParameterQueue>> queues_;
+  Steinberg::int32 num_queues_ = 0;
+};
+
+// Drives a SidebandsProcessor the way a host does, for the tools, tests and
+// benchmarks that run it outside of one: brings it up a stage at a time,
+// renders blocks of stereo output with the events added for them, and takes
+// it down again, as far as it got, when destroyed.
+class ProcessorHost {
+ public:
+  ProcessorHost(Steinberg::Vst::ProcessModes mode, double sample_rate,
+                Steinberg::int32 block_size);
+  ~ProcessorHost();
+
+  ProcessorHost(const ProcessorHost &) = delete;
+  ProcessorHost &operator=(const ProcessorHost &) = delete;
+
+  // The stages of bringing the processor up, in the order a host calls them,
+  // each timeable on its own. State is loaded between Initialize and
+  // SetupProcessing, so the player is built for the patch's polyphony.
+  void Instantiate();
+  Steinberg::tresult Initialize();
+  Steinberg::tresult SetupProcessing();
+  // Activates the processor and starts processing.
+  void Activate();
+  // All of them, for callers with nothing to do in between.
+  bool Start();
+
+  SidebandsProcessor *processor() const { return processor_; }
+
+  // Events for the next block, at sample offsets within it.
+  void AddEvent(Steinberg::Vst::Event event) { events_.addEvent(event); }
+  // A change of `id` to `value` at `sample_offset` in the next block. Changes
+  // to the same parameter are added in the order they fall.
+  void AddParameterChange(Steinberg::Vst::ParamID id,
+                          Steinberg::int32 sample_offset,
+                          Steinberg::Vst::ParamValue value);
+  // Render `frames`, up to the block size, with the events and parameter
+  // changes added since the last block, which are then cleared.
+  Steinberg::tresult Process(Steinberg::int32 frames);
+  Steinberg::tresult Process() { return Process(block_size_); }
+  // Each channel of the last block rendered.
+  Steinberg::Vst::Sample32 *const *channels() const { return channels_; }
+
+ private:
+  static constexpr int kNumChannels = 2;
+
+  const Steinberg::Vst::ProcessModes mode_;
+  const double sample_rate_;
+  const Steinberg::int32 block_size_;
+
+  SidebandsProcessor *processor_ = nullptr;
+  bool initialized_ = false;
+  bool active_ = false;
+
+  std::vector<Steinberg::Vst::Sample32> buffers_[kNumChannels];
+  Steinberg::Vst::Sample32 *channels_[kNumChannels];
+  Steinberg::Vst::AudioBusBuffers output_{};
+  BlockEvents events_;
+  BlockParameterChanges parameter_changes_;
+  Steinberg::Vst::ProcessData data_{};
+};
+
+}  // namespace sidebands
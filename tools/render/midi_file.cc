@@ -0,0 +1,223 @@
+#include "midi_file.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace sidebands {
+
+namespace {
+
+// Tempo until the file says otherwise: 120 bpm.
+constexpr uint32_t kDefaultMicrosPerQuarter = 500000;
+
+// Big-endian reads from a chunk of the file, which stop at its end.
+class Reader {
+ public:
+  Reader(const uint8_t *begin, const uint8_t *end) : pos_(begin), end_(end) {}
+
+  bool ok() const { return ok_; }
+  bool at_end() const { return pos_ >= end_; }
+  const uint8_t *pos() const { return pos_; }
+
+  uint32_t U8() { return Need(1) ? *pos_++ : 0; }
+  uint32_t U16() { return U8() << 8 | U8(); }
+  uint32_t U24() { return U16() << 8 | U8(); }
+  uint32_t U32() { return U16() << 16 | U16(); }
+  // Variable-length quantity: 7 bits a byte, most significant first.
+  uint32_t VarLen() {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+      const uint32_t byte = U8();
+      value = value << 7 | (byte & 0x7f);
+      if (!(byte & 0x80)) return value;
+    }
+    ok_ = false;
+    return 0;
+  }
+  void Skip(size_t bytes) {
+    if (Need(bytes)) pos_ += bytes;
+  }
+
+ private:
+  bool Need(size_t bytes) {
+    if (ok_ && size_t(end_ - pos_) >= bytes) return true;
+    ok_ = false;
+    return false;
+  }
+
+  const uint8_t *pos_;
+  const uint8_t *end_;
+  bool ok_ = true;
+};
+
+// An event of interest at a tick position, before the tempo map is applied.
+struct TickEvent {
+  enum class Type { NOTE, TEMPO, END_OF_TRACK };
+  uint64_t tick;
+  Type type;
+  MidiNoteEvent note;
+  uint32_t micros_per_quarter;
+};
+
+// Append the events of one track chunk to `events`.
+bool ReadTrack(Reader &track, std::vector<TickEvent> *events) {
+  uint64_t tick = 0;
+  uint32_t running_status = 0;
+  while (!track.at_end() && track.ok()) {
+    tick += track.VarLen();
+    uint32_t status = track.U8();
+
+    if (status == 0xff) {
+      const uint32_t type = track.U8();
+      const uint32_t length = track.VarLen();
+      if (type == 0x51 && length == 3) {
+        events->push_back({tick, TickEvent::Type::TEMPO, {}, track.U24()});
+      } else if (type == 0x2f) {
+        track.Skip(length);
+        events->push_back({tick, TickEvent::Type::END_OF_TRACK, {}, 0});
+        return track.ok();
+      } else {
+        track.Skip(length);
+      }
+      continue;
+    }
+    if (status == 0xf0 || status == 0xf7) {
+      // System exclusive; cancels running status.
+      track.Skip(track.VarLen());
+      running_status = 0;
+      continue;
+    }
+
+    // Channel messages, possibly with running status, in which case the byte
+    // just read was the first data byte.
+    uint32_t data1;
+    if (status < 0x80) {
+      if (!running_status) {
+        LOG(ERROR) << "MIDI data byte without a status";
+        return false;
+      }
+      data1 = status;
+      status = running_status;
+    } else {
+      running_status = status;
+      data1 = track.U8();
+    }
+    const uint32_t kind = status & 0xf0;
+    const uint32_t data2 = (kind == 0xc0 || kind == 0xd0) ? 0 : track.U8();
+    if (kind == 0x80 || kind == 0x90) {
+      // Note on with velocity 0 is note off.
+      const bool on = kind == 0x90 && data2 != 0;
+      const MidiNoteEvent note{0.0, on, uint8_t(status & 0x0f),
+                               uint8_t(data1 & 0x7f), uint8_t(data2 & 0x7f)};
+      events->push_back({tick, TickEvent::Type::NOTE, note, 0});
+    }
+  }
+  // Tracks should end with an end-of-track event, but mark where this one did.
+  events->push_back({tick, TickEvent::Type::END_OF_TRACK, {}, 0});
+  return track.ok();
+}
+
+}  // namespace
+
+std::unique_ptr<MidiFile> MidiFile::Read(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    LOG(ERROR) << "Unable to open MIDI file: " << path;
+    return nullptr;
+  }
+  const std::vector<uint8_t> data{std::istreambuf_iterator<char>(in),
+                                  std::istreambuf_iterator<char>()};
+  Reader file(data.data(), data.data() + data.size());
+
+  if (file.U32() != 0x4d546864 /* MThd */) {
+    LOG(ERROR) << "Not a MIDI file: " << path;
+    return nullptr;
+  }
+  const uint32_t header_length = file.U32();
+  const uint32_t format = file.U16();
+  const uint32_t num_tracks = file.U16();
+  const uint32_t division = file.U16();
+  file.Skip(header_length - 6);
+  if (!file.ok() || header_length < 6 || division == 0) {
+    LOG(ERROR) << "Bad MIDI file header: " << path;
+    return nullptr;
+  }
+  // Format 2 files hold independent sequences; they're played all at once,
+  // like format 1.
+  if (format > 2) {
+    LOG(ERROR) << "Unsupported MIDI file format " << format << ": " << path;
+    return nullptr;
+  }
+
+  std::vector<TickEvent> events;
+  for (uint32_t t = 0; t < num_tracks && !file.at_end();) {
+    const uint32_t chunk_type = file.U32();
+    const uint32_t chunk_length = file.U32();
+    const uint8_t *chunk = file.pos();
+    file.Skip(chunk_length);
+    if (!file.ok()) {
+      LOG(ERROR) << "Truncated MIDI file: " << path;
+      return nullptr;
+    }
+    // Unknown chunk types are to be skipped.
+    if (chunk_type != 0x4d54726b /* MTrk */) continue;
+    Reader track(chunk, chunk + chunk_length);
+    if (!ReadTrack(track, &events)) {
+      LOG(ERROR) << "Bad MIDI track " << t << ": " << path;
+      return nullptr;
+    }
+    t++;
+  }
+  std::stable_sort(
+      events.begin(), events.end(),
+      [](const TickEvent &a, const TickEvent &b) { return a.tick < b.tick; });
+
+  // Ticks are a fraction of a quarter note, following the tempo map, or with
+  // SMPTE timing, a fixed fraction of a frame.
+  const bool smpte = division & 0x8000;
+  double smpte_seconds_per_tick = 0.0;
+  if (smpte) {
+    const int frames_per_second = -int8_t(division >> 8);
+    const int ticks_per_frame = division & 0xff;
+    // 29 means 29.97 drop-frame.
+    const double fps =
+        frames_per_second == 29 ? 29.97 : double(frames_per_second);
+    if (fps <= 0 || !ticks_per_frame) {
+      LOG(ERROR) << "Bad MIDI SMPTE timing: " << path;
+      return nullptr;
+    }
+    smpte_seconds_per_tick = 1.0 / (fps * ticks_per_frame);
+  }
+  uint32_t micros_per_quarter = kDefaultMicrosPerQuarter;
+  auto seconds_per_tick = [&] {
+    return smpte ? smpte_seconds_per_tick
+                 : micros_per_quarter / 1e6 / division;
+  };
+
+  auto midi = std::make_unique<MidiFile>();
+  uint64_t last_tick = 0;
+  double seconds = 0.0;
+  for (const auto &event : events) {
+    seconds += (event.tick - last_tick) * seconds_per_tick();
+    last_tick = event.tick;
+    switch (event.type) {
+      case TickEvent::Type::NOTE:
+        midi->events.push_back(event.note);
+        midi->events.back().time = seconds;
+        break;
+      case TickEvent::Type::TEMPO:
+        if (event.micros_per_quarter)
+          micros_per_quarter = event.micros_per_quarter;
+        break;
+      case TickEvent::Type::END_OF_TRACK:
+        break;
+    }
+    midi->duration = seconds;
+  }
+  return midi;
+}
+
+}  // namespace sidebands
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sidebands {
+
+// A note on or off, at a time in seconds from the start of the file.
+struct MidiNoteEvent {
+  double time;
+  bool on;
+  uint8_t channel;
+  uint8_t pitch;
+  uint8_t velocity;
+};
+
+// The notes of a Standard MIDI File, merged from all its tracks onto one
+// timeline, with the file's tempo map applied. Everything but notes and tempo
+// changes is skipped.
+struct MidiFile {
+  // Read the file at `path`; null if it can't be read or isn't valid.
+  static std::unique_ptr<MidiFile> Read(const std::string &path);
+
+  // In time order; events at the same time stay in file order.
+  std::vector<MidiNoteEvent> events;
+  // Time of the end of the longest track.
+  double duration = 0.0;
+};
+
+}  // namespace sidebands
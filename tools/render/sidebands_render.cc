@@ -0,0 +1,306 @@
+// Renders Standard MIDI Files through a patch to WAV files, outside of a
+// host. The processor is driven through process(), as a host would, so notes
+// land in the same slices and the output matches what a host renders.
+//
+// By default files render as fast as possible: offline, several at once, one
+// per core. With --realtime they render one at a time, each block waiting for
+// its slot on the wall clock, the way an audio interface paces a host.
+// Either way, the realtime factor of the time spent in process() and the peak
+// time taken by a single block are reported.
+//
+// Usage: sidebands_render [options] patch in.mid out.wav [in.mid out.wav ...]
+//   --bank=PATH         the patch is the name of a preset in this preset bank
+//   --realtime          pace blocks to the wall clock
+//   --jobs=N            files rendered at once without --realtime (all cores)
+//   --sample_rate=HZ    (48000)
+//   --block_size=N      (512)
+//   --tail=SECONDS      rendered past the end of the MIDI file (2)
+
+#include <glog/logging.h>
+#include <pluginterfaces/vst/ivstaudioprocessor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "globals.h"
+#include "host/processor_host.h"
+#include "midi_file.h"
+#include "processor/preset_bank.h"
+#include "processor/sidebands_processor.h"
+#include "public.sdk/source/common/memorystream.h"
+#include "wav_writer.h"
+
+using namespace Steinberg;
+using namespace sidebands;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kNumChannels = 2;
+
+struct Options {
+  bool realtime = false;
+  int jobs = std::max(1u, std::thread::hardware_concurrency());
+  double sample_rate = 48000;
+  int32 block_size = 512;
+  double tail_seconds = 2.0;
+  std::string bank_path;
+};
+
+// What each file is rendered with: a saved patch, or a preset in a bank.
+struct PatchSource {
+  std::string state;
+  const PresetBank *bank = nullptr;
+  size_t preset = 0;
+};
+
+struct Job {
+  std::string midi_path;
+  std::string wav_path;
+
+  bool ok = false;
+  double audio_seconds = 0.0;
+  // Time spent in process(), leaving out reading and writing files and, with
+  // --realtime, waiting for the clock.
+  double process_seconds = 0.0;
+  double peak_block_ms = 0.0;
+  // Blocks which took longer than their own length to process.
+  int64_t late_blocks = 0;
+};
+
+Vst::Event MakeNoteEvent(const MidiNoteEvent &note, int32 sample_offset) {
+  Vst::Event event{};
+  event.busIndex = 0;
+  event.sampleOffset = sample_offset;
+  // Notes are told apart by channel and pitch, as MIDI does.
+  const int32 note_id = note.channel * 128 + note.pitch;
+  if (note.on) {
+    event.type = Vst::Event::kNoteOnEvent;
+    event.noteOn.channel = note.channel;
+    event.noteOn.pitch = note.pitch;
+    event.noteOn.velocity = note.velocity / 127.0f;
+    event.noteOn.noteId = note_id;
+  } else {
+    event.type = Vst::Event::kNoteOffEvent;
+    event.noteOff.channel = note.channel;
+    event.noteOff.pitch = note.pitch;
+    event.noteOff.velocity = note.velocity / 127.0f;
+    event.noteOff.noteId = note_id;
+  }
+  return event;
+}
+
+bool Render(const Options &options, const PatchSource &patch, Job *job) {
+  auto midi = MidiFile::Read(job->midi_path);
+  if (!midi) return false;
+  auto wav = WavWriter::Open(job->wav_path, kNumChannels,
+                             std::lround(options.sample_rate));
+  if (!wav) return false;
+
+  const auto process_mode = options.realtime ? Vst::kRealtime : Vst::kOffline;
+  ProcessorHost host(process_mode, options.sample_rate, options.block_size);
+  host.Instantiate();
+  host.Initialize();
+  // Loaded before activation, so that the patch's polyphony and voice layout
+  // are the ones the player is built with.
+  SidebandsProcessor *processor = host.processor();
+  tresult loaded;
+  if (patch.bank) {
+    loaded = processor->LoadPreset(*patch.bank, patch.preset);
+  } else {
+    MemoryStream patch_stream(const_cast<char *>(patch.state.data()),
+                              patch.state.size());
+    loaded = processor->setState(&patch_stream);
+  }
+  if (loaded != kResultOk) {
+    LOG(ERROR) << "Unable to load patch";
+    return false;
+  }
+  host.SetupProcessing();
+  host.Activate();
+
+  const int64_t total_samples = std::ceil(
+      (midi->duration + options.tail_seconds) * options.sample_rate);
+  const double block_ms = 1000.0 * options.block_size / options.sample_rate;
+  size_t next_event = 0;
+  bool ok = true;
+  const auto start = Clock::now();
+  for (int64_t position = 0; position < total_samples && ok;
+       position += options.block_size) {
+    const int32 frames =
+        std::min<int64_t>(options.block_size, total_samples - position);
+    while (next_event < midi->events.size()) {
+      const auto &note = midi->events[next_event];
+      const int64_t sample = std::llround(note.time * options.sample_rate);
+      if (sample >= position + frames) break;
+      host.AddEvent(
+          MakeNoteEvent(note, std::max<int64_t>(0, sample - position)));
+      next_event++;
+    }
+    const auto block_start = Clock::now();
+    host.Process(frames);
+    const double elapsed_ms = std::chrono::duration<double, std::milli>(
+                                  Clock::now() - block_start)
+                                  .count();
+    job->process_seconds += elapsed_ms / 1000;
+    job->peak_block_ms = std::max(job->peak_block_ms, elapsed_ms);
+    if (elapsed_ms > block_ms * frames / options.block_size) job->late_blocks++;
+
+    ok = wav->Write(host.channels(), frames);
+
+    if (options.realtime) {
+      std::this_thread::sleep_until(
+          start + std::chrono::duration_cast<Clock::duration>(
+                      std::chrono::duration<double>(
+                          (position + frames) / options.sample_rate)));
+    }
+  }
+  job->audio_seconds = total_samples / options.sample_rate;
+  return wav->Close() && ok;
+}
+
+// Realtime factor is seconds of audio per second of `render_seconds`.
+void Report(const char *name, double audio_seconds, double render_seconds,
+            double peak_block_ms, double block_ms, int64_t late_blocks) {
+  std::printf(
+      "%-32s %9.2f s audio in %8.2f s, %7.2fx realtime; peak block %7.3f ms "
+      "(%5.1f%% of %.3f ms), %lld late\n",
+      name, audio_seconds, render_seconds,
+      render_seconds > 0 ? audio_seconds / render_seconds : 0.0, peak_block_ms,
+      100.0 * peak_block_ms / block_ms, block_ms, (long long)late_blocks);
+}
+
+bool ParseFlag(const char *arg, const char *name, const char **value) {
+  const size_t length = std::strlen(name);
+  if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') return false;
+  *value = arg + length + 1;
+  return true;
+}
+
+void Usage() {
+  std::fprintf(stderr,
+               "Usage: sidebands_render [--bank=PATH] [--realtime] [--jobs=N] "
+               "[--sample_rate=HZ] [--block_size=N] [--tail=SECONDS] patch "
+               "in.mid out.wav [in.mid out.wav ...]\n");
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  InitProcess();
+  // Every instance logs its startup; only problems are of interest here.
+  FLAGS_minloglevel = google::GLOG_WARNING;
+
+  Options options;
+  std::vector<const char *> positional;
+  for (int i = 1; i < argc; i++) {
+    const char *value;
+    if (std::strcmp(argv[i], "--realtime") == 0) {
+      options.realtime = true;
+    } else if (ParseFlag(argv[i], "--bank", &value)) {
+      options.bank_path = value;
+    } else if (ParseFlag(argv[i], "--jobs", &value)) {
+      options.jobs = std::max(1, std::atoi(value));
+    } else if (ParseFlag(argv[i], "--sample_rate", &value)) {
+      options.sample_rate = std::atof(value);
+    } else if (ParseFlag(argv[i], "--block_size", &value)) {
+      options.block_size = std::atoi(value);
+    } else if (ParseFlag(argv[i], "--tail", &value)) {
+      options.tail_seconds = std::max(0.0, std::atof(value));
+    } else if (std::strncmp(argv[i], "--", 2) == 0) {
+      Usage();
+      return 2;
+    } else {
+      positional.push_back(argv[i]);
+    }
+  }
+  if (positional.size() < 3 || positional.size() % 2 == 0 ||
+      options.sample_rate <= 0 || options.block_size <= 0) {
+    Usage();
+    return 2;
+  }
+
+  PatchSource patch;
+  std::unique_ptr<PresetBank> bank;
+  if (!options.bank_path.empty()) {
+    bank = PresetBank::Open(options.bank_path);
+    if (!bank) return 1;
+    const auto preset = bank->Find(positional[0]);
+    if (!preset) {
+      LOG(ERROR) << "No preset " << positional[0] << " in "
+                 << options.bank_path;
+      return 1;
+    }
+    patch.bank = bank.get();
+    patch.preset = *preset;
+  } else {
+    std::ifstream patch_file(positional[0], std::ios::binary);
+    if (!patch_file) {
+      LOG(ERROR) << "Unable to open patch: " << positional[0];
+      return 1;
+    }
+    patch.state.assign(std::istreambuf_iterator<char>(patch_file),
+                       std::istreambuf_iterator<char>());
+  }
+
+  std::vector<Job> jobs;
+  for (size_t i = 1; i < positional.size(); i += 2)
+    jobs.push_back({positional[i], positional[i + 1]});
+
+  // Realtime renders run one after another, like a single host would; offline
+  // ones take a file each per thread. Each player also spreads its voices over
+  // the cores.
+  const size_t num_threads =
+      options.realtime ? 1 : std::min<size_t>(options.jobs, jobs.size());
+  std::atomic<size_t> next_job{0};
+  const auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&] {
+      size_t j;
+      while ((j = next_job.fetch_add(1)) < jobs.size())
+        jobs[j].ok = Render(options, patch, &jobs[j]);
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  const double wall_seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  const double block_ms = 1000.0 * options.block_size / options.sample_rate;
+  std::printf("%s, %.0f Hz, %d sample blocks, %zu thread(s)\n",
+              options.realtime ? "realtime" : "offline", options.sample_rate,
+              options.block_size, num_threads);
+  double audio_seconds = 0.0, peak_block_ms = 0.0;
+  int64_t late_blocks = 0;
+  int failed = 0;
+  for (const auto &job : jobs) {
+    if (!job.ok) {
+      std::printf("%-32s failed\n", job.midi_path.c_str());
+      failed++;
+      continue;
+    }
+    Report(job.wav_path.c_str(), job.audio_seconds, job.process_seconds,
+           job.peak_block_ms, block_ms, job.late_blocks);
+    audio_seconds += job.audio_seconds;
+    peak_block_ms = std::max(peak_block_ms, job.peak_block_ms);
+    late_blocks += job.late_blocks;
+  }
+  // Files rendered side by side overlap, so the total is against the wall
+  // clock.
+  if (jobs.size() > 1)
+    Report("total (wall clock)", audio_seconds, wall_seconds, peak_block_ms,
+           block_ms, late_blocks);
+  return failed ? 1 : 0;
+}
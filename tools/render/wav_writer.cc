@@ -0,0 +1,113 @@
+#include "wav_writer.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace sidebands {
+
+namespace {
+
+constexpr uint16_t kWaveFormatIEEEFloat = 3;
+constexpr uint32_t kBytesPerSample = sizeof(float);
+
+void Append(std::vector<uint8_t> &bytes, const char (&tag)[5]) {
+  bytes.insert(bytes.end(), tag, tag + 4);
+}
+
+// Little-endian.
+template <typename T>
+void Append(std::vector<uint8_t> &bytes, T value) {
+  for (size_t i = 0; i < sizeof(T); i++) bytes.push_back(value >> (8 * i));
+}
+
+}  // namespace
+
+std::unique_ptr<WavWriter> WavWriter::Open(const std::string &path,
+                                           int num_channels, int sample_rate) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    LOG(ERROR) << "Unable to create WAV file: " << path;
+    return nullptr;
+  }
+  std::unique_ptr<WavWriter> writer(
+      new WavWriter(std::move(out), num_channels, sample_rate));
+  // A placeholder until the length is known.
+  const auto header = writer->Header(0);
+  writer->out_.write(reinterpret_cast<const char *>(header.data()),
+                     header.size());
+  return writer;
+}
+
+WavWriter::WavWriter(std::ofstream out, int num_channels, int sample_rate)
+    : out_(std::move(out)),
+      num_channels_(num_channels),
+      sample_rate_(sample_rate) {}
+
+WavWriter::~WavWriter() {
+  if (!closed_) Close();
+}
+
+bool WavWriter::Write(const float *const *channels, size_t frames) {
+  interleaved_.resize(frames * num_channels_);
+  for (size_t i = 0; i < frames; i++)
+    for (int c = 0; c < num_channels_; c++)
+      interleaved_[i * num_channels_ + c] = channels[c][i];
+  // Samples are written as they are in memory, which on every platform the
+  // plugin builds for is little-endian, as WAV wants.
+  out_.write(reinterpret_cast<const char *>(interleaved_.data()),
+             interleaved_.size() * kBytesPerSample);
+  frames_ += frames;
+  return bool(out_);
+}
+
+bool WavWriter::Close() {
+  closed_ = true;
+  const auto header = Header(frames_);
+  out_.seekp(0);
+  out_.write(reinterpret_cast<const char *>(header.data()), header.size());
+  out_.close();
+  if (!out_) {
+    LOG(ERROR) << "Error writing WAV file";
+    return false;
+  }
+  return true;
+}
+
+std::vector<uint8_t> WavWriter::Header(uint64_t frames) const {
+  const uint32_t block_align = num_channels_ * kBytesPerSample;
+  // Sizes are 32 bits; past 4 GiB the header can't describe the file, and
+  // most readers go on to the end of it anyway.
+  const uint64_t data_bytes = frames * block_align;
+  const uint32_t data_size = std::min<uint64_t>(
+      data_bytes, std::numeric_limits<uint32_t>::max() - 64);
+
+  std::vector<uint8_t> bytes;
+  Append(bytes, "RIFF");
+  // Everything after this field: "WAVE", fmt, fact, and data chunks.
+  Append<uint32_t>(bytes, 4 + (8 + 18) + (8 + 4) + (8 + data_size));
+  Append(bytes, "WAVE");
+
+  // Non-PCM formats have the extension size field, and a fact chunk.
+  Append(bytes, "fmt ");
+  Append<uint32_t>(bytes, 18);
+  Append<uint16_t>(bytes, kWaveFormatIEEEFloat);
+  Append<uint16_t>(bytes, num_channels_);
+  Append<uint32_t>(bytes, sample_rate_);
+  Append<uint32_t>(bytes, sample_rate_ * block_align);
+  Append<uint16_t>(bytes, block_align);
+  Append<uint16_t>(bytes, kBytesPerSample * 8);
+  Append<uint16_t>(bytes, 0);
+
+  Append(bytes, "fact");
+  Append<uint32_t>(bytes, 4);
+  Append<uint32_t>(bytes, std::min<uint64_t>(
+                              frames, std::numeric_limits<uint32_t>::max()));
+
+  Append(bytes, "data");
+  Append<uint32_t>(bytes, data_size);
+  return bytes;
+}
+
+}  // namespace sidebands
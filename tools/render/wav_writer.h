@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sidebands {
+
+// Writes a 32-bit float WAV file a block at a time. The sizes in the header
+// are filled in by Close().
+class WavWriter {
+ public:
+  // Create the file at `path`; null if it can't be.
+  static std::unique_ptr<WavWriter> Open(const std::string &path,
+                                         int num_channels, int sample_rate);
+  // Closes the file, if Close() hasn't.
+  ~WavWriter();
+
+  // Append `frames` samples of each of the channels.
+  bool Write(const float *const *channels, size_t frames);
+  bool Close();
+
+ private:
+  WavWriter(std::ofstream out, int num_channels, int sample_rate);
+  // Header for `frames` frames of audio.
+  std::vector<uint8_t> Header(uint64_t frames) const;
+
+  std::ofstream out_;
+  const int num_channels_;
+  const int sample_rate_;
+  uint64_t frames_ = 0;
+  bool closed_ = false;
+  // Interleaving buffer.
+  std::vector<float> interleaved_;
+};
+
+}  // namespace sidebands